@@ -1,6 +1,9 @@
 using System;
+using System.Buffers;
+using System.Collections.Generic;
 using System.Collections.ObjectModel;
 using System.IO;
+using System.IO.Pipelines;
 using System.Linq;
 using System.Net.Sockets;
 using System.Text;
@@ -18,10 +21,15 @@ public partial class MainWindow : Window
 {
     private readonly string _logPath = Path.Combine(AppContext.BaseDirectory, "client.log");
     private TcpClient? _client;
-    private StreamReader? _reader;
+    private PipeReader? _pipe;
     private StreamWriter? _writer;
     private CancellationTokenSource? _cts;
 
+    // Watchdog timeout - slightly more than 2x PING interval (5s)
+    // If server works, we get PING every 5s. If silence > 12s, assume dead.
+    private const int ReceiveTimeoutMs = 12000;
+    private const int MaxLineBytes = 64 * 1024;
+
     private string _playerName = string.Empty;
     private string _sessionId = string.Empty;
     private string _opponentName = string.Empty;
@@ -84,7 +92,7 @@ public partial class MainWindow : Window
             Log($"Connected to {ip}:{port} as {name}");
 
             var stream = _client.GetStream();
-            _reader = new StreamReader(stream, Encoding.UTF8);
+            _pipe = PipeReader.Create(stream, new StreamPipeReaderOptions(leaveOpen: true));
             _writer = new StreamWriter(stream, new UTF8Encoding(false)) { AutoFlush = true };
 
             _playerName = name;
@@ -108,45 +116,89 @@ public partial class MainWindow : Window
 
     private async Task ListenToServerAsync(CancellationToken token)
     {
-        try
+        var reader = _pipe!;
+        var batch = new List<string>();
+        Func<Task> deliver = () => HandleServerBatchAsync(batch);
+
+        // Watchdog: one timer per connection, re-armed before every read and
+        // parked while a batch is on the UI thread (dialogs may block there).
+        // Firing cancels the pending read instead of racing it with Task.Delay.
+        // Change() does not stop a callback that is already running, so every
+        // arm gets a generation: a cancel stamped with another one, or landing
+        // right after a re-arm, is stale and the read result is used as is.
+        int armed = 0;      // Generation of the armed read, 0 = parked
+        int fired = 0;      // Generation the last callback cancelled
+        var watchdog = new Timer(_ =>
         {
-            // Watchdog timeout - slightly more than 2x PING interval (5s)
-            // If server works, we get PING every 5s. If silence > 12s, assume dead.
-            TimeSpan receiveTimeout = TimeSpan.FromMilliseconds(12000);
+            int gen = Volatile.Read(ref armed);
+            if (gen == 0) return;
+            Volatile.Write(ref fired, gen);
+            reader.CancelPendingRead();
+        }, null, Timeout.Infinite, Timeout.Infinite);
+        int generation = 0;
 
+        try
+        {
             while (!token.IsCancellationRequested)
             {
-                string? line;
+                generation = generation == int.MaxValue ? 1 : generation + 1;
+                int gen = generation;
+                long armedAt = Environment.TickCount64;
+                Volatile.Write(ref armed, gen);
+                watchdog.Change(ReceiveTimeoutMs, Timeout.Infinite);
+                ReadResult result;
                 try
                 {
-                    var readTask = _reader!.ReadLineAsync();
-                    
-                    // Wait for read OR timeout OR cancellation
-                    // Note: Task.WaitAsync is .NET 6+, fallback for compat if needed, 
-                    // but Avalonia implies modern .NET. simpler approach using WhenAny for robustness:
-                    var completed = await Task.WhenAny(readTask, Task.Delay(receiveTimeout, token));
+                    result = await reader.ReadAsync(token);
+                }
+                catch (OperationCanceledException)
+                {
+                    throw;
+                }
+                catch
+                {
+                    break;
+                }
+                finally
+                {
+                    Volatile.Write(ref armed, 0);
+                    watchdog.Change(Timeout.Infinite, Timeout.Infinite);
+                }
 
-                    if (completed != readTask)
-                    {
-                        // Timeout happened (or token cancelled Task.Delay)
-                        if (token.IsCancellationRequested) break;
-                        
-                        Log("Watchdog timeout: Server silent for > 12s. Assuming disconnect.");
-                        break; // Trigger finally -> SafeDisconnect
-                    }
+                if (result.IsCanceled && Volatile.Read(ref fired) == gen &&
+                    Environment.TickCount64 - armedAt >= ReceiveTimeoutMs / 2)
+                {
+                    Log($"Watchdog timeout: Server silent for > {ReceiveTimeoutMs / 1000}s. Assuming disconnect.");
+                    break; // Trigger finally -> SafeDisconnect
+                }
 
-                    // Read completed
-                    line = await readTask;
+                var buffer = result.Buffer;
+                while (TryReadLine(ref buffer, out var line))
+                {
+                    if (IsProtocolLine(line))
+                        batch.Add(Encoding.UTF8.GetString(line));
+                    else if (!line.IsEmpty)
+                        Log($"RX ignored: {line.Length} bytes without ## prefix");
                 }
-                catch
+
+                bool overlong = buffer.Length > MaxLineBytes;
+                reader.AdvanceTo(buffer.Start, buffer.End);
+
+                if (overlong)
                 {
+                    Log($"Server line longer than {MaxLineBytes} bytes. Assuming disconnect.");
                     break;
                 }
 
-                if (line == null) break;
+                // Everything parsed from this read goes to the UI thread in
+                // one hop; handlers still run one by one, in arrival order.
+                if (batch.Count > 0)
+                {
+                    await Dispatcher.UIThread.InvokeAsync(deliver);
+                    batch.Clear();
+                }
 
-                var captured = line;
-                await Dispatcher.UIThread.InvokeAsync(() => HandleServerMessage(captured));
+                if (result.IsCompleted) break;
             }
         }
         catch (OperationCanceledException)
@@ -155,6 +207,7 @@ public partial class MainWindow : Window
         }
         finally
         {
+            watchdog.Dispose();
             await SafeDisconnectAsync();
 
             await Dispatcher.UIThread.InvokeAsync(() =>
@@ -191,6 +244,41 @@ public partial class MainWindow : Window
         }
     }
 
+    // Cuts one '\n'-terminated line off the front of the buffer (without
+    // the '\n' and an optional '\r'); false if no full line is buffered yet.
+    private static bool TryReadLine(ref ReadOnlySequence<byte> buffer, out ReadOnlySequence<byte> line)
+    {
+        var eol = buffer.PositionOf((byte)'\n');
+        if (eol == null)
+        {
+            line = default;
+            return false;
+        }
+
+        line = buffer.Slice(0, eol.Value);
+        buffer = buffer.Slice(buffer.GetPosition(1, eol.Value));
+
+        if (!line.IsEmpty)
+        {
+            var last = line.Slice(line.Length - 1);
+            if (last.FirstSpan[0] == (byte)'\r')
+                line = line.Slice(0, line.Length - 1);
+        }
+        return true;
+    }
+
+    private static bool IsProtocolLine(in ReadOnlySequence<byte> line)
+    {
+        var sr = new SequenceReader<byte>(line);
+        return sr.IsNext("##"u8, advancePast: false);
+    }
+
+    private async Task HandleServerBatchAsync(List<string> lines)
+    {
+        foreach (var line in lines)
+            await HandleServerMessage(line);
+    }
+
     private async Task SafeDisconnectAsync()
     {
         try
@@ -205,10 +293,10 @@ public partial class MainWindow : Window
                 _writer = null;
             }
 
-            if (_reader != null)
+            if (_pipe != null)
             {
-                try { _reader.Dispose(); } catch { }
-                _reader = null;
+                try { await _pipe.CompleteAsync(); } catch { }
+                _pipe = null;
             }
 
             if (_client != null)
@@ -246,7 +334,7 @@ public partial class MainWindow : Window
                 await _client.ConnectAsync(_serverIp, _serverPort);
 
                 var stream = _client.GetStream();
-                _reader = new StreamReader(stream, Encoding.UTF8);
+                _pipe = PipeReader.Create(stream, new StreamPipeReaderOptions(leaveOpen: true));
                 _writer = new StreamWriter(stream, new UTF8Encoding(false)) { AutoFlush = true };
 
                 await SendAsync($"##RECONNECT|{_playerName}|{_sessionId}");
@@ -0,0 +1,184 @@
+// ============================================================
+//  TRANSPORT BENCHMARK
+//  ------------------------------------------------------------
+//  Round-trip latency and CPU per message of a running server,
+//  over loopback TCP and over the LISTEN_UNIX socket:
+//
+//    ./build/transport_bench [-n msgs] [-p server_pid]
+//        127.0.0.1:10000 unix:/tmp/ttt.sock
+//
+//  Each message is a ##PING| answered by ##PONG|, one in flight
+//  at a time, so the numbers are the per-message cost of the
+//  transport plus the (tiny) dispatch. CPU is the benchmark's
+//  own user + system time and, with -p, the server's (from
+//  /proc/<pid>/stat), divided by the message count.
+// ============================================================
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_DEFAULT_MSGS 20000
+#define BENCH_WARMUP       500
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static long long rusage_us(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (long long)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000LL +
+           ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+
+// utime + stime of another process in microseconds, -1 if unknown
+static long long proc_cpu_us(int pid) {
+    if (pid <= 0) return -1;
+    char path[64], buf[1024];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    FILE* f = fopen(path, "r");
+    if (!f) return -1;
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[n] = '\0';
+
+    // Fields after the parenthesised command name; utime / stime are 14 / 15
+    char* p = strrchr(buf, ')');
+    unsigned long long ut = 0, st = 0;
+    if (!p || sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &ut, &st) != 2)
+        return -1;
+    return (long long)(ut + st) * 1000000LL / sysconf(_SC_CLK_TCK);
+}
+
+static int connect_to(const char* addr) {
+    if (strncmp(addr, "unix:", 5) == 0) {
+        struct sockaddr_un sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sun_family = AF_UNIX;
+        snprintf(sa.sun_path, sizeof(sa.sun_path), "%s", addr + 5);
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, (struct sockaddr*)&sa, sizeof(sa)) == 0) return fd;
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+
+    char host[64];
+    const char* colon = strrchr(addr, ':');
+    if (!colon || (size_t)(colon - addr) >= sizeof(host)) return -1;
+    memcpy(host, addr, (size_t)(colon - addr));
+    host[colon - addr] = '\0';
+
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons((uint16_t)atoi(colon + 1));
+    if (inet_pton(AF_INET, host, &sa.sin_addr) != 1) return -1;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(fd, (struct sockaddr*)&sa, sizeof(sa)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Reads until a ##PONG| line arrived (skipping HELLO / PING lines)
+static int wait_pong(int fd, char* buf, size_t cap, size_t* len) {
+    for (;;) {
+        char* nl;
+        while ((nl = memchr(buf, '\n', *len)) != NULL) {
+            size_t line = (size_t)(nl - buf) + 1;
+            int pong = (line >= 7 && memcmp(buf, "##PONG|", 7) == 0);
+            memmove(buf, buf + line, *len - line);
+            *len -= line;
+            if (pong) return 1;
+        }
+        if (*len == cap) *len = 0;
+        ssize_t n = recv(fd, buf + *len, cap - *len, 0);
+        if (n <= 0) return 0;
+        *len += (size_t)n;
+    }
+}
+
+static int cmp_ll(const void* a, const void* b) {
+    long long x = *(const long long*)a, y = *(const long long*)b;
+    return (x > y) - (x < y);
+}
+
+static int run(const char* addr, int msgs, int pid) {
+    int fd = connect_to(addr);
+    if (fd < 0) {
+        fprintf(stderr, "%s: cannot connect\n", addr);
+        return 0;
+    }
+    char buf[4096];
+    size_t len = 0;
+    long long* rtt = malloc(sizeof(long long) * (size_t)msgs);
+    if (!rtt) {
+        close(fd);
+        return 0;
+    }
+
+    for (int i = 0; i < BENCH_WARMUP; i++) {
+        if (send(fd, "##PING|\n", 8, 0) != 8 || !wait_pong(fd, buf, sizeof(buf), &len)) goto fail;
+    }
+
+    long long cpu0 = rusage_us(), srv0 = proc_cpu_us(pid), t0 = now_ns();
+    for (int i = 0; i < msgs; i++) {
+        long long s = now_ns();
+        if (send(fd, "##PING|\n", 8, 0) != 8 || !wait_pong(fd, buf, sizeof(buf), &len)) goto fail;
+        rtt[i] = now_ns() - s;
+    }
+    long long wall = now_ns() - t0;
+    long long cpu = rusage_us() - cpu0;
+    long long srv = (srv0 >= 0) ? proc_cpu_us(pid) - srv0 : -1;
+
+    qsort(rtt, (size_t)msgs, sizeof(long long), cmp_ll);
+    printf("%-24s msgs=%d  rtt p50=%.1f us p99=%.1f us  rate=%.0f msg/s  client cpu=%.2f us/msg",
+           addr, msgs, rtt[msgs / 2] / 1000.0, rtt[(long long)msgs * 99 / 100] / 1000.0,
+           msgs * 1e9 / (double)wall, (double)cpu / msgs);
+    if (srv >= 0) printf("  server cpu=%.2f us/msg", (double)srv / msgs);
+    printf("\n");
+
+    free(rtt);
+    close(fd);
+    return 1;
+
+fail:
+    fprintf(stderr, "%s: connection lost\n", addr);
+    free(rtt);
+    close(fd);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    int msgs = BENCH_DEFAULT_MSGS, pid = 0, opt;
+    while ((opt = getopt(argc, argv, "n:p:")) != -1) {
+        if (opt == 'n') msgs = atoi(optarg);
+        else if (opt == 'p') pid = atoi(optarg);
+        else break;
+    }
+    if (optind >= argc || msgs <= 0) {
+        fprintf(stderr, "usage: %s [-n msgs] [-p server_pid] host:port|unix:/path ...\n", argv[0]);
+        return 2;
+    }
+
+    int ok = 1;
+    for (int i = optind; i < argc; i++) ok &= run(argv[i], msgs, pid);
+    return ok ? 0 : 1;
+}
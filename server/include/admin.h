@@ -0,0 +1,38 @@
+#ifndef ADMIN_H
+#define ADMIN_H
+
+// ============================================================
+//  ADMIN MODULE HEADER
+//  ------------------------------------------------------------
+//  Operator commands, authenticated by ADMIN_TOKEN from the
+//  server config (an empty token disables them).
+//
+//  ##ADMIN|<token>|BROADCAST|<topic>|<text>
+//      -> INFO|<text> to the topic (see pubsub.h)
+//      -> ADMIN_OK|<receivers> to the operator
+//
+//  ##ADMIN|<token>|UPGRADE
+//      -> ADMIN_OK|UPGRADE, then a live upgrade (see upgrade.h)
+//
+//  ##ADMIN|<token>|DRAIN[|<seconds>]
+//      -> starts draining (see drain.h), default deadline DRAIN_TIMEOUT
+//      -> ADMIN_OK|DRAIN|<rooms>|<clients>|<seconds left>
+//
+//  ##ADMIN|<token>|FEED
+//      -> room snapshot + live changes (see feed.h), then ADMIN_OK|FEED
+//
+//  ##ADMIN|<token>|DRAIN_STATUS
+//      -> ADMIN_OK|DRAIN_STATUS|<draining 0/1>|<rooms>|<clients>|<seconds left>
+// ============================================================
+
+struct Client;
+
+/**
+ * @brief Handles a ##ADMIN| command.
+ * @param c        Sender.
+ * @param payload  Text after "##ADMIN|".
+ * @return 1 if accepted, 0 if rejected (caller counts it as invalid input).
+ */
+int admin_command(struct Client* c, const char* payload);
+
+#endif // ADMIN_H
@@ -0,0 +1,35 @@
+#ifndef BOT_H
+#define BOT_H
+
+// ============================================================
+//  BOT MODULE HEADER
+//  ------------------------------------------------------------
+//  Server-side opponent used to fill rooms created with the
+//  bot=<s> option. A bot is a Client without a socket (fd -1,
+//  not registered in g_clients); its moves are played from
+//  timer-wheel callbacks, so it costs no thread.
+// ============================================================
+
+#define BOT_MOVE_MS 600     // Think time before each bot move
+
+struct Client;
+struct Room;
+
+/**
+ * @brief Allocates a bot client with a fresh "Bot-<n>" name.
+ * @return New bot, or NULL on allocation failure.
+ */
+struct Client* bot_create(void);
+
+/**
+ * @brief Frees a bot client (must no longer be seated in a room).
+ */
+void bot_destroy(struct Client* bot);
+
+/**
+ * @brief Schedules the bot's move if it is on turn (expects g_rooms_mtx held).
+ * @param r Room whose turn has just changed.
+ */
+void bot_on_turn(struct Room* r);
+
+#endif // BOT_H
@@ -0,0 +1,29 @@
+#ifndef CHAT_H
+#define CHAT_H
+
+// ============================================================
+//  CHAT MODULE HEADER
+//  ------------------------------------------------------------
+//  ##CHAT|text - room chat when the sender plays in or watches a
+//  room, lobby chat otherwise.
+//
+//  Policies:
+//   - per-client token bucket (CHAT_RATE msgs/s, CHAT_BURST burst)
+//   - messages longer than CHAT_MAX_LEN are rejected
+//   - lobby delivery goes through the fan-out workers (one shared
+//     buffer, non-blocking sends; slow receivers drop lines)
+// ============================================================
+
+#define CHAT_RATE  1.0      // Sustained messages per second
+#define CHAT_BURST 5.0      // Messages allowed in a burst
+
+struct Client;
+
+/**
+ * @brief Handles a ##CHAT| command.
+ * @param c     Sender.
+ * @param text  Payload after "##CHAT|".
+ */
+void chat_handle(struct Client* c, const char* text);
+
+#endif // CHAT_H
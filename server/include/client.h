@@ -2,7 +2,11 @@
 #define CLIENT_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include "ratelimit.h"
 
 // ============================================================
 //  CLIENT MODULE HEADER
@@ -12,10 +16,12 @@
 //  room association.
 // ============================================================
 
-#define MAX_CLIENTS 128  // Maximum number of concurrent clients
+#define MAX_CLIENTS 1024 // Upper bound for MAX_CLIENTS in server.config
+#define CLIENT_INBUF 512 // Longest protocol line (incl. newline)
 
-// Forward declaration (to avoid circular includes)
+// Forward declarations (to avoid circular includes)
 struct Room;
+struct QueueEntry;
 
 
 // ------------------------------------------------------------
@@ -43,6 +49,28 @@ typedef struct Client {
     int  invalid_count;         // Number of invalid protocol inputs
 
     char session_id[32];        // Unique reconnect session token
+    int  spectate_room_id;      // Room being watched (-1 if none)
+
+    int  rating;                // Elo rating used by quick-match
+    struct QueueEntry* queue_entry; // Quick-match queue position (NULL if not queued)
+
+    TokenBucket chat_bucket;    // ##CHAT| rate limit
+    CmdLimiter cmd_limit;       // Limits checked before dispatch (see ratelimit.h)
+    uint32_t ip;                // IPv4 peer address (host order), 0 for AF_UNIX
+    bool   ip_counted;          // Holds a slot of the per-address caps (see connlimit.h)
+    bool is_bot;                // Server-side bot (no socket, see bot.h)
+
+    char   inbuf[CLIENT_INBUF]; // Bytes of the line being received
+    size_t inlen;
+    pthread_t thread;           // Thread serving the socket
+    bool   has_thread;          // thread is set (under g_clients_mtx)
+    bool   parked;              // Stopped for a live upgrade (see upgrade.h)
+    bool   drain_told;          // Got DRAINING| (see drain.h)
+    long long last_rx_ms;       // now_ms() of the last line received
+    atomic_int migrate_to;      // Worker to move to at the next line boundary, -1 = stay (see rebalance.h)
+
+    atomic_int refs;            // client_hold() references + 1 for the owning thread
+    atomic_bool dying;          // In client_destroy(): no room or queue may take it
 } Client;
 
 
@@ -57,11 +85,88 @@ typedef struct Client {
 struct Client* client_create(int fd);
 
 /**
- * @brief Cleans up and frees a Client instance.
+ * @brief Counts an already connected client against the per-address
+ *        caps without checking them (adopted and upgraded clients).
+ */
+void client_track_ip(struct Client* c);
+
+/**
+ * @brief Sends ##ERROR|<reason> to a connection that is turned away.
+ *
+ * Never blocks (MSG_DONTWAIT): a peer that does not read simply
+ * misses the line. The caller closes the socket.
+ */
+void client_refuse(int fd, const char* reason);
+
+/**
+ * @brief Sets the size of the client table (start-up and config reload).
+ *
+ * Connected clients are kept (the table is compacted and never
+ * shrinks below them); only new connections see the new limit.
+ *
+ * @param cap  Wanted number of slots (normally MAX_CLIENTS from the config).
+ * @return Resulting capacity.
+ */
+int client_pool_resize(int cap);
+
+/**
+ * @brief Pre-allocates and pre-faults n client structs (PREALLOC_CLIENTS).
+ *        Call once at start-up; beyond n, clients come from malloc.
+ * @return Bytes committed.
+ */
+size_t client_prealloc(int n);
+
+/**
+ * @brief Takes over a connection handed over by another worker process.
+ *
+ * Restores the identity, starts the client thread and replays the
+ * command that caused the handoff (no HELLO| is sent).
+ *
+ * @return 1 if the descriptor was consumed, 0 if the caller must close it.
+ */
+int client_adopt(int fd, const char* name, const char* session, int rating, const char* line);
+
+/**
+ * @brief True if the client can move to another worker: named, in the
+ *        lobby, not spectating, queued, feed-subscribed or in a tournament.
+ *
+ * Expects no lock held (takes the tournament lock).
+ */
+bool client_movable(const struct Client* c);
+
+/**
+ * @brief Starts the thread of a client rebuilt by a live upgrade
+ *        (no HELLO|, reading continues in the middle of inbuf).
+ * @return 1 on success, 0 if no thread could be started.
+ */
+int client_resume(struct Client* c);
+
+/**
+ * @brief Cleans up a Client instance: leaves its room, the queue and
+ *        the registry. The struct and its socket are freed once the
+ *        last client_hold() reference is dropped.
  * @param c Pointer to Client to be destroyed.
  */
 void client_destroy(struct Client* c);
 
+/**
+ * @brief Keeps c (and its socket) allocated past client_destroy().
+ *        For code that uses a client outside of g_clients_mtx.
+ */
+void client_hold(struct Client* c);
+
+/**
+ * @brief Drops a client_hold() reference; the last one frees c.
+ */
+void client_release(struct Client* c);
+
+/**
+ * @brief Finds a connected client by session token and holds it.
+ * @param session Token from SESSION| (unique, survives reconnects).
+ * @return Held client (release with client_release()), or NULL.
+ */
+struct Client* client_hold_by_session(const char* session);
+
 
 // ------------------------------------------------------------
 //  Property management
@@ -81,6 +186,38 @@ void client_set_name(struct Client* c, const char* name);
 void client_set_state(struct Client* c, ClientState st);
 
 
+/**
+ * @brief Finds a connected client by nickname.
+ * @param name Nickname to look up.
+ * @return Client pointer, or NULL if nobody with that name is online.
+ */
+struct Client* client_find_by_name(const char* name);
+
+
+struct Audience;
+
+/**
+ * @brief Snapshots all named clients in the lobby, each one held.
+ * @return Audience with one reference (audience_release() it), or
+ *         NULL if the lobby is empty.
+ */
+struct Audience* client_lobby_audience(void);
+
+#define CLIENT_STATE_ANY (-1)   // client_state_audience(): every named client
+
+/**
+ * @brief Snapshots all named clients in a given state, each one held.
+ *
+ * CLIENT_STATE_LOBBY means "not in a room and not spectating", the
+ * same set as client_lobby_audience(). Only the copy runs under
+ * g_clients_mtx.
+ *
+ * @param state ClientState value or CLIENT_STATE_ANY.
+ * @return Audience with one reference, or NULL if nobody matches.
+ */
+struct Audience* client_state_audience(int state);
+
+
 // ------------------------------------------------------------
 //  Thread entry point
 // ------------------------------------------------------------
@@ -94,7 +231,8 @@ void* client_thread(void* arg);
 // ------------------------------------------------------------
 //  Global client registry
 // ------------------------------------------------------------
-extern struct Client* g_clients[MAX_CLIENTS];
+extern struct Client** g_clients;   // g_client_cap slots, NULL = free
+extern int g_client_cap;
 extern pthread_mutex_t g_clients_mtx;
 
 #endif
@@ -6,8 +6,19 @@
 //  ------------------------------------------------------------
 //  Provides configuration file loading for server parameters.
 //  Supports simple KEY=VALUE format with fallback to defaults.
+//
+//  The active configuration is an immutable snapshot behind an
+//  atomic pointer. SIGHUP loads and validates a fresh snapshot
+//  and swaps the pointer; readers never see a half-written one.
+//  Retired snapshots are freed after CONFIG_RETIRE_MS, so a
+//  pointer from config_get() is only good for the call at hand;
+//  code that runs longer copies the fields it needs.
 // ============================================================
 
+#include <stddef.h>
+
+#define CONFIG_RETIRE_MS 60000
+
 /**
  * @struct ServerConfig
  * @brief Holds runtime configuration parameters loaded from file.
@@ -18,13 +29,70 @@ typedef struct {
     int max_clients;        ///< Maximum number of concurrent clients (default: 128)
     char bind_address[32];  ///< IP address to bind (default: "0.0.0.0")
     int disconnect_grace;   ///< Seconds to wait before declaring win after disconnect (default: 15)
+    int fanout_workers;     ///< Threads delivering spectator events (default: 2)
+    int invite_ttl;         ///< Seconds a private room invite code stays valid (default: 600)
+    int series_pause_ms;    ///< Pause between games of a best-of-N series (default: 1500)
+    char friends_file[128]; ///< Persisted friend lists (default: "friends.db")
+    char admin_token[64];   ///< Secret for ##ADMIN| commands (default: "" = disabled)
+    int workers;            ///< Worker processes sharing the port (default: 1 = no forking)
+    int drain_timeout;      ///< Seconds a drain waits for running games (default: 300)
+    int room_id_base;       ///< First room ID; distinct range per backend behind a router (default: 0)
+    char listen_unix[108];  ///< AF_UNIX socket path accepted alongside TCP (default: "" = none)
+    int prealloc_clients;   ///< Client structs pre-faulted at start-up (default: 0)
+    int prealloc_rooms;     ///< Room structs pre-faulted at start-up (default: 0)
+    char ready_file[128];   ///< Holds the pid while the server is ready (default: "" = none)
+    int overload_lag_ms;    ///< Timer lateness that starts shedding work (default: 100, 0 = off)
+    int overload_queue;     ///< Fan-out backlog that starts shedding work (default: 1000, 0 = off)
+    int rebalance_ms;       ///< Interval of worker load rebalancing (default: 5000, 0 = off)
+    int rate_client;        ///< Lines per second a client may send (default: 20, 0 = off)
+    int rate_ip;            ///< Lines per second per source address (default: 200, 0 = off;
+                            ///< use 0 behind the router, which is the source of every line)
+    int conn_per_ip;        ///< Open connections per IPv4 address (default: 16, 0 = off)
+    int conn_per_net24;     ///< Open connections per /24 network (default: 64, 0 = off)
 } ServerConfig;
 
-// Global configuration instance loaded at startup.
-extern ServerConfig g_config;
+/**
+ * @brief Returns the active configuration snapshot.
+ *
+ * The snapshot must not be modified. Fetch it again for every
+ * decision instead of caching the pointer across blocking calls.
+ */
+const ServerConfig* config_get(void);
+
+/**
+ * @brief Publishes a new snapshot (a copy of cfg).
+ *
+ * The previous snapshot is freed by the timer wheel after
+ * CONFIG_RETIRE_MS.
+ */
+void config_publish(const ServerConfig* cfg);
+
+/**
+ * @brief Checks a loaded configuration for values the server cannot run with.
+ * @param cfg  Configuration to check.
+ * @param err  Receives a description of the first problem.
+ * @param cap  Capacity of err.
+ * @return 1 if usable, 0 otherwise.
+ */
+int config_validate(const ServerConfig* cfg, char* err, size_t cap);
+
+/**
+ * @brief Re-reads the file, validates it and publishes it (SIGHUP).
+ *
+ * Keys that only take effect at start-up (PORT, BIND_ADDRESS,
+ * WORKERS, FANOUT_WORKERS, FRIENDS_FILE, ROOM_ID_BASE, LISTEN_UNIX,
+ * PREALLOC_CLIENTS, PREALLOC_ROOMS, READY_FILE) keep their running
+ * value; a change is logged. An unreadable or invalid file changes nothing.
+ *
+ * @param filename Path to the configuration file.
+ * @return 1 if a new snapshot was published, 0 otherwise.
+ */
+int config_reload(const char* filename);
 
 /**
  * @brief Loads server configuration from a file.
+ *
+ * Only fills cfg; config_publish() makes it active.
  * 
  * Parses a simple KEY=VALUE format configuration file. If the file
  * does not exist or any key is missing, default values are used:
@@ -32,10 +100,26 @@ extern ServerConfig g_config;
  *   - max_rooms: 16
  *   - max_clients: 128
  *   - bind_address: "0.0.0.0"
+ *   - fanout_workers: 2
+ *   - invite_ttl: 600
+ *   - series_pause_ms: 1500
+ *   - friends_file: "friends.db"
+ *   - admin_token: "" (admin commands disabled)
+ *   - workers: 1
+ *   - drain_timeout: 300
+ *   - room_id_base: 0
+ *   - listen_unix: "" (TCP only)
+ *   - prealloc_clients / prealloc_rooms: 0 (allocate on demand)
+ *   - ready_file: "" (none)
+ *   - overload_lag_ms: 100, overload_queue: 1000
+ *   - rebalance_ms: 5000
+ *   - rate_client: 20, rate_ip: 200
+ *   - conn_per_ip: 16, conn_per_net24: 64
  * 
  * @param filename Path to the configuration file (e.g., "server.config").
  * @param cfg      Pointer to ServerConfig struct to populate.
+ * @return 1 if the file was read, 0 if only defaults were set.
  */
-void config_load(const char* filename, ServerConfig* cfg);
+int config_load(const char* filename, ServerConfig* cfg);
 
 #endif // CONFIG_H
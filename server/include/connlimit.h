@@ -0,0 +1,49 @@
+#ifndef CONNLIMIT_H
+#define CONNLIMIT_H
+
+// ============================================================
+//  CONNECTION LIMIT MODULE HEADER
+//  ------------------------------------------------------------
+//  Caps the connections one host, and one /24 network, may hold
+//  open on this process, so a single source cannot fill the
+//  client registry:
+//   - CONN_PER_IP      per IPv4 address   (default 16, 0 = off)
+//   - CONN_PER_NET24   per /24 network    (default 64, 0 = off)
+//
+//  The accept loop asks before it creates anything: a refused
+//  connection gets ERROR|Too many connections from your address
+//  and is closed, without a Client or a thread.
+//
+//  Counts live in two open-addressing tables (linear probing,
+//  backward-shift deletion, no tombstones) keyed by address and
+//  by network. Each holds at most MAX_CLIENTS keys in
+//  CONN_SLOTS slots. AF_UNIX connections (address 0) are never
+//  counted. In multi-process mode each worker counts the
+//  connections it holds.
+// ============================================================
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CONN_SLOTS 2048         // Slots per table (power of two, >= 2 * MAX_CLIENTS)
+
+/**
+ * @brief Admits a new connection from @p ip unless a cap is reached,
+ *        counting it; refusals are counted in the stats.
+ * @param ip  IPv4 address in host order (0 = AF_UNIX, always admitted).
+ * @return true if admitted (release it with conn_release()).
+ */
+bool conn_admit(uint32_t ip);
+
+/**
+ * @brief Counts a connection without checking the caps (clients taken
+ *        over from another process, which are already connected).
+ */
+void conn_track(uint32_t ip);
+
+/**
+ * @brief Forgets one connection counted by conn_admit()/conn_track().
+ */
+void conn_release(uint32_t ip);
+
+#endif // CONNLIMIT_H
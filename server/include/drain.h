@@ -0,0 +1,72 @@
+#ifndef DRAIN_H
+#define DRAIN_H
+
+// ============================================================
+//  DRAIN MODULE HEADER
+//  ------------------------------------------------------------
+//  Graceful shutdown for maintenance. Triggered by SIGQUIT or
+//  ##ADMIN|<token>|DRAIN[|<seconds>].
+//
+//  While draining:
+//   - the listening sockets are shut down (no new connections;
+//     in multi-process mode the other workers take them)
+//   - no new rooms, joins, rematches or quick-match entries
+//   - lobby clients get DRAINING|<seconds left> once, telling
+//     them to reconnect elsewhere
+//   - running games finish normally; a room is closed as soon
+//     as its game is over (series and bot rematches included)
+//
+//  The process exits once no room is left or the deadline
+//  (DRAIN_TIMEOUT, default 300 s) passes; rooms still open
+//  then are closed. Progress is logged every few seconds and
+//  reported by ##ADMIN|<token>|DRAIN_STATUS.
+// ============================================================
+
+#include <stdbool.h>
+
+#define DRAIN_TICK_MS   1000    // Room / client check interval
+#define DRAIN_LOG_EVERY 5       // Ticks between progress log lines
+
+/**
+ * @struct DrainStatus
+ * @brief Snapshot of the drain progress.
+ */
+typedef struct {
+    bool active;        ///< Drain started
+    int  rooms;         ///< Rooms still open
+    int  clients;       ///< Connected clients (bots excluded)
+    long seconds_left;  ///< Until the deadline (0 if not draining)
+} DrainStatus;
+
+/**
+ * @brief Remembers the listening sockets; called by the accept thread.
+ * @param listen_fd  Socket shut down when the drain starts.
+ * @param unix_fd    LISTEN_UNIX socket shut down as well, -1 if none or
+ *                   shared with other workers.
+ */
+void drain_init(int listen_fd, int unix_fd);
+
+/**
+ * @brief Starts draining (no-op if already draining).
+ * @param deadline_s  Seconds to wait for running games; <= 0 uses DRAIN_TIMEOUT.
+ * @return 1 if the drain was started by this call, 0 otherwise.
+ */
+int drain_start(int deadline_s);
+
+/**
+ * @brief True once a drain was started.
+ */
+bool drain_active(void);
+
+/**
+ * @brief Fills the current drain progress.
+ */
+void drain_status(DrainStatus* out);
+
+/**
+ * @brief Blocks until the drain is complete (no rooms left or deadline).
+ *        Called by the accept thread after the listener was shut down.
+ */
+void drain_wait(void);
+
+#endif // DRAIN_H
@@ -0,0 +1,182 @@
+#ifndef FANOUT_H
+#define FANOUT_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+// ============================================================
+//  FANOUT MODULE HEADER
+//  ------------------------------------------------------------
+//  Delivers one encoded protocol message to many receivers
+//  (room spectators, lobby chat) from dedicated worker threads,
+//  so that gameplay sends never wait for the audience.
+//
+//  Responsibilities:
+//   - Encoding a message once into a shared, refcounted buffer
+//   - Keeping each room's audience as a copy-on-write snapshot
+//   - Queueing delivery jobs per worker (sharded by room ID)
+//   - Non-blocking delivery: a spectator that cannot take an event
+//     is disconnected (it would desync), lobby receivers drop it
+// ============================================================
+
+#define FANOUT_MAX_WORKERS 8
+#define FANOUT_BATCH       1024  // Receivers per broadcast job
+
+struct Client;
+struct Room;
+
+
+// ------------------------------------------------------------
+//  Shared encoded message
+// ------------------------------------------------------------
+/**
+ * @struct SharedMsg
+ * @brief Refcounted, already framed ("##...\n") protocol message.
+ */
+typedef struct SharedMsg {
+    atomic_int refs;    ///< Reference count
+    size_t len;         ///< Length of data in bytes
+    char data[];        ///< Framed message bytes
+} SharedMsg;
+
+/**
+ * @brief Encodes a message the same way sendp() does.
+ * @param fmt Format string (printf-like), without "##" prefix.
+ * @return New message with one reference, or NULL on failure.
+ */
+SharedMsg* shared_msg_create(const char* fmt, ...);
+
+/**
+ * @brief Drops one reference; frees the buffer on the last one.
+ * @param m Message (NULL is ignored).
+ */
+void shared_msg_release(SharedMsg* m);
+
+
+// ------------------------------------------------------------
+//  Audience (held receiver set)
+// ------------------------------------------------------------
+/**
+ * @struct Audience
+ * @brief Immutable, refcounted set of receivers (a room's spectators,
+ *        the lobby at delivery time).
+ *
+ * Changes publish a new copy (writers hold g_rooms_mtx); a queued
+ * event keeps the copy current when it was published, so workers
+ * never take the rooms lock. Members are held (client_hold), so a
+ * socket cannot be closed and reused while an event is in flight.
+ */
+typedef struct Audience {
+    atomic_int refs;            ///< Reference count
+    int n;                      ///< Number of members
+    struct Client* members[];   ///< Held spectators
+} Audience;
+
+/**
+ * @brief Allocates an empty audience with room for @p cap members.
+ * @return New audience with one reference, or NULL if out of memory.
+ */
+Audience* audience_alloc(int cap);
+
+/**
+ * @brief Holds @p c and appends it to an audience that is still being
+ *        built (not yet shared; fewer than cap members).
+ */
+void audience_push(Audience* a, struct Client* c);
+
+/**
+ * @brief Replaces *slot with a copy that also contains @p c.
+ * @return 1 on success, 0 if out of memory (*slot unchanged).
+ */
+int audience_add(Audience** slot, struct Client* c);
+
+/**
+ * @brief Replaces *slot with a copy without @p c (NULL once empty).
+ *
+ * If the copy cannot be allocated, @p c stays in the audience until
+ * the room goes away.
+ */
+void audience_remove(Audience** slot, const struct Client* c);
+
+/**
+ * @brief Drops one reference; the last one releases the members.
+ * @param a Audience (NULL is ignored).
+ */
+void audience_release(Audience* a);
+
+
+// ------------------------------------------------------------
+//  Worker management
+// ------------------------------------------------------------
+/**
+ * @brief Starts the fan-out worker threads.
+ * @param workers Number of workers (clamped to 1..FANOUT_MAX_WORKERS).
+ */
+void fanout_start(int workers);
+
+/**
+ * @brief Jobs queued or being delivered, over all workers.
+ */
+int fanout_pending(void);
+
+
+// ------------------------------------------------------------
+//  Publishing
+// ------------------------------------------------------------
+/**
+ * @brief Queues a message for every spectator of a room.
+ *
+ * Takes a reference on the room's current audience (expects
+ * g_rooms_mtx held), so the caller pays only for encoding and one
+ * queue push; nothing is queued for a room without spectators.
+ *
+ * @param r   Target room.
+ * @param fmt Format string (printf-like).
+ */
+void fanout_room(const struct Room* r, const char* fmt, ...);
+
+/**
+ * @brief Queues already framed bytes (a spectator snapshot) for one
+ *        client on the room's worker (expects g_rooms_mtx held).
+ *
+ * Events published for the room afterwards are delivered after it.
+ *
+ * @param r     Room the snapshot belongs to.
+ * @param c     Receiving client.
+ * @param data  Framed protocol lines.
+ * @param len   Length of @p data.
+ */
+void fanout_snapshot(const struct Room* r, struct Client* c, const char* data, size_t len);
+
+/**
+ * @brief Queues a message for every client currently in the lobby.
+ * @param fmt Format string (printf-like).
+ */
+void fanout_lobby(const char* fmt, ...);
+
+/**
+ * @brief Queues a message for an explicit set of held clients.
+ *
+ * Receivers whose socket buffer is full miss the message, as in the
+ * lobby. Takes over the caller's reference on @p a.
+ *
+ * @param shard Sharding key, keeps the order of one sender's messages.
+ * @param a     Held receivers (NULL is ignored).
+ * @param fmt   Format string (printf-like).
+ */
+void fanout_clients(int shard, Audience* a, const char* fmt, ...);
+
+/**
+ * @brief Queues a message for a large receiver set, spread over all workers.
+ *
+ * The set is cut into FANOUT_BATCH-sized jobs sharing one encoded
+ * buffer and the audience; each worker's jobs are linked up front and
+ * appended with a single lock round-trip. No ordering with room
+ * traffic is kept. Takes over the caller's reference on @p a.
+ *
+ * @param a    Held receivers (NULL is ignored).
+ * @param fmt  Format string (printf-like).
+ */
+void fanout_broadcast(Audience* a, const char* fmt, ...);
+
+#endif // FANOUT_H
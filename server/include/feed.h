@@ -0,0 +1,49 @@
+#ifndef FEED_H
+#define FEED_H
+
+// ============================================================
+//  FEED MODULE HEADER
+//  ------------------------------------------------------------
+//  Push feed of room changes for front routers (see router.c).
+//  A connection subscribes with ##ADMIN|<token>|FEED and gets
+//  a snapshot of all rooms, then every change as it happens:
+//
+//    FEED|ROOM|<id>|<WAITING/PLAYING>|<players>|<private>|<code>|<p1>|<p2>|<name>
+//    FEED|GONE|<id>
+//
+//  Private rooms are included (with their invite code), so the
+//  feed is admin-only.
+// ============================================================
+
+#define FEED_MAX_SUBSCRIBERS 4
+
+struct Client;
+struct Room;
+
+/**
+ * @brief Adds a subscriber and sends it the current rooms.
+ * @return 1 on success, 0 if all subscriber slots are taken.
+ */
+int feed_subscribe(struct Client* c);
+
+/**
+ * @brief Removes a subscriber (connection closed). Unknown clients are ignored.
+ */
+void feed_unsubscribe(struct Client* c);
+
+/**
+ * @brief True if the client is a subscriber (live upgrade, see upgrade.h).
+ */
+int feed_is_subscribed(const struct Client* c);
+
+/**
+ * @brief Publishes the state of a room (expects g_rooms_mtx held).
+ */
+void feed_room(const struct Room* r);
+
+/**
+ * @brief Publishes the removal of a room (expects g_rooms_mtx held).
+ */
+void feed_gone(int room_id);
+
+#endif // FEED_H
@@ -0,0 +1,52 @@
+#ifndef INVITE_H
+#define INVITE_H
+
+// ============================================================
+//  INVITE MODULE HEADER
+//  ------------------------------------------------------------
+//  Invite codes of private rooms. Codes are kept in an open-
+//  addressing hash table (code -> room ID), so ##JOINCODE| is an
+//  O(1) lookup and private rooms never need to be listed. Each
+//  code expires after its TTL (timer wheel + lazy check).
+// ============================================================
+
+#define INVITE_CODE_LEN 6   // Characters per code
+
+/**
+ * @brief Creates a fresh code for a room.
+ * @param room_id  Room the code opens.
+ * @param ttl_ms   Lifetime of the code.
+ * @param out      Output buffer (at least INVITE_CODE_LEN + 1 bytes).
+ * @return 1 on success, 0 if no code could be allocated.
+ */
+int invite_create(int room_id, long ttl_ms, char* out);
+
+/**
+ * @brief Resolves a code.
+ * @param code  Code as typed by the player (case-insensitive).
+ * @return Room ID, or -1 for unknown / expired codes.
+ */
+int invite_lookup(const char* code);
+
+/**
+ * @brief Removes a code (room closed). Unknown codes are ignored.
+ * @param code  Code to remove.
+ */
+void invite_remove(const char* code);
+
+/**
+ * @brief Re-registers an existing code (live upgrade, see upgrade.h).
+ * @param code    Code as issued by invite_create().
+ * @param room_id Room the code opens.
+ * @param ttl_ms  Remaining lifetime.
+ * @return 1 on success, 0 if the code is taken or no slot is left.
+ */
+int invite_restore(const char* code, int room_id, long ttl_ms);
+
+/**
+ * @brief Remaining lifetime of a code.
+ * @return Milliseconds until expiry, 0 for unknown / expired codes.
+ */
+long invite_ttl_left(const char* code);
+
+#endif // INVITE_H
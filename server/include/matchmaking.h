@@ -0,0 +1,73 @@
+#ifndef MATCHMAKING_H
+#define MATCHMAKING_H
+
+// ============================================================
+//  MATCHMAKING MODULE HEADER
+//  ------------------------------------------------------------
+//  Skill-bucketed quick-match queue.
+//
+//  Responsibilities:
+//   - Keeping queued players in per-rating FIFO buckets
+//   - Pairing on enqueue (own bucket, O(1))
+//   - Widening the accepted rating spread over time (matcher thread)
+//   - Placing pairs into a new room via room_create / room_join,
+//     outside of the queue lock
+//   - Updating Elo ratings after finished games
+// ============================================================
+
+#define RATING_DEFAULT       1200   // Initial rating of every player
+#define RATING_BUCKET_WIDTH  100    // Rating span of one queue bucket
+#define MM_BUCKETS           40     // Buckets cover ratings 0..3999
+#define MM_WIDEN_SECONDS     5      // Spread grows by one bucket per 5 s waited
+#define MM_MAX_SPREAD        5      // At most +-5 buckets (500 rating points)
+
+struct Client;
+
+/**
+ * @struct QueueEntry
+ * @brief Position of a client in the quick-match queue.
+ */
+typedef struct QueueEntry {
+    struct QueueEntry* prev;
+    struct QueueEntry* next;
+    struct Client* client;
+    int bucket;                 ///< Bucket index the entry lives in
+    long long enqueued_ms;      ///< Monotonic enqueue timestamp
+} QueueEntry;
+
+
+/**
+ * @brief Starts the matcher thread that widens buckets over time.
+ */
+void mm_start(void);
+
+/**
+ * @brief Adds a lobby client to the queue (##QUEUE|).
+ *
+ * Pairs immediately with the oldest player in the same bucket.
+ *
+ * @param c Client to enqueue.
+ */
+void mm_enqueue(struct Client* c);
+
+/**
+ * @brief Removes a client from the queue (##UNQUEUE|, disconnect).
+ * @param c      Client to remove.
+ * @param notify If non-zero, sends UNQUEUED| to the client.
+ */
+void mm_dequeue(struct Client* c, int notify);
+
+/**
+ * @brief Applies an Elo update after a finished game.
+ * @param a      First player.
+ * @param b      Second player.
+ * @param result 1 = a won, -1 = b won, 0 = draw.
+ */
+void mm_rate_result(struct Client* a, struct Client* b, int result);
+
+/**
+ * @brief Reads a client's rating (written by mm_rate_result()).
+ */
+int mm_rating(const struct Client* c);
+
+#endif // MATCHMAKING_H
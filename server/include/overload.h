@@ -0,0 +1,49 @@
+#ifndef OVERLOAD_H
+#define OVERLOAD_H
+
+// ============================================================
+//  OVERLOAD MODULE HEADER
+//  ------------------------------------------------------------
+//  Sheds low-value work when the server falls behind, so that
+//  moves and clocks of running games keep their latency.
+//
+//  Every OVERLOAD_TICK_MS the controller samples:
+//   - dispatch lag: how late the timer wheel fires (clocks,
+//     bot moves and series all run there), see timer_lag_ms()
+//   - queue depth: fan-out jobs waiting, see fanout_pending()
+//
+//  Each signal is compared with its threshold (OVERLOAD_LAG_MS,
+//  OVERLOAD_QUEUE; 0 turns it off). 1x, 2x and 4x the threshold
+//  select level 1, 2 and 3; each level keeps the shedding of
+//  the ones below:
+//
+//    1  ##LIST| answered from a cache (OVERLOAD_LIST_CACHE_MS),
+//       bot moves deferred by OVERLOAD_BOT_DELAY_MS
+//    2  PING only every other heartbeat
+//    3  new connections refused (ERROR|Server busy)
+//
+//  The level goes up at once and down one step after
+//  OVERLOAD_CALM_TICKS calm samples. It is exported as the
+//  overload_level gauge (##STATS|), next to the two signals.
+// ============================================================
+
+#define OVERLOAD_TICK_MS        250     // Sampling interval
+#define OVERLOAD_CALM_TICKS     8       // Calm samples before stepping down
+#define OVERLOAD_LIST_CACHE_MS  1000    // Age of a cached ##LIST| reply
+#define OVERLOAD_BOT_DELAY_MS   1000    // Extra bot think time
+
+#define OVERLOAD_LIST_CACHED    1       // Level: cached LIST, slower bots
+#define OVERLOAD_SLOW_PING      2       // Level: PING every other heartbeat
+#define OVERLOAD_REFUSE         3       // Level: no new connections
+
+/**
+ * @brief Starts sampling (needs the timer wheel and fan-out running).
+ */
+void overload_start(void);
+
+/**
+ * @brief Current shedding level, 0 when not overloaded.
+ */
+int overload_level(void);
+
+#endif // OVERLOAD_H
@@ -0,0 +1,72 @@
+#ifndef PRESENCE_H
+#define PRESENCE_H
+
+// ============================================================
+//  PRESENCE MODULE HEADER
+//  ------------------------------------------------------------
+//  Friend lists (persisted to FRIENDS_FILE) and presence events.
+//
+//  Every known user has a subscriber list: the users who have
+//  them as a friend. A state change marks the user dirty; a short
+//  timer then publishes only the latest state of every dirty user
+//  to its online subscribers through the fan-out workers. Nothing
+//  ever scans g_clients.
+//
+//  Protocol:
+//   ##FRIEND|ADD|name   -> FRIEND_ADDED|name + PRESENCE|name|...
+//                          (ERROR|Unknown user unless name is online
+//                          or already on a friend list)
+//   ##FRIEND|DEL|name   -> FRIEND_REMOVED|name
+//   ##FRIEND|LIST|      -> FRIEND|name|state... + FRIENDS_END|count
+//   pushed:  PRESENCE|name|OFFLINE / LOBBY / WAITING|room / PLAYING|room
+// ============================================================
+
+#define PRESENCE_FLUSH_MS 100   // Coalescing window for presence events
+#define FRIENDS_MAX       100   // Friend list size limit per user
+
+struct Client;
+
+/**
+ * @enum PresenceState
+ * @brief What a user's friends see.
+ */
+typedef enum {
+    PRES_OFFLINE = 0,
+    PRES_LOBBY,
+    PRES_WAITING,       ///< In a room, waiting for an opponent
+    PRES_PLAYING
+} PresenceState;
+
+/**
+ * @brief Loads the persisted friend lists.
+ * @param path Friends file (one "user<TAB>friend" pair per line).
+ */
+void presence_start(const char* path);
+
+/**
+ * @brief Publishes a client's new state (bots and unnamed clients are ignored).
+ *
+ * Any state other than PRES_OFFLINE also registers (and holds) the
+ * client as the user's online connection. Names are not unique: while
+ * a connection of another session owns the name, the call is ignored.
+ * Safe to call with g_rooms_mtx held.
+ *
+ * @param c        Client whose state changed.
+ * @param st       New state.
+ * @param room_id  Room for PRES_WAITING / PRES_PLAYING, -1 otherwise.
+ */
+void presence_set(struct Client* c, PresenceState st, int room_id);
+
+/**
+ * @brief Marks the user offline if c is their registered connection.
+ */
+void presence_offline(struct Client* c);
+
+/**
+ * @brief Handles a ##FRIEND| command.
+ * @param c        Sender.
+ * @param payload  Text after "##FRIEND|".
+ */
+void friend_command(struct Client* c, const char* payload);
+
+#endif // PRESENCE_H
@@ -0,0 +1,55 @@
+#ifndef PUBSUB_H
+#define PUBSUB_H
+
+// ============================================================
+//  PUBSUB MODULE HEADER
+//  ------------------------------------------------------------
+//  Topic-based publishing on top of the fan-out workers.
+//
+//  Topics:
+//   - ALL               every named client
+//   - LOBBY             clients outside rooms (not spectating)
+//   - WAITING/PLAYING   clients in a room in that state
+//   - ROOM:<id>         players and spectators of one room
+//
+//  Subscribers are resolved with a short snapshot copy under the
+//  owning module's lock; encoding happens once and delivery is
+//  spread over all fan-out workers.
+// ============================================================
+
+/**
+ * @enum TopicKind
+ * @brief Audience of a published message.
+ */
+typedef enum {
+    TOPIC_GLOBAL = 0,
+    TOPIC_LOBBY,
+    TOPIC_WAITING,
+    TOPIC_PLAYING,
+    TOPIC_ROOM
+} TopicKind;
+
+/**
+ * @struct Topic
+ * @brief Parsed topic (room_id is used by TOPIC_ROOM only).
+ */
+typedef struct {
+    TopicKind kind;
+    int room_id;
+} Topic;
+
+/**
+ * @brief Parses a topic name ("ALL", "LOBBY", "ROOM:3", ...).
+ * @return 1 on success, 0 for an unknown topic.
+ */
+int pubsub_parse(const char* s, Topic* out);
+
+/**
+ * @brief Publishes one message to every subscriber of a topic.
+ * @param t    Topic.
+ * @param fmt  Format string (printf-like), without "##" prefix.
+ * @return Number of receivers the message was queued for.
+ */
+int pubsub_publish(const Topic* t, const char* fmt, ...);
+
+#endif // PUBSUB_H
@@ -0,0 +1,112 @@
+#ifndef RATELIMIT_H
+#define RATELIMIT_H
+
+// ============================================================
+//  RATE LIMIT MODULE HEADER
+//  ------------------------------------------------------------
+//  Token bucket used to cap how often a client may do something
+//  (chat messages, commands). Not thread-safe by itself; each
+//  bucket must be owned by one thread or guarded by its owner.
+//
+//  Command limiter: every line a client sends is checked before
+//  it is dispatched, against
+//   - the client's bucket (RATE_CLIENT lines/s, 0 = off)
+//   - the bucket of its command class (RL_*_RATE below; ##LIST|
+//     and friends are the expensive ones; see validate.c for
+//     which command is in which class)
+//   - the bucket of its IPv4 source address (RATE_IP lines/s,
+//     0 = off), shared by all connections from that address;
+//     AF_UNIX connections have none
+//  A line over any limit is dropped (ERROR|Rate limited, at most
+//  once per second). Drops drain a strike bucket; a client that
+//  keeps flooding once it is empty is disconnected.
+// ============================================================
+
+#include <stdint.h>
+
+/**
+ * @struct TokenBucket
+ * @brief Refilling token budget.
+ */
+typedef struct {
+    double tokens;          ///< Currently available tokens
+    long long last_ms;      ///< Monotonic time of the last refill
+} TokenBucket;
+
+/**
+ * @brief Fills the bucket to its burst size.
+ * @param tb    Bucket.
+ * @param burst Maximum number of tokens.
+ */
+void tb_init(TokenBucket* tb, double burst);
+
+/**
+ * @brief Refills the bucket and tries to take tokens.
+ * @param tb    Bucket.
+ * @param rate  Refill rate in tokens per second.
+ * @param burst Maximum number of tokens.
+ * @param cost  Tokens needed.
+ * @return 1 if the tokens were taken, 0 if the bucket is too empty.
+ */
+int tb_take(TokenBucket* tb, double rate, double burst, double cost);
+
+
+// ------------------------------------------------------------
+//  Command limiter
+// ------------------------------------------------------------
+#define RL_BURST_FACTOR  2.0    // Burst = rate * factor
+#define RL_GAME_RATE     10.0   // MOVE, REPLAY, PING/PONG, EXIT, QUIT
+#define RL_ROOM_RATE     2.0    // JOIN, CREATE, JOINROOM, SPECTATE, QUEUE...
+#define RL_QUERY_RATE    2.0    // LIST, STATS, HEALTH, TOURNEY, FRIEND
+#define RL_OTHER_RATE    5.0    // CHAT (has its own limit too), ADMIN, unknown
+#define RL_STRIKE_RATE   1.0    // Drops forgiven per second
+#define RL_STRIKE_BURST  30.0   // Drops tolerated before a disconnect
+#define RL_NOTICE_MS     1000   // Minimum gap between two ERROR|Rate limited
+#define RL_IP_SLOTS      4096   // Per-address buckets (power of two)
+
+typedef enum {
+    RL_GAME = 0,
+    RL_ROOM,
+    RL_QUERY,
+    RL_OTHER,
+    RL_CLASS_COUNT
+} RateClass;
+
+typedef enum {
+    RL_PASS = 0,            ///< Dispatch the line
+    RL_DROP,                ///< Ignore the line
+    RL_KICK                 ///< Disconnect the client
+} RateVerdict;
+
+/**
+ * @struct CmdLimiter
+ * @brief Per-client state of the command limiter (client thread only).
+ */
+typedef struct {
+    TokenBucket all;
+    TokenBucket cls[RL_CLASS_COUNT];
+    TokenBucket strikes;
+    long long notice_ms;    ///< Last ERROR|Rate limited sent
+} CmdLimiter;
+
+/**
+ * @brief Fills all buckets of a new client.
+ */
+void rl_init(CmdLimiter* l);
+
+/**
+ * @brief Checks one received line against the client, class and
+ *        address limits and counts drops and kicks.
+ * @param l    Limiter of the client.
+ * @param ip   IPv4 source address in host order, 0 for none.
+ * @param cls  Class of the line's command (from validate_line()).
+ * @return RL_PASS, RL_DROP or RL_KICK.
+ */
+RateVerdict rl_check(CmdLimiter* l, uint32_t ip, RateClass cls);
+
+/**
+ * @brief True if the caller should tell the client about a drop now.
+ */
+int rl_notice_due(CmdLimiter* l);
+
+#endif // RATELIMIT_H
@@ -0,0 +1,46 @@
+#ifndef READY_H
+#define READY_H
+
+// ============================================================
+//  READY MODULE HEADER
+//  ------------------------------------------------------------
+//  Readiness for the orchestrator. A process is ready once its
+//  listeners are open, the service threads run and the warm
+//  pools (PREALLOC_CLIENTS / PREALLOC_ROOMS) are filled; it
+//  stops being ready when a drain starts.
+//
+//  Two ways to ask:
+//   - ##HEALTH| (no login needed) answers
+//       HEALTH|READY|<ms from start to ready>
+//       HEALTH|STARTING   or   HEALTH|DRAINING
+//   - READY_FILE=<path>: the file holds the pid while ready
+//     (worker n of a multi-process server uses <path>.<n>)
+// ============================================================
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Marks the process ready; logs the time to ready and the
+ *        memory committed, and writes READY_FILE.
+ * @param boot_ms         now_ms() when the process started.
+ * @param prealloc_bytes  Bytes of the pre-faulted pools.
+ */
+void ready_mark(long long boot_ms, size_t prealloc_bytes);
+
+/**
+ * @brief No longer ready (drain); removes READY_FILE.
+ */
+void ready_clear(void);
+
+/**
+ * @brief True between ready_mark() and ready_clear().
+ */
+bool ready_get(void);
+
+/**
+ * @brief Answers ##HEALTH|.
+ */
+void ready_send(int fd);
+
+#endif // READY_H
@@ -0,0 +1,42 @@
+#ifndef REBALANCE_H
+#define REBALANCE_H
+
+// ============================================================
+//  REBALANCE MODULE HEADER
+//  ------------------------------------------------------------
+//  Multi-process mode only. SO_REUSEPORT spreads connections
+//  evenly when they arrive, but games end unevenly, so over
+//  time some workers keep many more clients than others.
+//
+//  Every REBALANCE_MS each worker publishes its load in the
+//  shard directory. The most loaded worker, when it is over
+//  REBALANCE_SLACK percent above the mean, moves idle lobby
+//  clients to the least loaded one:
+//
+//    1. the rebalancer picks clients that sent nothing for
+//       REBALANCE_IDLE_MS and can move (client_movable()),
+//       sets their migrate_to and wakes their thread (SIGUSR1)
+//    2. the client thread, at its next line boundary, checks
+//       again and hands the socket over (shard_handoff()); the
+//       player is not told, the other worker just carries on
+//
+//  Players in a room stay where the room is: clocks, seats and
+//  spectators cannot move with them. They become movable when
+//  their game is over.
+//
+//  Each round logs the worker loads before the move, the next
+//  round the loads after it.
+// ============================================================
+
+#define REBALANCE_IDLE_MS   2000    // Quiet time before a client may move
+#define REBALANCE_BATCH     32      // Most clients moved per round
+#define REBALANCE_SLACK     20      // Percent above the mean tolerated
+#define REBALANCE_OFF_MS    5000    // Re-check interval while REBALANCE_MS=0
+
+/**
+ * @brief Starts publishing the load and rebalancing (after the
+ *        timer wheel; no-op unless sharded).
+ */
+void rebalance_start(void);
+
+#endif // REBALANCE_H
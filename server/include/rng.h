@@ -0,0 +1,45 @@
+#ifndef RNG_H
+#define RNG_H
+
+// ============================================================
+//  RNG MODULE HEADER
+//  ------------------------------------------------------------
+//  Cryptographically secure random numbers for session tokens
+//  and invite codes (a reconnect token is enough to take over a
+//  seat, so it must not be guessable).
+//
+//  Every thread has its own ChaCha20 generator, keyed from
+//  getrandom() on first use: no lock and no system call per
+//  token. Output is produced RNG_BLOCKS blocks at a time; the
+//  first bytes of each batch rekey the generator and every byte
+//  handed out is wiped, so a later memory leak does not reveal
+//  earlier tokens. The key is refreshed from the kernel every
+//  RNG_RESEED_BYTES and in the child after fork().
+// ============================================================
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define RNG_BLOCKS        8             // ChaCha20 blocks per refill (64 bytes each)
+#define RNG_RESEED_BYTES  (1 << 20)     // Output between two getrandom() calls
+#define RNG_TOKEN_BITS    128
+#define RNG_TOKEN_LEN     22            // RNG_TOKEN_BITS in base64url, without padding
+
+/**
+ * @brief Fills out with n random bytes.
+ */
+void rng_bytes(void* out, size_t n);
+
+/**
+ * @brief Uniform random number in [0, n) (n > 0), without modulo bias.
+ */
+uint32_t rng_below(uint32_t n);
+
+/**
+ * @brief Writes a new 128-bit token as RNG_TOKEN_LEN base64url
+ *        characters (A-Z a-z 0-9 - _) plus NUL.
+ * @param cap  Size of out, at least RNG_TOKEN_LEN + 1.
+ */
+void rng_token(char* out, size_t cap);
+
+#endif // RNG_H
@@ -5,6 +5,7 @@
 #include <time.h>
 #include "client.h"
 #include "game.h"
+#include "timer.h"
 
 // ============================================================
 //  ROOM MODULE HEADER
@@ -17,13 +18,15 @@
 //   - Handling player disconnects / reconnects
 //   - Managing replay state and next-round logic
 //   - Tracking room lifecycle (WAITING, PLAYING, EMPTY)
+//   - Keeping the spectator list of each room
+//   - Running per-room move clocks (time controls)
 // ============================================================
 
 
 // ------------------------------------------------------------
 //  Constants and enums
 // ------------------------------------------------------------
-#define MAX_ROOMS 16
+#define MAX_ROOMS 1024  // Upper bound for MAX_ROOMS in server.config
 
 /**
  * @enum RoomState
@@ -36,6 +39,52 @@ typedef enum {
 } RoomState;
 
 
+/**
+ * @enum TimeControl
+ * @brief Clock mode chosen at room creation.
+ */
+typedef enum {
+    TC_NONE     = 0,    ///< No clock (default)
+    TC_PER_MOVE = 1,    ///< Fixed time for every single move
+    TC_FISCHER  = 2     ///< Base time per game + increment per move
+} TimeControl;
+
+/**
+ * @struct RoomOptions
+ * @brief Optional settings given after the name in ##CREATE|name|opt|...
+ *
+ * Recognized options:
+ *   - private           unlisted, joinable only by invite code
+ *   - bo3 / bo5 / bo7   best-of-N series with automatic next rounds
+ *   - bot=<s>           a server bot takes the free seat after <s> seconds
+ *   - move=<s>          per-move limit in seconds
+ *   - fischer=<s>+<i>   base seconds + increment seconds
+ */
+typedef struct {
+    bool is_private;    ///< Hidden from ROOMS| and spectating, joined by code
+    TimeControl tc;
+    int move_ms;        ///< TC_PER_MOVE: time per move
+    int base_ms;        ///< TC_FISCHER: starting time per player
+    int inc_ms;         ///< TC_FISCHER: added after each own move
+    int series_len;     ///< Best-of-N series length (0 = single games)
+    int bot_fill_ms;    ///< Seat a bot after this long without an opponent (0 = never)
+    int tourney_id;     ///< Owning tournament (0 = none, set by the server only)
+} RoomOptions;
+
+
+#define CHAT_MAX_LEN     160    // Longest accepted chat message
+#define CHAT_HISTORY_LEN 10     // Room chat lines kept for late joiners
+
+/**
+ * @struct ChatLine
+ * @brief One entry of a room's chat history ring.
+ */
+typedef struct {
+    char from[32];
+    char text[CHAT_MAX_LEN + 1];
+} ChatLine;
+
+
 // ------------------------------------------------------------
 //  Room structure
 // ------------------------------------------------------------
@@ -79,27 +128,93 @@ typedef struct Room {
     // Determines who starts the next round (0 = p1, 1 = p2)
     int starting_player;
 
+    // Creation options and the invite code of a private room
+    RoomOptions opts;
+    char invite_code[8];
+
+    // Time control (see room_clock_start / room_clock_stop)
+    int   clock_ms[2];          ///< Remaining time of p1 / p2 (game or current turn)
+    long long turn_started_ms;  ///< Monotonic start of the running turn
+    long  clock_seq;            ///< Invalidates flag-fall timers already in flight
+    TimerId clock_timer;        ///< Pending flag-fall timer (0 = clock stopped)
+
+    // Best-of-N series: score and the pre-built next-round messages
+    int   series_score[2];      ///< Games won by p1 / p2
+    bool  series_over;          ///< Series decided, further games are plain replays
+    long  series_seq;           ///< Invalidates next-round timers in flight
+    char  series_stage[2][384]; ///< Framed next-round block for p1 / p2
+    int   series_stage_len[2];
+
+    // Bot fill-in (see bot.h): waiting timer and the human queued for the seat
+    TimerId fill_timer;         ///< Pending fill timer (0 = none)
+    long  fill_seq;             ///< Invalidates fill timers in flight
+    long  bot_seq;              ///< Invalidates bot moves / yields in flight
+    char  bot_waiter[32];       ///< Session token of the human who asked for the bot's seat
+
+    // Spectators (copy-on-write snapshot, served by the fan-out workers)
+    struct Audience* audience;  ///< NULL while nobody watches
+
+    // Chat history ring (oldest entry at chat_head once full)
+    ChatLine chat[CHAT_HISTORY_LEN];
+    int chat_head;
+    int chat_count;
+
 } Room;
 
 
 // ------------------------------------------------------------
 //  Global data
 // ------------------------------------------------------------
-extern Room g_rooms[MAX_ROOMS];
+extern Room** g_rooms;          ///< g_room_count rooms (heap), g_room_cap slots
 extern int  g_room_count;
+extern int  g_room_cap;
+extern pthread_mutex_t g_rooms_mtx;
 
 
 // ------------------------------------------------------------
 //  Core management functions
 // ------------------------------------------------------------
 
+/**
+ * @brief Sets the size of the room table (start-up and config reload).
+ *
+ * Existing rooms are kept; the table never shrinks below them.
+ *
+ * @param cap  Wanted number of slots (normally MAX_ROOMS from the config).
+ * @return Resulting capacity.
+ */
+int room_pool_resize(int cap);
+
+/**
+ * @brief Pre-allocates and pre-faults n rooms (PREALLOC_ROOMS).
+ *        Call once at start-up; beyond n, rooms come from malloc.
+ * @return Bytes committed.
+ */
+size_t room_prealloc(int n);
+
+/**
+ * @brief Returns a zeroed Room for g_rooms (expects g_rooms_mtx held).
+ */
+Room* room_alloc(void);
+
 /**
  * @brief Creates a new room and assigns the creator as Player 1.
  * @param name     Name of the room.
  * @param creator  Pointer to the client who creates the room.
+ * @param opts     Room options (NULL = defaults).
  * @return Pointer to the newly created Room structure.
  */
-Room* room_create(const char* name, struct Client* creator);
+Room* room_create(const char* name, struct Client* creator, const RoomOptions* opts);
+
+/**
+ * @brief Splits a ##CREATE| payload ("name|opt|opt...") into name and options.
+ * @param payload   Payload after "##CREATE|".
+ * @param name      Output buffer for the room name.
+ * @param name_cap  Capacity of the name buffer.
+ * @param opts      Output options (defaults for anything not given).
+ * @return 1 on success, 0 if an option is malformed.
+ */
+int room_options_parse(const char* payload, char* name, size_t name_cap, RoomOptions* opts);
 
 /**
  * @brief Adds a player to an existing room (as Player 2).
@@ -109,6 +224,29 @@ Room* room_create(const char* name, struct Client* creator);
  */
 Room* room_join(int room_id, struct Client* joiner);
 
+/**
+ * @brief Joins a private room through its invite code.
+ * @param code    Invite code (case-insensitive).
+ * @param joiner  Pointer to the joining client.
+ * @return Pointer to the joined room, or NULL on error.
+ */
+Room* room_join_code(const char* code, struct Client* joiner);
+
+/**
+ * @brief Finds a room by ID (expects g_rooms_mtx held).
+ * @return Room pointer, valid only while the lock is held; NULL if none.
+ */
+Room* room_find_by_id(int id);
+
+/**
+ * @brief Plays a move in the client's room (takes the rooms lock).
+ * @param c  Moving client.
+ * @param x  X coordinate.
+ * @param y  Y coordinate.
+ * @return 1 if the move was valid, 0 otherwise.
+ */
+int room_move(struct Client* c, int x, int y);
+
 /**
  * @brief Removes a client from their current room.
  * @param c  The client leaving the room.
@@ -127,6 +265,67 @@ void room_remove_if_empty(Room* r);
  */
 void room_try_restart(Room* r);
 
+/**
+ * @brief Records a replay vote (takes the rooms lock). YES restarts
+ *        the game once both players agreed; NO sends the voter back
+ *        to the lobby and leaves the opponent waiting in the room.
+ * @param c    Voting client.
+ * @param yes  The vote.
+ * @return 0 if the client is not in a room.
+ */
+int room_replay(struct Client* c, bool yes);
+
+/**
+ * @brief Starts a new round without waiting for replay votes.
+ * @param room_id  Room ID.
+ */
+void room_rematch(int room_id);
+
+/**
+ * @brief Sends both players back to the lobby and removes the room.
+ * @param room_id  Room ID.
+ * @param reason   Text for the INFO| line sent to the players.
+ */
+void room_close(int room_id, const char* reason);
+
+/**
+ * @brief Drain mode: closes rooms without a running game (see drain.h).
+ * @param all     Close every room (drain deadline reached).
+ * @param reason  Text for the INFO| line sent to the players.
+ * @return Number of rooms still open.
+ */
+int room_drain_pass(bool all, const char* reason);
+
+/**
+ * @brief Common bookkeeping for every finished game (expects g_rooms_mtx held).
+ *
+ * Called after the result messages were sent, whatever ended the
+ * game (last move, flag-fall, opponent leaving or timing out).
+ *
+ * @param r       Room whose game ended.
+ * @param winner  Winning client, NULL for a draw.
+ */
+void room_game_over(Room* r, struct Client* winner);
+
+
+// ------------------------------------------------------------
+//  Move clocks (expect g_rooms_mtx held)
+// ------------------------------------------------------------
+
+/**
+ * @brief Starts the clock of the player on turn and arms the flag-fall timer.
+ *        No-op without time control, a finished game or a missing player.
+ * @param r  Pointer to the room.
+ */
+void room_clock_start(Room* r);
+
+/**
+ * @brief Stops the running clock and charges the elapsed time.
+ * @param r              Pointer to the room.
+ * @param add_increment  Non-zero after a completed move (Fischer increment).
+ */
+void room_clock_stop(Room* r, int add_increment);
+
 
 // ------------------------------------------------------------
 //  Reconnection logic
@@ -142,6 +341,52 @@ void room_try_restart(Room* r);
 Room* room_reconnect(const char* nick, const char* session, struct Client* newcomer);
 
 
+// ------------------------------------------------------------
+//  Spectators
+// ------------------------------------------------------------
+
+/**
+ * @brief Registers a client as spectator and sends it a board snapshot.
+ * @param room_id  ID of the room to watch.
+ * @param c        Spectating client (must not be in a room).
+ * @return Pointer to the watched room, or NULL on error.
+ */
+Room* room_spectate(int room_id, struct Client* c);
+
+/**
+ * @brief Adds a client to a room's audience without any messages
+ *        (expects g_rooms_mtx held).
+ * @return 1 on success, 0 if the audience cannot grow.
+ */
+int room_spectator_add(Room* r, struct Client* c);
+
+/**
+ * @brief Removes a client from the spectator list it is on (if any).
+ * @param c  Spectating client.
+ */
+void room_unspectate(struct Client* c);
+
+/**
+ * @brief Snapshots everybody in a room (players + spectators), each one held.
+ * @param room_id  Room ID.
+ * @return Audience with one reference, or NULL if the room is empty or gone.
+ */
+struct Audience* room_member_audience(int room_id);
+
+
+// ------------------------------------------------------------
+//  Chat
+// ------------------------------------------------------------
+
+/**
+ * @brief Posts a chat line into the room the client plays in or watches.
+ * @param c     Sender.
+ * @param text  Validated message text.
+ * @return 1 if delivered, 0 if the client is not in any room.
+ */
+int room_chat(struct Client* c, const char* text);
+
+
 // ------------------------------------------------------------
 //  Utility
 // ------------------------------------------------------------
@@ -169,4 +414,28 @@ void handle_disconnect(struct Client* c);
  */
 void rooms_prune_disconnected(int grace_seconds);
 
+
+// ------------------------------------------------------------
+//  Live upgrade (see upgrade.h)
+// ------------------------------------------------------------
+
+/**
+ * @brief ID the next created room gets (single-process mode).
+ */
+int room_next_id(void);
+
+/**
+ * @brief Continues room numbering of the previous process.
+ */
+void room_set_next_id(int id);
+
+/**
+ * @brief Re-arms the timers of a room rebuilt from upgrade data
+ *        (expects g_rooms_mtx held): the running clock, a pending
+ *        series round, bot moves / seat yields and the fill timer.
+ * @param r              Rebuilt room, players already linked.
+ * @param clock_left_ms  Time left for the player on turn (-1 = clock stopped).
+ */
+void room_resume(Room* r, long clock_left_ms);
+
 #endif // ROOM_H
@@ -0,0 +1,140 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <stdbool.h>
+
+// ============================================================
+//  SHARD MODULE HEADER
+//  ------------------------------------------------------------
+//  Multi-process mode (WORKERS > 1 in server.config).
+//
+//  The parent process forks N workers and only supervises them.
+//  Every worker binds the same port with SO_REUSEPORT, so the
+//  kernel spreads new connections across them, and runs the
+//  ordinary threaded server on its own memory.
+//
+//  Shared between the workers:
+//   - the load of each worker (see rebalance.h)
+//   - a room directory in shared memory (room ID -> owning
+//     worker, plus what ##LIST| and reconnects need)
+//   - one datagram socket per worker for handing over a client
+//     connection (SCM_RIGHTS) together with the command that
+//     needs the other worker
+//
+//  Everything else (lobby, chat, presence, quick match, tournaments)
+//  is per worker.
+// ============================================================
+
+#define SHARD_MAX_WORKERS 16
+#define SHARD_DIR_CAP     4096  // Directory slots (power of two)
+
+struct Client;
+
+/**
+ * @struct ShardRoom
+ * @brief Directory entry published by the owner of a room.
+ */
+typedef struct {
+    int  room_id;
+    int  owner;             ///< Worker index
+    int  players;           ///< Seated players (0..2)
+    bool waiting;           ///< ROOM_WAITING (else playing)
+    bool is_private;
+    char name[32];
+    char code[8];           ///< Invite code of a private room
+    char p1[32];            ///< Seat identities, kept while disconnected
+    char p2[32];
+} ShardRoom;
+
+/**
+ * @struct ShardLoad
+ * @brief Load a worker publishes for the rebalancer (see rebalance.h).
+ */
+typedef struct {
+    int clients;            ///< Connected clients
+    int movable;            ///< Of those, idle in the lobby
+} ShardLoad;
+
+/**
+ * @brief Forks the workers and supervises them (restarts crashed ones).
+ *
+ * Must be called before any thread is started. Returns only in the
+ * parent, on SIGINT/SIGTERM, after stopping the workers.
+ *
+ * @param workers      Number of worker processes (2..SHARD_MAX_WORKERS).
+ * @param worker_main  Entry point run in each worker; receives its index.
+ * @return Exit status for main().
+ */
+int shard_run(int workers, int (*worker_main)(int worker));
+
+/**
+ * @brief True inside a worker of the multi-process mode.
+ */
+bool shard_enabled(void);
+
+/**
+ * @brief Index of this worker (-1 when not sharded).
+ */
+int shard_self(void);
+
+/**
+ * @brief Allocates a cluster-wide room ID.
+ * @return New ID, or -1 when not sharded (caller uses its own counter).
+ */
+int shard_next_room_id(void);
+
+/**
+ * @brief Inserts or updates this worker's entry for a room.
+ */
+void shard_dir_put(const ShardRoom* e);
+
+/**
+ * @brief Removes a room from the directory.
+ */
+void shard_dir_remove(int room_id);
+
+/**
+ * @brief Owner lookups (-1 if unknown).
+ */
+int shard_owner_of_room(int room_id);
+int shard_owner_of_code(const char* code);
+int shard_owner_of_player(const char* name);
+
+/**
+ * @brief Copies up to @p cap public directory entries.
+ * @return Number of entries copied.
+ */
+int shard_dir_list(ShardRoom* out, int cap);
+
+/**
+ * @brief Publishes this worker's load.
+ */
+void shard_load_put(const ShardLoad* l);
+
+/**
+ * @brief Copies the load of every worker (dead workers read as 0).
+ * @param out  SHARD_MAX_WORKERS entries.
+ * @return Number of workers.
+ */
+int shard_loads(ShardLoad* out);
+
+/**
+ * @brief Starts the thread adopting clients handed over by other workers.
+ */
+void shard_start_receiver(void);
+
+/**
+ * @brief Passes a client's socket and identity to another worker.
+ *
+ * On success the receiving worker replays @p line for the client
+ * (nothing for ""); the caller must then drop its own Client
+ * without sending anything.
+ *
+ * @param c       Client to move (must not be in a room).
+ * @param worker  Target worker index.
+ * @param line    Command to replay on the target.
+ * @return 1 on success, 0 on failure.
+ */
+int shard_handoff(const struct Client* c, int worker, const char* line);
+
+#endif // SHARD_H
@@ -0,0 +1,63 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+// ============================================================
+//  SLAB MODULE HEADER
+//  ------------------------------------------------------------
+//  Fixed-size object pool carved out of one mapping made at
+//  start-up. The pages are pre-faulted (MAP_POPULATE), so the
+//  first connections and rooms after a deploy neither fault nor
+//  grow the allocator; freed objects go back on a free list.
+//
+//  A slab that was never filled, or has run dry, hands out
+//  calloc()ed objects instead, and slab_free() tells the two
+//  apart by address. Thread-safe (one leaf lock per slab).
+// ============================================================
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @struct Slab
+ * @brief Pool of equally sized objects.
+ */
+typedef struct {
+    const char* name;       ///< For log lines
+    size_t size;            ///< Object size (rounded up to pointer alignment)
+    char*  base;            ///< Pre-faulted objects, NULL until slab_fill()
+    int    count;           ///< Objects in base
+    void*  free_list;       ///< Next free object in base
+    int    free_count;
+    bool   dry_logged;      ///< "ran dry" logged once
+    pthread_mutex_t mtx;
+} Slab;
+
+/** Static initializer: an empty slab that only uses calloc(). */
+#define SLAB_INIT(label, objsize) \
+    { .name = (label), .size = (objsize), .mtx = PTHREAD_MUTEX_INITIALIZER }
+
+/**
+ * @brief Maps and pre-faults count objects. Call once at start-up,
+ *        before any slab_alloc().
+ * @return Bytes committed, 0 if count <= 0 or the mapping failed
+ *         (the slab then keeps using calloc()).
+ */
+size_t slab_fill(Slab* s, int count);
+
+/**
+ * @brief Returns a zeroed object, NULL if out of memory.
+ */
+void* slab_alloc(Slab* s);
+
+/**
+ * @brief Returns an object from slab_alloc(); NULL is ignored.
+ */
+void slab_free(Slab* s, void* p);
+
+/**
+ * @brief Objects currently on the free list.
+ */
+int slab_available(Slab* s);
+
+#endif // SLAB_H
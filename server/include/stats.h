@@ -0,0 +1,121 @@
+#ifndef STATS_H
+#define STATS_H
+
+// ============================================================
+//  STATS MODULE HEADER
+//  ------------------------------------------------------------
+//  Lock-free server metrics: monotonically increasing counters,
+//  gauges (current values) and latency histograms with
+//  power-of-two millisecond buckets.
+//
+//  Metrics are reported:
+//   - periodically to server.log (heartbeat thread)
+//   - on demand via the ##STATS| command
+// ============================================================
+
+/**
+ * @enum StatCounter
+ * @brief Monotonic event counters.
+ */
+typedef enum {
+    STAT_QUEUE_ENQUEUED = 0,    ///< Players entering the quick-match queue
+    STAT_QUEUE_MATCHED,         ///< Pairs placed into a room
+    STAT_QUEUE_CANCELLED,       ///< Players leaving the queue unmatched
+    STAT_FANOUT_DELIVERED,      ///< Fan-out messages fully written to a socket
+    STAT_FANOUT_DROPPED,        ///< Fan-out messages dropped (receiver too slow)
+    STAT_FANOUT_BYTES,          ///< Fan-out bytes delivered
+    STAT_CHAT_ROOM,             ///< Room chat messages accepted
+    STAT_CHAT_LOBBY,            ///< Lobby chat messages accepted
+    STAT_CHAT_DROP_RATE,        ///< Chat messages rejected by the rate limit
+    STAT_CHAT_DROP_LENGTH,      ///< Chat messages rejected as too long/empty
+    STAT_PRESENCE_EVENTS,       ///< Presence changes published to friends
+    STAT_PRESENCE_COALESCED,    ///< Presence changes folded into a pending one
+    STAT_PUBSUB_PUBLISHED,      ///< Messages published to a pub/sub topic
+    STAT_SHARD_HANDOFF_OUT,     ///< Clients passed to another worker process
+    STAT_SHARD_HANDOFF_IN,      ///< Clients adopted from another worker process
+    STAT_REJECT_FULL,           ///< Connections refused: MAX_CLIENTS reached
+    STAT_REJECT_FD_LIMIT,       ///< Connections refused: out of file descriptors
+    STAT_REJECT_NOMEM,          ///< Connections refused: no memory / thread
+    STAT_ACCEPT_BACKOFF,        ///< Accept loop pauses after a resource error
+    STAT_REJECT_OVERLOAD,       ///< Connections refused: overload shedding
+    STAT_LIST_CACHED,           ///< ##LIST| answered from the overload cache
+    STAT_REBALANCE_MOVED,       ///< Idle clients moved to a less loaded worker
+    STAT_RATE_DROP,             ///< Lines dropped by the command limiter
+    STAT_RATE_KICK,             ///< Clients disconnected for flooding
+    STAT_REJECT_PER_IP,         ///< Connections refused: CONN_PER_IP reached
+    STAT_REJECT_PER_NET,        ///< Connections refused: CONN_PER_NET24 reached
+    STAT_MALFORMED,             ///< Lines rejected before dispatch (see validate.h)
+    STAT_COUNTER_COUNT
+} StatCounter;
+
+/**
+ * @enum StatGauge
+ * @brief Values that go up and down; the last value set is reported.
+ */
+typedef enum {
+    GAUGE_OVERLOAD_LEVEL = 0,   ///< Current shedding level (see overload.h)
+    GAUGE_DISPATCH_LAG_MS,      ///< Timer wheel lateness, last sample
+    GAUGE_FANOUT_QUEUE,         ///< Fan-out jobs waiting, last sample
+    STAT_GAUGE_COUNT
+} StatGauge;
+
+/**
+ * @enum StatHist
+ * @brief Latency / duration histograms (values in milliseconds).
+ */
+typedef enum {
+    HIST_QUEUE_WAIT_MS = 0,     ///< Time from ##QUEUE| to match
+    HIST_TOURNEY_ROUND_START_MS,///< Round due -> all its rooms created
+    HIST_UPGRADE_PAUSE_MS,      ///< Live upgrade: freeze -> clients served again
+    STAT_HIST_COUNT
+} StatHist;
+
+
+/**
+ * @brief Adds a value to a counter.
+ * @param c     Counter.
+ * @param delta Increment.
+ */
+void stats_add(StatCounter c, long delta);
+
+/**
+ * @brief Increments a counter by one.
+ * @param c Counter.
+ */
+void stats_inc(StatCounter c);
+
+/**
+ * @brief Sets a gauge.
+ * @param g Gauge.
+ * @param v Current value.
+ */
+void stats_set(StatGauge g, long v);
+
+/**
+ * @brief Records one observation into a histogram.
+ * @param h  Histogram.
+ * @param ms Observed value in milliseconds.
+ */
+void stats_observe(StatHist h, long ms);
+
+/**
+ * @brief Estimates a percentile from a histogram.
+ * @param h Histogram.
+ * @param p Percentile in range 0..100.
+ * @return Upper bound of the bucket holding the percentile (ms), 0 if empty.
+ */
+long stats_percentile(StatHist h, double p);
+
+/**
+ * @brief Sends all metrics to a client as "STAT|key|value" lines,
+ *        followed by "STATS_END|", in one coalesced send.
+ * @param fd Target socket.
+ */
+void stats_send(int fd);
+
+/**
+ * @brief Writes the current metrics to the server log.
+ */
+void stats_log(void);
+
+#endif // STATS_H
@@ -0,0 +1,63 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+
+// ============================================================
+//  TIMER MODULE HEADER
+//  ------------------------------------------------------------
+//  One-shot timers on a hashed timing wheel driven by a single
+//  thread. Arming and cancelling are O(1) regardless of how many
+//  timers are pending, so per-room deadlines cost nothing while
+//  they sleep.
+//
+//  Callbacks run on the timer thread without any module lock
+//  held; they must take whatever locks they need and re-check
+//  that the event they were armed for is still current.
+// ============================================================
+
+#define TIMER_TICK_MS    50     // Wheel resolution
+#define TIMER_WHEEL_SIZE 1024   // Slots (one revolution = ~51 s)
+
+/**
+ * @brief Timer handle. 0 never refers to a timer.
+ */
+typedef uint64_t TimerId;
+
+/**
+ * @brief Timer callback.
+ * @param a First user argument (e.g. room ID).
+ * @param b Second user argument (e.g. sequence number).
+ */
+typedef void (*TimerFn)(long a, long b);
+
+
+/**
+ * @brief Starts the timer thread. Must be called once at startup.
+ */
+void timer_start(void);
+
+/**
+ * @brief Worst lateness of a wheel tick since the previous call, in ms.
+ *        Callbacks that run long or a starved timer thread show up here.
+ */
+long timer_lag_ms(void);
+
+/**
+ * @brief Arms a one-shot timer.
+ * @param delay_ms Delay in milliseconds (rounded up to TIMER_TICK_MS).
+ * @param fn       Callback.
+ * @param a        First callback argument.
+ * @param b        Second callback argument.
+ * @return Handle for timer_cancel(), or 0 on allocation failure.
+ */
+TimerId timer_arm(long delay_ms, TimerFn fn, long a, long b);
+
+/**
+ * @brief Cancels a pending timer.
+ * @param id Handle from timer_arm() (0 and stale handles are ignored).
+ * @return 1 if the timer was pending and will not fire, 0 otherwise.
+ */
+int timer_cancel(TimerId id);
+
+#endif // TIMER_H
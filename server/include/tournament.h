@@ -0,0 +1,76 @@
+#ifndef TOURNAMENT_H
+#define TOURNAMENT_H
+
+// ============================================================
+//  TOURNAMENT MODULE HEADER
+//  ------------------------------------------------------------
+//  Swiss and single-elimination tournaments built on top of the
+//  regular rooms.
+//
+//  Responsibilities:
+//   - Registration (##TOURNEY|CREATE / JOIN / START / LIST)
+//   - Round pairing on a dedicated scheduler thread
+//   - Creating one room per pairing via room_create / room_join
+//   - Collecting results reported by finished or abandoned room games
+//
+//  Protocol:
+//   ##TOURNEY|CREATE|name|SWISS[|rounds]   -> TOURNEY_CREATED|id|name|format
+//   ##TOURNEY|CREATE|name|SE               (single elimination)
+//   ##TOURNEY|JOIN|id                      -> TOURNEY_JOINED|id|players
+//   ##TOURNEY|START|id                     (creator only)
+//   ##TOURNEY|LIST|                        -> TOURNEYS|n|id|name|format|players|state...
+//   server pushes TOURNEY_ROUND|id|round|opponent, TOURNEY_BYE|id|round,
+//   TOURNEY_END|id|winner
+// ============================================================
+
+#include <stdbool.h>
+
+struct Client;
+
+/**
+ * @brief Starts the tournament scheduler thread.
+ */
+void tourney_start(void);
+
+/**
+ * @brief Handles a ##TOURNEY| command.
+ * @param c     Issuing client.
+ * @param args  Payload after "##TOURNEY|".
+ */
+void tourney_command(struct Client* c, const char* args);
+
+/**
+ * @brief Reports the outcome of a tournament game.
+ *
+ * Only queues an event for the scheduler, so it is safe to call
+ * with g_rooms_mtx held.
+ *
+ * @param tourney_id  Tournament owning the room.
+ * @param room_id     Room the game was played in.
+ * @param winner      Winner's session token, NULL for a draw.
+ */
+void tourney_report(int tourney_id, int room_id, const char* winner);
+
+/**
+ * @brief Reports a tournament room removed before its game was decided
+ *        (both players gone): a double forfeit. Safe under g_rooms_mtx.
+ */
+void tourney_report_abandoned(int tourney_id, int room_id);
+
+/**
+ * @brief True if the client with this session token is registered in a
+ *        tournament that has not finished (it must stay on this worker).
+ *
+ * Takes g_tourney_mtx: do not call with the clients or rooms lock held.
+ */
+bool tourney_has_player(const char* session);
+
+/**
+ * @brief Binds the tournament players of c's session to c (after a
+ *        RECONNECT), so pairings and notices reach the new connection.
+ *
+ * Takes g_tourney_mtx: do not call with the clients or rooms lock held.
+ */
+void tourney_rebind(struct Client* c);
+
+#endif // TOURNAMENT_H
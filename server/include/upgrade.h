@@ -0,0 +1,88 @@
+#ifndef UPGRADE_H
+#define UPGRADE_H
+
+// ============================================================
+//  UPGRADE MODULE HEADER
+//  ------------------------------------------------------------
+//  Live upgrade of a single-process server without dropping a
+//  connection. Triggered by SIGUSR2 or ##ADMIN|<token>|UPGRADE.
+//
+//  Old process:
+//   1. fork + exec of its own binary (re-read from disk), with
+//      one end of a SOCK_SEQPACKET pair as fd 3 / UPGRADE_FD
+//   2. freeze: every client thread and the accept loop park at
+//      a line boundary (SIGUSR1 interrupts blocking recv/accept)
+//   3. under the clients + rooms locks: listening socket(s), then
+//      all client sockets with their state (session, partial
+//      input line, ...) and all rooms as versioned records
+//   4. waits for the ack, sends the commit and exits; on any
+//      failure before the ack it thaws, kills the successor and
+//      keeps serving
+//
+//  New process: starts its service threads, reports ready (the
+//  old one only freezes then), rebuilds clients and rooms,
+//  re-arms clocks / bot / series timers, acks, and only after
+//  the commit resumes the client threads and serves.
+//
+//  Not carried over: the quick-match queue order (players are
+//  queued again), running tournaments and the stats counters.
+// ============================================================
+
+#include <stdbool.h>
+
+struct Client;
+
+/**
+ * @brief Remembers the binary for the re-exec and picks up the link
+ *        to the old process. Call first thing in main().
+ */
+void upgrade_init(char** argv);
+
+/**
+ * @brief True if this process was started by a live upgrade.
+ */
+bool upgrade_is_child(void);
+
+/**
+ * @brief New process: takes over listeners, clients and rooms from
+ *        the old process, starts the client threads and acks.
+ *        Needs timer / fan-out / presence / quick match running.
+ * @param unix_fd  Receives the LISTEN_UNIX socket, -1 if the old process had none.
+ * @return Listening socket, or -1 if the handover failed (exit then).
+ */
+int upgrade_take_over(int* unix_fd);
+
+/**
+ * @brief Enables upgrades; called by the accept thread.
+ *        No-op in multi-process mode.
+ * @param listen_fd  Listening socket handed to the next process.
+ * @param unix_fd    LISTEN_UNIX socket handed over as well, -1 if none.
+ */
+void upgrade_start(int listen_fd, int unix_fd);
+
+/**
+ * @brief Runs an upgrade; on success the process exits, otherwise it
+ *        keeps serving. Called by the signal thread on SIGUSR2.
+ */
+void upgrade_run(void);
+
+/**
+ * @brief Requests an upgrade (same as SIGUSR2).
+ * @return 1 if requested, 0 if upgrades are unavailable.
+ */
+int upgrade_request(void);
+
+/**
+ * @brief True while a freeze is in progress; checked by the client
+ *        and accept loops at line / connection boundaries.
+ */
+bool upgrade_pending(void);
+
+/**
+ * @brief Parks the calling thread until the upgrade failed (the
+ *        process then continues) or the process exits.
+ * @param c  Client served by the thread, NULL for the accept loop.
+ */
+void upgrade_park(struct Client* c);
+
+#endif // UPGRADE_H
@@ -10,6 +10,8 @@
 //  - sendp: formatted protocol message sending
 //  - recv_line: reads one line from socket
 //  - trim_newline: removes trailing newline characters
+//  - MsgBuf: several protocol lines coalesced into one send
+//  - now_ms: monotonic clock in milliseconds
 // ============================================================
 
 
@@ -25,6 +27,16 @@
 void sendp(int fd, const char* fmt, ...);
 
 
+/**
+ * @brief Sends already framed bytes, reporting errors like sendp().
+ *
+ * @param fd   File descriptor (socket) of the client.
+ * @param data Bytes to send.
+ * @param len  Number of bytes.
+ */
+void sendraw(int fd, const void* data, size_t len);
+
+
 /**
  * @brief Reads a single line (ending with '\n') from a socket.
  *
@@ -44,4 +56,48 @@ int recv_line(int fd, char* out, size_t cap);
 void trim_newline(char* s);
 
 
+// ------------------------------------------------------------
+//  Coalesced sends
+// ------------------------------------------------------------
+/**
+ * @struct MsgBuf
+ * @brief Accumulates framed protocol lines for a single send().
+ */
+typedef struct {
+    char data[4096];
+    size_t len;
+} MsgBuf;
+
+/**
+ * @brief Resets the buffer to empty.
+ * @param mb Target buffer.
+ */
+void msgbuf_init(MsgBuf* mb);
+
+/**
+ * @brief Appends one protocol message (framed like sendp()).
+ *
+ * Messages that do not fit are dropped; the buffer stays valid.
+ *
+ * @param mb  Target buffer.
+ * @param fmt Format string (printf-like).
+ */
+void msgbuf_add(MsgBuf* mb, const char* fmt, ...);
+
+/**
+ * @brief Sends the whole buffer with one send() call.
+ * @param fd Target socket.
+ * @param mb Buffer to send (left untouched).
+ */
+void msgbuf_send(int fd, const MsgBuf* mb);
+
+
+/**
+ * @brief Returns a monotonic timestamp in milliseconds.
+ *
+ * Not related to wall-clock time; use only for measuring intervals.
+ */
+long long now_ms(void);
+
+
 #endif
@@ -0,0 +1,54 @@
+#ifndef VALIDATE_H
+#define VALIDATE_H
+
+// ============================================================
+//  VALIDATE MODULE HEADER
+//  ------------------------------------------------------------
+//  Pre-dispatch check of every received line, in one pass over
+//  its bytes:
+//   - starts with "##"
+//   - an opcode of A-Z followed by '|', found in the opcode
+//     table (which also gives its rate limit class)
+//   - no control characters (bytes >= 0x80 pass: chat is UTF-8)
+//   - ends with '\n' (optionally "\r\n") inside CLIENT_INBUF
+//
+//  Only lines that pass reach the rate limiter and
+//  dispatch_line(). Rejections are counted (##STATS| malformed)
+//  and sampled into the log: at most one line per
+//  VALIDATE_LOG_MS, carrying the number of rejections since the
+//  previous one.
+// ============================================================
+
+#include <stddef.h>
+#include "ratelimit.h"
+
+#define VALIDATE_LOG_MS     1000    // Gap between two log lines about rejections
+#define VALIDATE_SAMPLE_LEN 40      // Bytes of the rejected line that are logged
+
+typedef enum {
+    VALID_OK = 0,
+    VALID_EMPTY,            ///< Blank line (keepalive), ignored silently
+    VALID_NO_PREFIX,        ///< Does not start with "##"
+    VALID_BAD_OPCODE,       ///< Opcode not A-Z or not ended by '|'
+    VALID_UNKNOWN,          ///< Opcode not in the table
+    VALID_BAD_CHAR,         ///< Control character in the line
+    VALID_TOO_LONG          ///< No newline within CLIENT_INBUF
+} ValidResult;
+
+/**
+ * @brief Checks a received line and strips its line ending in place.
+ * @param line  NUL-terminated bytes as received (with '\n').
+ * @param cls   Receives the rate limit class when VALID_OK.
+ * @return VALID_OK, VALID_EMPTY or the reason for the rejection.
+ */
+ValidResult validate_line(char* line, RateClass* cls);
+
+/**
+ * @brief Counts a rejection and logs a sample now and then.
+ * @param who   Client name for the log ("" if not joined).
+ * @param why   Result of validate_line().
+ * @param line  The rejected line (sanitized before logging).
+ */
+void validate_reject(const char* who, ValidResult why, const char* line);
+
+#endif // VALIDATE_H
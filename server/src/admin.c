@@ -0,0 +1,104 @@
+// ============================================================
+//  ADMIN MODULE IMPLEMENTATION
+// ============================================================
+
+#include "admin.h"
+#include "client.h"
+#include "config.h"
+#include "drain.h"
+#include "feed.h"
+#include "pubsub.h"
+#include "upgrade.h"
+#include "utils.h"
+#include "log.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Compares the whole token regardless of where the first mismatch is
+static int token_ok(const char* given, size_t len) {
+    const char* want = config_get()->admin_token;
+    size_t wlen = strlen(want);
+    if (wlen == 0) return 0;
+
+    unsigned diff = (unsigned)(len ^ wlen);
+    for (size_t i = 0; i < len; i++)
+        diff |= (unsigned char)given[i] ^ (unsigned char)want[i % wlen];
+    return diff == 0;
+}
+
+int admin_command(struct Client* c, const char* payload) {
+    const char* bar = strchr(payload, '|');
+    if (!bar || !token_ok(payload, (size_t)(bar - payload))) {
+        sendp(c->fd, "ERROR|Not authorized");
+        server_log("Rejected admin command from %s", c->name[0] ? c->name : "(unknown)");
+        return 0;
+    }
+    const char* cmd = bar + 1;
+
+    if (strncmp(cmd, "BROADCAST|", 10) == 0) {
+        const char* spec = cmd + 10;
+        const char* sep = strchr(spec, '|');
+        char name[32];
+        Topic t;
+        if (!sep || (size_t)(sep - spec) >= sizeof(name) || sep[1] == '\0') {
+            sendp(c->fd, "ERROR|Invalid broadcast");
+            return 0;
+        }
+        memcpy(name, spec, (size_t)(sep - spec));
+        name[sep - spec] = '\0';
+        if (!pubsub_parse(name, &t)) {
+            sendp(c->fd, "ERROR|Unknown topic");
+            return 0;
+        }
+
+        int n = pubsub_publish(&t, "INFO|%s", sep + 1);
+        sendp(c->fd, "ADMIN_OK|%d", n);
+        server_log("Admin broadcast to %s (%d receivers): %s", name, n, sep + 1);
+        return 1;
+    }
+
+    if (strcmp(cmd, "UPGRADE") == 0) {
+        if (!upgrade_request()) {
+            sendp(c->fd, "ERROR|Upgrade not available");
+            return 0;
+        }
+        sendp(c->fd, "ADMIN_OK|UPGRADE");
+        server_log("Admin %s requested a live upgrade", c->name[0] ? c->name : "(unknown)");
+        return 1;
+    }
+
+    if (strcmp(cmd, "DRAIN") == 0 || strncmp(cmd, "DRAIN|", 6) == 0) {
+        int secs = (cmd[5] == '|') ? atoi(cmd + 6) : 0;
+        if (cmd[5] == '|' && secs <= 0) {
+            sendp(c->fd, "ERROR|Invalid drain deadline");
+            return 0;
+        }
+        if (drain_start(secs))
+            server_log("Admin %s started a drain", c->name[0] ? c->name : "(unknown)");
+        DrainStatus st;
+        drain_status(&st);
+        sendp(c->fd, "ADMIN_OK|DRAIN|%d|%d|%ld", st.rooms, st.clients, st.seconds_left);
+        return 1;
+    }
+
+    if (strcmp(cmd, "FEED") == 0) {
+        if (!feed_subscribe(c)) {
+            sendp(c->fd, "ERROR|Feed full");
+            return 0;
+        }
+        sendp(c->fd, "ADMIN_OK|FEED");
+        return 1;
+    }
+
+    if (strcmp(cmd, "DRAIN_STATUS") == 0) {
+        DrainStatus st;
+        drain_status(&st);
+        sendp(c->fd, "ADMIN_OK|DRAIN_STATUS|%d|%d|%d|%ld",
+              st.active ? 1 : 0, st.rooms, st.clients, st.seconds_left);
+        return 1;
+    }
+
+    sendp(c->fd, "ERROR|Unknown admin command");
+    return 0;
+}
@@ -0,0 +1,122 @@
+// ============================================================
+//  BOT MODULE IMPLEMENTATION
+//  ------------------------------------------------------------
+//  Fill-in opponent: win if possible, otherwise block, otherwise
+//  take the center, a corner, an edge. Each move is a timer-wheel
+//  entry carrying the room ID and the room's bot_seq, so seats
+//  that change hands invalidate moves still in flight.
+// ============================================================
+
+#include "bot.h"
+#include "client.h"
+#include "room.h"
+#include "game.h"
+#include "timer.h"
+#include "matchmaking.h"
+#include "overload.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static atomic_int g_bot_counter;
+
+
+// ============================================================
+//  bot_create() / bot_destroy()
+// ============================================================
+struct Client* bot_create(void) {
+    struct Client* b = calloc(1, sizeof(struct Client));
+    if (!b) return NULL;
+
+    b->fd = -1;
+    b->is_bot = true;
+    b->state = CLIENT_STATE_LOBBY;
+    b->alive = true;
+    b->connected = true;
+    b->spectate_room_id = -1;
+    b->rating = RATING_DEFAULT;
+    atomic_init(&b->migrate_to, -1);
+    snprintf(b->name, sizeof(b->name), "Bot-%d", atomic_fetch_add(&g_bot_counter, 1) + 1);
+    return b;
+}
+
+void bot_destroy(struct Client* bot) {
+    free(bot);
+}
+
+
+// ============================================================
+//  pick_move()
+//  ------------------------------------------------------------
+//  Chooses a cell for symbol `me`. Returns 0 if the board is full.
+// ============================================================
+static int completes_line(char board[SIZE][SIZE], int x, int y, char sym) {
+    board[y][x] = sym;
+    int win = (check_win(board) == 1);
+    board[y][x] = ' ';
+    return win;
+}
+
+static int pick_move(const Game* g, char me, int* ox, int* oy) {
+    char board[SIZE][SIZE];
+    for (int y = 0; y < SIZE; y++)
+        for (int x = 0; x < SIZE; x++)
+            board[y][x] = g->board[y][x];
+
+    char them = (me == 'X') ? 'O' : 'X';
+    const char order[2] = { me, them };
+
+    // Own win first, then block the opponent's
+    for (int k = 0; k < 2; k++)
+        for (int y = 0; y < SIZE; y++)
+            for (int x = 0; x < SIZE; x++)
+                if (board[y][x] == ' ' && completes_line(board, x, y, order[k])) {
+                    *ox = x; *oy = y;
+                    return 1;
+                }
+
+    static const int pref[SIZE * SIZE][2] = {
+        {1, 1}, {0, 0}, {2, 0}, {0, 2}, {2, 2}, {1, 0}, {0, 1}, {2, 1}, {1, 2}
+    };
+    for (int i = 0; i < SIZE * SIZE; i++) {
+        if (board[pref[i][1]][pref[i][0]] == ' ') {
+            *ox = pref[i][0]; *oy = pref[i][1];
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+// ============================================================
+//  on_bot_move() - timer thread
+// ============================================================
+static void on_bot_move(long room_id, long seq) {
+    pthread_mutex_lock(&g_rooms_mtx);
+    Room* r = room_find_by_id((int)room_id);
+    if (r && r->bot_seq == seq && r->game.state == 0) {
+        struct Client* bot = r->game.current_turn;
+        int x, y;
+        if (bot && bot->is_bot && (bot == r->p1 || bot == r->p2) &&
+            pick_move(&r->game, bot == r->p1 ? 'X' : 'O', &x, &y)) {
+            game_move(r, bot, x, y);
+        }
+    }
+    pthread_mutex_unlock(&g_rooms_mtx);
+}
+
+
+// ============================================================
+//  bot_on_turn()
+// ============================================================
+void bot_on_turn(Room* r) {
+    if (!r || r->game.state != 0) return;
+    struct Client* c = r->game.current_turn;
+    if (!c || !c->is_bot) return;
+    r->bot_seq++;
+    // Human moves matter more than bot think time when overloaded
+    long delay = BOT_MOVE_MS;
+    if (overload_level() >= OVERLOAD_LIST_CACHED) delay += OVERLOAD_BOT_DELAY_MS;
+    timer_arm(delay, on_bot_move, r->id, r->bot_seq);
+}
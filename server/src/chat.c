@@ -0,0 +1,44 @@
+// ============================================================
+//  CHAT MODULE IMPLEMENTATION
+//  ------------------------------------------------------------
+//  Validation and routing of chat messages. Room chat (and its
+//  history ring) is kept by the room module; lobby chat is
+//  handed to the fan-out workers.
+// ============================================================
+
+#include "chat.h"
+#include "client.h"
+#include "room.h"
+#include "fanout.h"
+#include "stats.h"
+#include "utils.h"
+
+#include <string.h>
+
+void chat_handle(struct Client* c, const char* text) {
+    if (c->name[0] == '\0') {
+        sendp(c->fd, "ERROR|Join first");
+        return;
+    }
+
+    size_t len = strlen(text);
+    if (len == 0 || len > CHAT_MAX_LEN) {
+        stats_inc(STAT_CHAT_DROP_LENGTH);
+        sendp(c->fd, "ERROR|Chat message length");
+        return;
+    }
+
+    if (!tb_take(&c->chat_bucket, CHAT_RATE, CHAT_BURST, 1.0)) {
+        stats_inc(STAT_CHAT_DROP_RATE);
+        sendp(c->fd, "ERROR|Chat rate limit");
+        return;
+    }
+
+    if (room_chat(c, text)) {
+        stats_inc(STAT_CHAT_ROOM);
+        return;
+    }
+
+    stats_inc(STAT_CHAT_LOBBY);
+    fanout_lobby("CHAT|LOBBY|%s|%s", c->name, text);
+}
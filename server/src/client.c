@@ -15,7 +15,24 @@
 #include "game.h"
 #include "config.h"
 #include "log.h"
-
+#include "matchmaking.h"
+#include "stats.h"
+#include "tournament.h"
+#include "chat.h"
+#include "presence.h"
+#include "admin.h"
+#include "shard.h"
+#include "upgrade.h"
+#include "feed.h"
+#include "slab.h"
+#include "ready.h"
+#include "drain.h"
+#include "connlimit.h"
+#include "rng.h"
+#include "validate.h"
+#include "fanout.h"
+
+#include <errno.h>
 #include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
@@ -23,14 +40,20 @@
 #include <stdio.h>
 #include <strings.h>
 #include <sys/socket.h>
+#include <arpa/inet.h>
 
 // ============================================================
 //  Global variables
 // ============================================================
 
-struct Client* g_clients[MAX_CLIENTS];
+struct Client** g_clients = NULL;
+int g_client_cap = 0;
 pthread_mutex_t g_clients_mtx = PTHREAD_MUTEX_INITIALIZER;
 
+// Client structs (with their input buffer); filled by client_prealloc()
+static Slab g_client_slab = SLAB_INIT("clients", sizeof(struct Client));
+static int g_client_count = 0;      // Admitted clients (g_clients_mtx)
+
 #define MAX_INVALID_MSG 3  // Disconnect after 3 invalid inputs
 
 
@@ -38,22 +61,53 @@ pthread_mutex_t g_clients_mtx = PTHREAD_MUTEX_INITIALIZER;
 //  Client lifecycle management
 // ============================================================
 
+void client_refuse(int fd, const char* reason) {
+    char line[96];
+    int n = snprintf(line, sizeof(line), "##ERROR|%s\n", reason);
+    if (n > 0) (void)!send(fd, line, (size_t)n, MSG_DONTWAIT | MSG_NOSIGNAL);
+}
+
+// IPv4 source of a connection (host order), 0 for AF_UNIX
+static uint32_t peer_ip(int fd) {
+    struct sockaddr_in sa;
+    socklen_t len = sizeof(sa);
+    if (getpeername(fd, (struct sockaddr*)&sa, &len) < 0 || sa.sin_family != AF_INET)
+        return 0;
+    return ntohl(sa.sin_addr.s_addr);
+}
+
+void client_track_ip(struct Client* c) {
+    if (c->ip_counted) return;
+    conn_track(c->ip);
+    c->ip_counted = true;
+}
+
+static void admit_undo(void) {
+    pthread_mutex_lock(&g_clients_mtx);
+    g_client_count--;
+    pthread_mutex_unlock(&g_clients_mtx);
+}
+
 struct Client* client_create(int fd) {
-    // Enforce max_clients limit
+    // Enforce max_clients limit; the slot is reserved right away, so
+    // concurrent accepts (upgrade, other workers) cannot overshoot
     pthread_mutex_lock(&g_clients_mtx);
-    int active = 0;
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (g_clients[i]) active++;
-    }
-    if (active >= g_config.max_clients) {
-        pthread_mutex_unlock(&g_clients_mtx);
-        sendp(fd, "ERROR|Server full");
+    bool full = (g_client_count >= config_get()->max_clients);
+    if (!full) g_client_count++;
+    pthread_mutex_unlock(&g_clients_mtx);
+    if (full) {
+        stats_inc(STAT_REJECT_FULL);
+        client_refuse(fd, "Server full");
         return NULL;
     }
-    pthread_mutex_unlock(&g_clients_mtx);
 
-    struct Client* c = calloc(1, sizeof(struct Client));
-    if (!c) return NULL;
+    struct Client* c = slab_alloc(&g_client_slab);
+    if (!c) {
+        admit_undo();
+        stats_inc(STAT_REJECT_NOMEM);
+        client_refuse(fd, "Server busy");
+        return NULL;
+    }
 
     c->fd = fd;
     c->state = CLIENT_STATE_LOBBY;
@@ -61,40 +115,105 @@ struct Client* client_create(int fd) {
     c->connected = true;
     c->missed_pongs = 0;
     c->invalid_count = 0;
-
-    // Generate random session token for reconnect
-    snprintf(c->session_id, sizeof(c->session_id),
-             "%08x%08x", rand(), rand());
+    c->spectate_room_id = -1;
+    c->rating = RATING_DEFAULT;
+    tb_init(&c->chat_bucket, CHAT_BURST);
+    rl_init(&c->cmd_limit);
+    c->ip = peer_ip(fd);
+    c->last_rx_ms = now_ms();
+    atomic_init(&c->migrate_to, -1);
+    atomic_init(&c->refs, 1);
+    atomic_init(&c->dying, false);
+
+    // Reconnect token: whoever presents it gets the seat back
+    rng_token(c->session_id, sizeof(c->session_id));
 
     // Register into global list
+    bool placed = false;
     pthread_mutex_lock(&g_clients_mtx);
-    for (int i = 0; i < MAX_CLIENTS; i++) {
+    for (int i = 0; i < g_client_cap && !placed; i++) {
         if (!g_clients[i]) {
             g_clients[i] = c;
-            break;
+            placed = true;
         }
     }
     pthread_mutex_unlock(&g_clients_mtx);
+    if (!placed) {      // table shrunk by a reload meanwhile
+        slab_free(&g_client_slab, c);
+        admit_undo();
+        stats_inc(STAT_REJECT_FULL);
+        client_refuse(fd, "Server full");
+        return NULL;
+    }
     return c;
 }
 
+// Slot indexes are not kept anywhere, so the table is compacted
+// before it is cut down
+int client_pool_resize(int cap) {
+    pthread_mutex_lock(&g_clients_mtx);
+    int n = 0;
+    for (int i = 0; i < g_client_cap; i++)
+        if (g_clients[i]) g_clients[n++] = g_clients[i];
+    for (int i = n; i < g_client_cap; i++) g_clients[i] = NULL;
+    if (cap < n) cap = n;
+
+    if (cap != g_client_cap) {
+        struct Client** t = realloc(g_clients, (size_t)(cap > 0 ? cap : 1) * sizeof(*t));
+        if (!t) {
+            pthread_mutex_unlock(&g_clients_mtx);
+            return g_client_cap;
+        }
+        for (int i = g_client_cap; i < cap; i++) t[i] = NULL;
+        g_clients = t;
+        g_client_cap = cap;
+    }
+    pthread_mutex_unlock(&g_clients_mtx);
+    return cap;
+}
+
 void client_destroy(struct Client* c) {
     if (!c) return;
 
+    // From here on room_create / room_join / mm_enqueue refuse c
+    atomic_store(&c->dying, true);
+    room_unspectate(c);
+    mm_dequeue(c, 0);
+    presence_offline(c);
+    feed_unsubscribe(c);
+    handle_disconnect(c);   // a matcher may have seated it meanwhile
+
     pthread_mutex_lock(&g_clients_mtx);
-    for (int i = 0; i < MAX_CLIENTS; i++) {
+    for (int i = 0; i < g_client_cap; i++) {
         if (g_clients[i] == c) {
             g_clients[i] = NULL;
+            g_client_count--;
             break;
         }
     }
     pthread_mutex_unlock(&g_clients_mtx);
 
+    if (c->ip_counted) conn_release(c->ip);
+    client_release(c);
+}
+
+void client_hold(struct Client* c) {
+    atomic_fetch_add(&c->refs, 1);
+}
+
+// The socket is closed here too: while a holder may still send to
+// c->fd, the number must not be reused by another connection
+void client_release(struct Client* c) {
+    if (!c || atomic_fetch_sub(&c->refs, 1) != 1) return;
     if (c->fd >= 0) {
         close(c->fd);
         c->fd = -1;
     }
-    free(c);
+    slab_free(&g_client_slab, c);
+}
+
+size_t client_prealloc(int n) {
+    return slab_fill(&g_client_slab, n);
 }
 
 
@@ -112,6 +231,62 @@ void client_set_state(struct Client* c, ClientState st) {
     if (c) c->state = st;
 }
 
+struct Audience* client_lobby_audience(void) {
+    return client_state_audience(CLIENT_STATE_LOBBY);
+}
+
+struct Audience* client_state_audience(int state) {
+    pthread_mutex_lock(&g_clients_mtx);
+    Audience* a = audience_alloc(g_client_cap > 0 ? g_client_cap : 1);
+    for (int i = 0; a && i < g_client_cap; i++) {
+        struct Client* c = g_clients[i];
+        if (!c || !c->connected || !c->name[0]) continue;
+        if (state == CLIENT_STATE_LOBBY &&
+            (c->current_room || c->spectate_room_id >= 0)) continue;
+        if (state != CLIENT_STATE_ANY && state != CLIENT_STATE_LOBBY &&
+            ((int)c->state != state || !c->current_room)) continue;
+        audience_push(a, c);
+    }
+    pthread_mutex_unlock(&g_clients_mtx);
+    if (a && a->n == 0) {
+        audience_release(a);
+        a = NULL;
+    }
+    return a;
+}
+
+struct Client* client_find_by_name(const char* name) {
+    if (!name || !name[0]) return NULL;
+    struct Client* found = NULL;
+    pthread_mutex_lock(&g_clients_mtx);
+    for (int i = 0; i < g_client_cap; i++) {
+        struct Client* c = g_clients[i];
+        if (c && c->connected && strcmp(c->name, name) == 0) {
+            found = c;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_clients_mtx);
+    return found;
+}
+
+
+struct Client* client_hold_by_session(const char* session) {
+    if (!session || !session[0]) return NULL;
+    struct Client* found = NULL;
+    pthread_mutex_lock(&g_clients_mtx);
+    for (int i = 0; i < g_client_cap; i++) {
+        struct Client* c = g_clients[i];
+        if (c && c->connected && strcmp(c->session_id, session) == 0) {
+            client_hold(c);
+            found = c;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_clients_mtx);
+    return found;
+}
+
 
 // ============================================================
 //  Command handling (JOIN, CREATE, MOVE, etc.)
@@ -121,11 +296,30 @@ static void handle_join(struct Client* c, const char* payload);
 static void handle_quit(struct Client* c);
 static void bump_invalid(struct Client* c);
 
+// Multi-process mode: moves the client to the worker that owns the
+// target of this command. Returns 1 if the command was consumed.
+static int route_to_owner(struct Client* c, int owner, const char* line) {
+    if (owner < 0 || owner == shard_self() || c->current_room) return 0;
+
+    mm_dequeue(c, 0);
+    room_unspectate(c);
+    if (!shard_handoff(c, owner, line)) {
+        sendp(c->fd, "ERROR|Room unavailable");
+        return 1;
+    }
+    c->alive = false;   // the socket lives on in the other worker
+    return 1;
+}
+
 static void dispatch_line(struct Client* c, const char* line) {
     if (strncmp(line, "##JOIN|", 7) == 0) {
         handle_join(c, line + 7);
 
     } else if (strncmp(line, "##RECONNECT|", 12) == 0) {
+        char who[32];
+        snprintf(who, sizeof(who), "%.*s", (int)strcspn(line + 12, "|"), line + 12);
+        if (route_to_owner(c, shard_owner_of_player(who), line)) return;
+
         char *name = strtok((char*)line + 12, "|");
         char *session = strtok(NULL, "|");
 
@@ -139,16 +333,70 @@ static void dispatch_line(struct Client* c, const char* line) {
         snprintf(c->session_id, sizeof(c->session_id), "%.*s", (int)sizeof(c->session_id) - 1, session);
 
         room_reconnect(c->name, c->session_id, c);
+        tourney_rebind(c);
 
     } else if (strncmp(line, "##CREATE|", 9) == 0) {
-        room_create(line + 9, c);
+        char name[32];
+        RoomOptions opts;
+        if (!room_options_parse(line + 9, name, sizeof(name), &opts)) {
+            sendp(c->fd, "ERROR|Invalid room options");
+            bump_invalid(c);
+            return;
+        }
+        mm_dequeue(c, 0);
+        room_unspectate(c);
+        room_create(name, c, &opts);
 
     } else if (strncmp(line, "##JOINROOM|", 11) == 0) {
         int id = atoi(line + 11);
+        if (route_to_owner(c, shard_owner_of_room(id), line)) return;
+        mm_dequeue(c, 0);
+        room_unspectate(c);
         room_join(id, c);
 
+    } else if (strncmp(line, "##JOINCODE|", 11) == 0) {
+        if (route_to_owner(c, shard_owner_of_code(line + 11), line)) return;
+        mm_dequeue(c, 0);
+        room_unspectate(c);
+        room_join_code(line + 11, c);
+
+    } else if (strncmp(line, "##SPECTATE|", 11) == 0) {
+        int id = atoi(line + 11);
+        if (route_to_owner(c, shard_owner_of_room(id), line)) return;
+        mm_dequeue(c, 0);
+        room_spectate(id, c);
+
+    } else if (strncmp(line, "##QUEUE|", 8) == 0) {
+        mm_enqueue(c);
+
+    } else if (strncmp(line, "##UNQUEUE|", 10) == 0) {
+        mm_dequeue(c, 1);
+
+    } else if (strncmp(line, "##TOURNEY|", 10) == 0) {
+        tourney_command(c, line + 10);
+
+    } else if (strncmp(line, "##CHAT|", 7) == 0) {
+        chat_handle(c, line + 7);
+
+    } else if (strncmp(line, "##FRIEND|", 9) == 0) {
+        friend_command(c, line + 9);
+
+    } else if (strncmp(line, "##ADMIN|", 8) == 0) {
+        if (!admin_command(c, line + 8)) bump_invalid(c);
+
+    } else if (strncmp(line, "##STATS|", 8) == 0) {
+        stats_send(c->fd);
+
+    } else if (strncmp(line, "##HEALTH|", 9) == 0) {
+        ready_send(c->fd);
+
     } else if (strncmp(line, "##EXIT|", 7) == 0) {
-        room_leave(c);
+        if (c->spectate_room_id >= 0) {
+            room_unspectate(c);
+            sendp(c->fd, "EXITED|");
+        } else {
+            room_leave(c);
+        }
 
     } else if (strncmp(line, "##LIST|", 7) == 0) {
         rooms_list_send(c);
@@ -170,76 +418,22 @@ static void dispatch_line(struct Client* c, const char* line) {
             return;
         }
         if (parse_move(line, &x, &y))
-            game_move(c->current_room, c, x, y);
+            room_move(c, x, y);
         else {
             sendp(c->fd, "ERROR|Invalid MOVE format");
             bump_invalid(c);
         }
 
     } else if (strncmp(line, "##REPLAY|", 9) == 0) {
-        if (!c->current_room) {
+        if (!room_replay(c, strcasecmp(line + 9, "YES") == 0)) {
             sendp(c->fd, "ERROR|Not in room");
             bump_invalid(c);
-            return;
-        }
-
-        Room* r = c->current_room;
-        int yes = (strcasecmp(line + 9, "YES") == 0);
-        server_log("Replay vote from %s: %s (room %s)", c->name, yes ? "YES" : "NO", r->name);
-
-        // Player declined replay (voluntary exit - no reconnect allowed)
-        if (!yes) {
-        sendp(c->fd, "INFO|You declined replay");
-
-        // Reset any pending replay flags; a decline cancels the restart cycle
-        r->replay_p1 = 0;
-        r->replay_p2 = 0;
-
-        struct Client* other = (r->p1 == c) ? r->p2 : r->p1;
-        if (other) {
-            sendp(other->fd, "INFO|Opponent declined replay");
-            sendp(other->fd, "CLEAR|");
-            game_reset(&r->game, other);
-            other->state = CLIENT_STATE_WAITING;
-            other->current_room = r;
-        }
-
-            // Clear slot and DO NOT preserve reconnect info (voluntary exit)
-            if (r->p1 == c) {
-                r->p1 = NULL;
-                r->p1_name[0] = '\0';
-                r->p1_session[0] = '\0';
-                r->p1_disconnected = false;
-            }
-            if (r->p2 == c) {
-                r->p2 = NULL;
-                r->p2_name[0] = '\0';
-                r->p2_session[0] = '\0';
-                r->p2_disconnected = false;
-            }
-
-            c->current_room = NULL;
-            c->state = CLIENT_STATE_LOBBY;
-            r->state = ROOM_WAITING;
-            sendp(c->fd, "EXITED|");
-            
-            // If room is now empty, remove it
-            if (!r->p1 && !r->p2) {
-                r->state = ROOM_EMPTY;
-                room_remove_if_empty(r);
-            }
-            return;
         }
 
-        // Both confirmed replay
-        if (r->p1 == c) r->replay_p1 = 1;
-        if (r->p2 == c) r->replay_p2 = 1;
-        sendp(c->fd, "INFO|Replay confirmed");
-        room_try_restart(r);
-
     } else {
+        // Only a handed-over first line can get here unvalidated
+        validate_reject(c->name, VALID_UNKNOWN, line);
         sendp(c->fd, "ERROR|UNKNOWN_CMD");
-        server_log("Unknown command from %s: %s", c->name[0] ? c->name : "(unknown)", line);
         bump_invalid(c);
     }
 }
@@ -249,31 +443,192 @@ static void dispatch_line(struct Client* c, const char* line) {
 //  Main client thread
 // ============================================================
 
-void* client_thread(void* arg) {
-    struct Client* c = (struct Client*)arg;
-    char buf[512];
+// Reads the next line into out. Received bytes are collected in
+// c->inbuf, so a line cut short by a live upgrade is carried over.
+// Returns the line length, 0 on disconnect, -1 when the thread has
+// to park for an upgrade.
+static int client_read_line(struct Client* c, char* out, size_t cap) {
+    while (c->inlen + 1 < sizeof(c->inbuf)) {
+        if (upgrade_pending()) return -1;
+        if (c->inlen == 0 && atomic_load(&c->migrate_to) >= 0) return -2;
+
+        char ch;
+        ssize_t r = recv(c->fd, &ch, 1, 0);
+        if (r < 0 && errno == EINTR) continue;  // upgrade_pending() / migrate_to decide
+        if (r <= 0) return 0;                   // disconnected or error
+        c->inbuf[c->inlen++] = ch;
+        if (ch == '\n') break;                  // line complete
+    }
 
-    sendp(c->fd, "HELLO|");
+    size_t n = c->inlen < cap - 1 ? c->inlen : cap - 1;
+    memcpy(out, c->inbuf, n);
+    out[n] = '\0';
+    c->inlen = 0;
+    return (int)n;
+}
+
+// ============================================================
+//  Rebalancing (multi-process mode)
+//  ------------------------------------------------------------
+//  The rebalancer only sets migrate_to; the move itself happens
+//  here, on the client's own thread, between two lines, so no
+//  input is lost: unread bytes stay in the socket, which the
+//  other worker keeps reading.
+// ============================================================
+bool client_movable(const struct Client* c) {
+    if (c->is_bot || !c->name[0] || c->current_room || c->spectate_room_id >= 0 ||
+        c->queue_entry || feed_is_subscribed(c))
+        return false;
+    return !tourney_has_player(c->session_id);
+}
+
+// Returns true if the socket now belongs to another worker
+static bool client_migrate(struct Client* c) {
+    int worker = atomic_exchange(&c->migrate_to, -1);
+    if (worker < 0 || drain_active() || !client_movable(c)) return false;
+    if (!shard_handoff(c, worker, "")) return false;
+    stats_inc(STAT_REBALANCE_MOVED);
+    c->alive = false;
+    return true;
+}
+
+static void client_loop(struct Client* c) {
+    char buf[CLIENT_INBUF];
+
+    // Lets a live upgrade interrupt the blocking recv()
+    pthread_mutex_lock(&g_clients_mtx);
+    c->thread = pthread_self();
+    c->has_thread = true;
+    pthread_mutex_unlock(&g_clients_mtx);
 
     while (c->alive) {
-        int n = recv_line(c->fd, buf, sizeof(buf));
-        if (n <= 0) {
+        int n = client_read_line(c, buf, sizeof(buf));
+        if (n == -2) {
+            if (client_migrate(c)) break;
+            continue;
+        }
+        if (n < 0) {
+            upgrade_park(c);
+            continue;
+        }
+        if (n == 0) {
             c->connected = false;
             handle_disconnect(c);
             break;
         }
 
-        trim_newline(buf);
-        if (strlen(buf) == 0) continue; // Ignore empty lines (keepalives/frag)
+        c->last_rx_ms = now_ms();
+
+        // Malformed input and floods are turned away before any work
+        RateClass cls;
+        ValidResult valid = validate_line(buf, &cls);
+        if (valid == VALID_EMPTY) continue;     // keepalive
+        if (valid != VALID_OK) {
+            bool unknown = (valid == VALID_NO_PREFIX || valid == VALID_BAD_OPCODE ||
+                            valid == VALID_UNKNOWN);
+            validate_reject(c->name, valid, buf);
+            sendp(c->fd, unknown ? "ERROR|UNKNOWN_CMD" : "ERROR|Malformed input");
+            bump_invalid(c);
+            if (!c->alive) break;
+            continue;
+        }
+        RateVerdict v = rl_check(&c->cmd_limit, c->ip, cls);
+        if (v == RL_DROP) {
+            if (rl_notice_due(&c->cmd_limit)) sendp(c->fd, "ERROR|Rate limited");
+            continue;
+        }
+        if (v == RL_KICK) {
+            server_log("Rate limit: disconnecting %s", c->name[0] ? c->name : "(unknown)");
+            sendp(c->fd, "ERROR|Rate limit exceeded");
+            c->alive = false;
+            c->connected = false;
+            shutdown(c->fd, SHUT_RDWR);
+            handle_disconnect(c);
+            break;
+        }
         dispatch_line(c, buf);
         if (!c->alive) break;
     }
 
     client_destroy(c);
+}
+
+void* client_thread(void* arg) {
+    struct Client* c = (struct Client*)arg;
+    sendp(c->fd, "HELLO|");
+    client_loop(c);
     return NULL;
 }
 
 
+// ============================================================
+//  Adopted clients (multi-process mode)
+// ============================================================
+
+typedef struct {
+    struct Client* c;
+    char line[256];
+} AdoptArg;
+
+static void* adopted_thread(void* arg) {
+    AdoptArg a = *(AdoptArg*)arg;
+    free(arg);
+
+    presence_set(a.c, PRES_LOBBY, -1);
+    if (a.line[0]) dispatch_line(a.c, a.line);     // "" = moved by the rebalancer
+    client_loop(a.c);
+    return NULL;
+}
+
+int client_adopt(int fd, const char* name, const char* session, int rating, const char* line) {
+    struct Client* c = client_create(fd);
+    if (!c) return 0;
+
+    client_track_ip(c);
+    client_set_name(c, name);
+    if (session[0])
+        snprintf(c->session_id, sizeof(c->session_id), "%s", session);
+    c->rating = rating;
+
+    AdoptArg* a = malloc(sizeof(AdoptArg));
+    if (!a) {
+        client_destroy(c);
+        return 1;
+    }
+    a->c = c;
+    snprintf(a->line, sizeof(a->line), "%s", line);
+    pthread_t th;
+    if (pthread_create(&th, NULL, adopted_thread, a) != 0) {
+        perror("pthread_create");
+        free(a);
+        client_destroy(c);
+        return 1;
+    }
+    pthread_detach(th);
+    return 1;
+}
+
+
+// ============================================================
+//  Clients carried over by a live upgrade
+// ============================================================
+
+static void* resumed_thread(void* arg) {
+    client_loop((struct Client*)arg);
+    return NULL;
+}
+
+int client_resume(struct Client* c) {
+    pthread_t th;
+    if (pthread_create(&th, NULL, resumed_thread, c) != 0) {
+        perror("pthread_create");
+        return 0;
+    }
+    pthread_detach(th);
+    return 1;
+}
+
+
 // ============================================================
 //  Internal helpers (JOIN, QUIT)
 // ============================================================
@@ -297,6 +652,7 @@ static void handle_join(struct Client* c, const char* payload) {
 
     sendp(c->fd, "JOINED|%s", c->name);
     sendp(c->fd, "SESSION|%s", c->session_id);
+    presence_set(c, PRES_LOBBY, -1);
 }
 
 static void handle_quit(struct Client* c) {
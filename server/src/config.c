@@ -1,13 +1,22 @@
 #include "config.h"
+#include "client.h"
+#include "room.h"
+#include "shard.h"
+#include "timer.h"
+#include "log.h"
 
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
-ServerConfig g_config;
+static ServerConfig g_boot;                         // Until the first config_publish()
+static _Atomic(const ServerConfig*) g_active = &g_boot;
 
-void config_load(const char* filename, ServerConfig* cfg)
+int config_load(const char* filename, ServerConfig* cfg)
 {
-    if (!cfg) return;
+    if (!cfg) return 0;
 
     // Defaults
     cfg->port = 10000;
@@ -15,9 +24,28 @@ void config_load(const char* filename, ServerConfig* cfg)
     cfg->max_clients = 128;
     strcpy(cfg->bind_address, "0.0.0.0");
     cfg->disconnect_grace = 60;
+    cfg->fanout_workers = 2;
+    cfg->invite_ttl = 600;
+    cfg->series_pause_ms = 1500;
+    strcpy(cfg->friends_file, "friends.db");
+    cfg->admin_token[0] = '\0';
+    cfg->workers = 1;
+    cfg->drain_timeout = 300;
+    cfg->room_id_base = 0;
+    cfg->listen_unix[0] = '\0';
+    cfg->prealloc_clients = 0;
+    cfg->prealloc_rooms = 0;
+    cfg->ready_file[0] = '\0';
+    cfg->overload_lag_ms = 100;
+    cfg->overload_queue = 1000;
+    cfg->rebalance_ms = 5000;
+    cfg->rate_client = 20;
+    cfg->rate_ip = 200;
+    cfg->conn_per_ip = 16;
+    cfg->conn_per_net24 = 64;
 
     FILE* f = fopen(filename, "r");
-    if (!f) return; // fallback to defaults
+    if (!f) return 0; // fallback to defaults
 
     char line[256];
     while (fgets(line, sizeof(line), f)) {
@@ -26,10 +54,135 @@ void config_load(const char* filename, ServerConfig* cfg)
         (void)sscanf(line, "MAX_CLIENTS=%d", &cfg->max_clients);
         (void)sscanf(line, "BIND_ADDRESS=%31s", cfg->bind_address);
         (void)sscanf(line, "DISCONNECT_GRACE=%d", &cfg->disconnect_grace);
+        (void)sscanf(line, "FANOUT_WORKERS=%d", &cfg->fanout_workers);
+        (void)sscanf(line, "INVITE_TTL=%d", &cfg->invite_ttl);
+        (void)sscanf(line, "SERIES_PAUSE_MS=%d", &cfg->series_pause_ms);
+        (void)sscanf(line, "FRIENDS_FILE=%127s", cfg->friends_file);
+        (void)sscanf(line, "ADMIN_TOKEN=%63s", cfg->admin_token);
+        (void)sscanf(line, "WORKERS=%d", &cfg->workers);
+        (void)sscanf(line, "DRAIN_TIMEOUT=%d", &cfg->drain_timeout);
+        (void)sscanf(line, "ROOM_ID_BASE=%d", &cfg->room_id_base);
+        (void)sscanf(line, "LISTEN_UNIX=%107s", cfg->listen_unix);
+        (void)sscanf(line, "PREALLOC_CLIENTS=%d", &cfg->prealloc_clients);
+        (void)sscanf(line, "PREALLOC_ROOMS=%d", &cfg->prealloc_rooms);
+        (void)sscanf(line, "READY_FILE=%127s", cfg->ready_file);
+        (void)sscanf(line, "OVERLOAD_LAG_MS=%d", &cfg->overload_lag_ms);
+        (void)sscanf(line, "OVERLOAD_QUEUE=%d", &cfg->overload_queue);
+        (void)sscanf(line, "REBALANCE_MS=%d", &cfg->rebalance_ms);
+        (void)sscanf(line, "RATE_CLIENT=%d", &cfg->rate_client);
+        (void)sscanf(line, "RATE_IP=%d", &cfg->rate_ip);
+        (void)sscanf(line, "CONN_PER_IP=%d", &cfg->conn_per_ip);
+        (void)sscanf(line, "CONN_PER_NET24=%d", &cfg->conn_per_net24);
     }
 
     fclose(f);
+    return 1;
+}
+
+
+// ============================================================
+//  Active snapshot
+// ============================================================
+const ServerConfig* config_get(void) {
+    return atomic_load(&g_active);
+}
+
+// Timer thread: nobody holds the retired snapshot any more
+static void on_retire(long ptr, long unused) {
+    (void)unused;
+    free((ServerConfig*)(intptr_t)ptr);
+}
+
+void config_publish(const ServerConfig* cfg) {
+    ServerConfig* next = malloc(sizeof(ServerConfig));
+    if (!next) return;
+    *next = *cfg;
+
+    const ServerConfig* prev = atomic_exchange(&g_active, next);
+    if (prev != &g_boot && !timer_arm(CONFIG_RETIRE_MS, on_retire, (long)(intptr_t)prev, 0)) {
+        server_log("Config: no timer for the retired snapshot, keeping it");
+    }
+}
+
+int config_validate(const ServerConfig* cfg, char* err, size_t cap) {
+    if (cfg->port <= 0 || cfg->port > 65535)
+        snprintf(err, cap, "PORT must be 1..65535");
+    else if (cfg->max_rooms < 1 || cfg->max_rooms > MAX_ROOMS)
+        snprintf(err, cap, "MAX_ROOMS must be 1..%d", MAX_ROOMS);
+    else if (cfg->max_clients < 1 || cfg->max_clients > MAX_CLIENTS)
+        snprintf(err, cap, "MAX_CLIENTS must be 1..%d", MAX_CLIENTS);
+    else if (cfg->disconnect_grace < 1)
+        snprintf(err, cap, "DISCONNECT_GRACE must be at least 1");
+    else if (cfg->invite_ttl < 1)
+        snprintf(err, cap, "INVITE_TTL must be at least 1");
+    else if (cfg->series_pause_ms < 0)
+        snprintf(err, cap, "SERIES_PAUSE_MS must not be negative");
+    else if (cfg->workers < 1 || cfg->workers > SHARD_MAX_WORKERS)
+        snprintf(err, cap, "WORKERS must be 1..%d", SHARD_MAX_WORKERS);
+    else if (cfg->drain_timeout < 1)
+        snprintf(err, cap, "DRAIN_TIMEOUT must be at least 1");
+    else if (cfg->room_id_base < 0)
+        snprintf(err, cap, "ROOM_ID_BASE must not be negative");
+    else if (cfg->prealloc_clients < 0 || cfg->prealloc_clients > MAX_CLIENTS)
+        snprintf(err, cap, "PREALLOC_CLIENTS must be 0..%d", MAX_CLIENTS);
+    else if (cfg->prealloc_rooms < 0 || cfg->prealloc_rooms > MAX_ROOMS)
+        snprintf(err, cap, "PREALLOC_ROOMS must be 0..%d", MAX_ROOMS);
+    else if (cfg->overload_lag_ms < 0 || cfg->overload_queue < 0)
+        snprintf(err, cap, "OVERLOAD_LAG_MS and OVERLOAD_QUEUE must not be negative");
+    else if (cfg->rebalance_ms < 0)
+        snprintf(err, cap, "REBALANCE_MS must not be negative");
+    else if (cfg->rate_client < 0 || cfg->rate_ip < 0)
+        snprintf(err, cap, "RATE_CLIENT and RATE_IP must not be negative");
+    else if (cfg->conn_per_ip < 0 || cfg->conn_per_net24 < 0)
+        snprintf(err, cap, "CONN_PER_IP and CONN_PER_NET24 must not be negative");
+    else
+        return 1;
+    return 0;
+}
+
+int config_reload(const char* filename) {
+    ServerConfig next;
+    char err[96];
+    if (!config_load(filename, &next)) {
+        server_log("Config reload: cannot read %s, keeping the running config", filename);
+        return 0;
+    }
+    if (!config_validate(&next, err, sizeof(err))) {
+        server_log("Config reload rejected: %s", err);
+        return 0;
+    }
+
+    // Start-up only keys keep their running value
+    const ServerConfig* cur = config_get();
+    if (next.port != cur->port || strcmp(next.bind_address, cur->bind_address) != 0)
+        server_log("Config reload: PORT / BIND_ADDRESS change needs a restart");
+    if (next.workers != cur->workers)
+        server_log("Config reload: WORKERS change needs a restart");
+    if (next.fanout_workers != cur->fanout_workers)
+        server_log("Config reload: FANOUT_WORKERS change needs a restart");
+    if (strcmp(next.friends_file, cur->friends_file) != 0)
+        server_log("Config reload: FRIENDS_FILE change needs a restart");
+    if (next.room_id_base != cur->room_id_base)
+        server_log("Config reload: ROOM_ID_BASE change needs a restart");
+    if (strcmp(next.listen_unix, cur->listen_unix) != 0)
+        server_log("Config reload: LISTEN_UNIX change needs a restart");
+    if (next.prealloc_clients != cur->prealloc_clients || next.prealloc_rooms != cur->prealloc_rooms ||
+        strcmp(next.ready_file, cur->ready_file) != 0)
+        server_log("Config reload: PREALLOC_* / READY_FILE change needs a restart");
+    next.port = cur->port;
+    memcpy(next.bind_address, cur->bind_address, sizeof(next.bind_address));
+    next.workers = cur->workers;
+    next.fanout_workers = cur->fanout_workers;
+    next.room_id_base = cur->room_id_base;
+    memcpy(next.friends_file, cur->friends_file, sizeof(next.friends_file));
+    memcpy(next.listen_unix, cur->listen_unix, sizeof(next.listen_unix));
+    next.prealloc_clients = cur->prealloc_clients;
+    next.prealloc_rooms = cur->prealloc_rooms;
+    memcpy(next.ready_file, cur->ready_file, sizeof(next.ready_file));
 
-    // Mirror to global config for modules that read it directly.
-    g_config = *cfg;
+    config_publish(&next);
+    server_log("Config reloaded: max_rooms=%d max_clients=%d grace=%ds invite_ttl=%ds series_pause=%dms",
+               next.max_rooms, next.max_clients, next.disconnect_grace,
+               next.invite_ttl, next.series_pause_ms);
+    return 1;
 }
@@ -0,0 +1,105 @@
+// ============================================================
+//  CONNECTION LIMIT MODULE IMPLEMENTATION
+//  ------------------------------------------------------------
+//  A slot with count 0 is free. Deleting shifts the following
+//  run of the probe sequence back, so lookups never have to
+//  skip deleted slots and the tables never need a rehash.
+// ============================================================
+
+#include "connlimit.h"
+#include "config.h"
+#include "stats.h"
+
+#include <pthread.h>
+
+typedef struct {
+    uint32_t key;
+    uint32_t count;             // 0 = free slot
+} ConnSlot;
+
+typedef struct {
+    ConnSlot slots[CONN_SLOTS];
+} ConnTable;
+
+static ConnTable g_hosts;       // Keyed by address
+static ConnTable g_nets;        // Keyed by address >> 8
+static pthread_mutex_t g_conn_mtx = PTHREAD_MUTEX_INITIALIZER;   // Leaf lock
+
+
+static unsigned home_of(uint32_t key) {
+    return (key * 2654435761u) & (CONN_SLOTS - 1);
+}
+
+// Slot holding key, or the free slot where it would go
+static ConnSlot* probe(ConnTable* t, uint32_t key) {
+    unsigned i = home_of(key);
+    while (t->slots[i].count && t->slots[i].key != key) i = (i + 1) & (CONN_SLOTS - 1);
+    return &t->slots[i];
+}
+
+static uint32_t count_of(ConnTable* t, uint32_t key) {
+    return probe(t, key)->count;
+}
+
+static void add(ConnTable* t, uint32_t key) {
+    ConnSlot* s = probe(t, key);
+    s->key = key;
+    s->count++;
+}
+
+static void drop(ConnTable* t, uint32_t key) {
+    ConnSlot* s = probe(t, key);
+    if (!s->count || --s->count) return;
+
+    // Backward shift: pull later entries of the run into the hole
+    // unless their home lies cyclically in (hole, j]
+    unsigned hole = (unsigned)(s - t->slots);
+    for (unsigned j = (hole + 1) & (CONN_SLOTS - 1); t->slots[j].count;
+         j = (j + 1) & (CONN_SLOTS - 1)) {
+        unsigned home = home_of(t->slots[j].key);
+        bool stays = (hole <= j) ? (hole < home && home <= j)
+                                 : (hole < home || home <= j);
+        if (stays) continue;
+        t->slots[hole] = t->slots[j];
+        t->slots[j].count = 0;
+        hole = j;
+    }
+}
+
+
+// ============================================================
+//  Public API
+// ============================================================
+bool conn_admit(uint32_t ip) {
+    if (!ip) return true;
+    const ServerConfig* cfg = config_get();
+
+    pthread_mutex_lock(&g_conn_mtx);
+    bool host_full = cfg->conn_per_ip > 0 && count_of(&g_hosts, ip) >= (uint32_t)cfg->conn_per_ip;
+    bool net_full = cfg->conn_per_net24 > 0 && count_of(&g_nets, ip >> 8) >= (uint32_t)cfg->conn_per_net24;
+    if (!host_full && !net_full) {
+        add(&g_hosts, ip);
+        add(&g_nets, ip >> 8);
+    }
+    pthread_mutex_unlock(&g_conn_mtx);
+
+    if (host_full) stats_inc(STAT_REJECT_PER_IP);
+    else if (net_full) stats_inc(STAT_REJECT_PER_NET);
+    return !host_full && !net_full;
+}
+
+void conn_track(uint32_t ip) {
+    if (!ip) return;
+    pthread_mutex_lock(&g_conn_mtx);
+    add(&g_hosts, ip);
+    add(&g_nets, ip >> 8);
+    pthread_mutex_unlock(&g_conn_mtx);
+}
+
+void conn_release(uint32_t ip) {
+    if (!ip) return;
+    pthread_mutex_lock(&g_conn_mtx);
+    drop(&g_hosts, ip);
+    drop(&g_nets, ip >> 8);
+    pthread_mutex_unlock(&g_conn_mtx);
+}
@@ -0,0 +1,142 @@
+// ============================================================
+//  DRAIN MODULE IMPLEMENTATION
+//  ------------------------------------------------------------
+//  A self re-arming timer (DRAIN_TICK_MS) closes rooms whose
+//  game is over, tells new lobby clients to go elsewhere and
+//  wakes the accept thread once the drain is complete.
+// ============================================================
+
+#include "drain.h"
+#include "client.h"
+#include "config.h"
+#include "ready.h"
+#include "room.h"
+#include "timer.h"
+#include "utils.h"
+#include "log.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+
+#define DRAIN_REASON   "Server is draining, please reconnect elsewhere"
+#define DRAIN_DEADLINE "Server shut down for maintenance"
+
+static atomic_bool g_active;
+static int g_listen_fd = -1;
+static int g_unix_fd = -1;
+static long long g_deadline_ms;
+static int g_ticks;
+
+static pthread_mutex_t g_drain_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  g_drain_cv = PTHREAD_COND_INITIALIZER;
+static bool g_done = false;
+
+
+static long seconds_left(void) {
+    long long left = g_deadline_ms - now_ms();
+    return left > 0 ? (long)((left + 999) / 1000) : 0;
+}
+
+// Sends DRAINING| to lobby clients that have not had it yet;
+// returns the number of connected clients
+static int notify_lobby(long left) {
+    int n = 0;
+    pthread_mutex_lock(&g_clients_mtx);
+    for (int i = 0; i < g_client_cap; i++) {
+        struct Client* c = g_clients[i];
+        if (!c || c->is_bot || !c->connected) continue;
+        n++;
+        if (c->drain_told || c->current_room || c->spectate_room_id >= 0) continue;
+        sendp(c->fd, "DRAINING|%ld", left);
+        c->drain_told = true;
+    }
+    pthread_mutex_unlock(&g_clients_mtx);
+    return n;
+}
+
+static void finish(int rooms, int clients) {
+    server_log("Drain complete: %d rooms, %d clients left", rooms, clients);
+    pthread_mutex_lock(&g_drain_mtx);
+    g_done = true;
+    pthread_cond_broadcast(&g_drain_cv);
+    pthread_mutex_unlock(&g_drain_mtx);
+}
+
+// Timer thread
+static void on_tick(long unused_a, long unused_b) {
+    (void)unused_a;
+    (void)unused_b;
+    bool late = now_ms() >= g_deadline_ms;
+    int rooms = room_drain_pass(late, late ? DRAIN_DEADLINE : DRAIN_REASON);
+    int clients = notify_lobby(seconds_left());
+
+    if (rooms == 0 || late) {
+        finish(rooms, clients);
+        return;
+    }
+    if (++g_ticks % DRAIN_LOG_EVERY == 0)
+        server_log("Drain: %d rooms, %d clients remaining, %lds left", rooms, clients, seconds_left());
+    if (!timer_arm(DRAIN_TICK_MS, on_tick, 0, 0)) {
+        server_log("Drain: no timer for the next check, stopping now");
+        finish(rooms, clients);
+    }
+}
+
+
+// ============================================================
+//  Public API
+// ============================================================
+void drain_init(int listen_fd, int unix_fd) {
+    g_listen_fd = listen_fd;
+    g_unix_fd = unix_fd;
+}
+
+int drain_start(int deadline_s) {
+    if (deadline_s <= 0) deadline_s = config_get()->drain_timeout;
+
+    // The deadline is published by the store of g_active
+    pthread_mutex_lock(&g_drain_mtx);
+    if (atomic_load(&g_active)) {
+        pthread_mutex_unlock(&g_drain_mtx);
+        return 0;
+    }
+    g_deadline_ms = now_ms() + (long long)deadline_s * 1000;
+    atomic_store(&g_active, true);
+    pthread_mutex_unlock(&g_drain_mtx);
+    ready_clear();
+
+    // Refused connections from here on; accept() fails and the
+    // accept loop waits in drain_wait()
+    if (g_listen_fd >= 0) shutdown(g_listen_fd, SHUT_RDWR);
+    if (g_unix_fd >= 0) shutdown(g_unix_fd, SHUT_RDWR);
+    server_log("Drain started: no new connections or rooms, deadline %d s", deadline_s);
+
+    if (!timer_arm(0, on_tick, 0, 0)) finish(-1, -1);
+    return 1;
+}
+
+bool drain_active(void) {
+    return atomic_load(&g_active);
+}
+
+void drain_status(DrainStatus* out) {
+    out->active = drain_active();
+    pthread_mutex_lock(&g_rooms_mtx);
+    out->rooms = g_room_count;
+    pthread_mutex_unlock(&g_rooms_mtx);
+    out->clients = 0;
+    pthread_mutex_lock(&g_clients_mtx);
+    for (int i = 0; i < g_client_cap; i++) {
+        struct Client* c = g_clients[i];
+        if (c && !c->is_bot && c->connected) out->clients++;
+    }
+    pthread_mutex_unlock(&g_clients_mtx);
+    out->seconds_left = out->active ? seconds_left() : 0;
+}
+
+void drain_wait(void) {
+    pthread_mutex_lock(&g_drain_mtx);
+    while (!g_done) pthread_cond_wait(&g_drain_cv, &g_drain_mtx);
+    pthread_mutex_unlock(&g_drain_mtx);
+}
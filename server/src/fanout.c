@@ -0,0 +1,351 @@
+// ============================================================
+//  FANOUT MODULE IMPLEMENTATION
+//  ------------------------------------------------------------
+//  Worker threads delivering shared encoded messages to room
+//  spectators and lobby clients. Each room is pinned to one
+//  worker (room_id % N) so events of a single room keep their
+//  order; lobby traffic has a shard of its own. Broadcasts are
+//  the exception: they are split across all workers.
+//
+//  Room events carry the audience snapshot taken when they were
+//  published, so delivery needs no lock at all.
+// ============================================================
+
+#include "fanout.h"
+#include "room.h"
+#include "client.h"
+#include "stats.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+// ------------------------------------------------------------
+//  Job queue (one per worker)
+// ------------------------------------------------------------
+#define SHARD_LOBBY (-1)
+
+typedef enum {
+    TARGET_AUDIENCE = 0,    // Audience snapshot taken at publish time
+    TARGET_LOBBY    = 1,    // Lobby clients, resolved at delivery
+    TARGET_CLIENTS  = 2     // Held receivers (or a slice of them)
+} FanoutTarget;
+
+typedef struct FanoutJob {
+    struct FanoutJob* next;
+    FanoutTarget target;
+    int room_id;            // Shard key
+    Audience* audience;     // One reference (NULL for TARGET_LOBBY)
+    int off;                // TARGET_CLIENTS: first member and count
+    int n;
+    SharedMsg* msg;
+} FanoutJob;
+
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t mtx;
+    pthread_cond_t cv;
+    FanoutJob* head;
+    FanoutJob* tail;
+} FanoutWorker;
+
+static FanoutWorker g_workers[FANOUT_MAX_WORKERS];
+static int g_worker_count = 0;
+static atomic_int g_pending = 0;    // Jobs queued or being delivered
+
+
+// ============================================================
+//  Shared message helpers
+// ============================================================
+
+static SharedMsg* shared_msg_vcreate(const char* fmt, va_list ap) {
+    char payload[256];
+    vsnprintf(payload, sizeof(payload), fmt, ap);
+
+    size_t len = strlen(payload) + 3;   // "##" + payload + '\n'
+    SharedMsg* m = malloc(sizeof(SharedMsg) + len + 1);
+    if (!m) return NULL;
+
+    atomic_init(&m->refs, 1);
+    m->len = (size_t)snprintf(m->data, len + 1, "##%s\n", payload);
+    return m;
+}
+
+SharedMsg* shared_msg_create(const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    SharedMsg* m = shared_msg_vcreate(fmt, ap);
+    va_end(ap);
+    return m;
+}
+
+void shared_msg_release(SharedMsg* m) {
+    if (!m) return;
+    if (atomic_fetch_sub(&m->refs, 1) == 1) free(m);
+}
+
+
+// ============================================================
+//  Audience snapshots (writers hold g_rooms_mtx)
+// ============================================================
+
+Audience* audience_alloc(int cap) {
+    Audience* a = malloc(sizeof(Audience) + (size_t)cap * sizeof(struct Client*));
+    if (!a) return NULL;
+    atomic_init(&a->refs, 1);
+    a->n = 0;
+    return a;
+}
+
+void audience_push(Audience* a, struct Client* c) {
+    client_hold(c);
+    a->members[a->n++] = c;
+}
+
+int audience_add(Audience** slot, struct Client* c) {
+    Audience* old = *slot;
+    Audience* a = audience_alloc((old ? old->n : 0) + 1);
+    if (!a) return 0;
+    for (int i = 0; old && i < old->n; i++)
+        audience_push(a, old->members[i]);
+    audience_push(a, c);
+    *slot = a;
+    audience_release(old);
+    return 1;
+}
+
+void audience_remove(Audience** slot, const struct Client* c) {
+    Audience* old = *slot;
+    int idx = -1;
+    for (int i = 0; old && i < old->n && idx < 0; i++)
+        if (old->members[i] == c) idx = i;
+    if (idx < 0) return;
+
+    Audience* a = NULL;
+    if (old->n > 1) {
+        a = audience_alloc(old->n - 1);
+        if (!a) return;
+        for (int i = 0; i < old->n; i++)
+            if (i != idx) audience_push(a, old->members[i]);
+    }
+    *slot = a;
+    audience_release(old);
+}
+
+void audience_release(Audience* a) {
+    if (!a || atomic_fetch_sub(&a->refs, 1) != 1) return;
+    for (int i = 0; i < a->n; i++) client_release(a->members[i]);
+    free(a);
+}
+
+
+// ============================================================
+//  Delivery
+// ============================================================
+
+static void count_delivery(const SharedMsg* m, long sent, long dropped) {
+    stats_add(STAT_FANOUT_DELIVERED, sent);
+    stats_add(STAT_FANOUT_DROPPED, dropped);
+    stats_add(STAT_FANOUT_BYTES, sent * (long)m->len);
+}
+
+// A spectator that misses a MOVE shows a wrong board from then on, so
+// with strict set one that cannot take the whole event is disconnected
+// (its thread sees EOF and cleans up); SPECTATE again gets a fresh
+// snapshot. Otherwise a full socket buffer only drops the event, and
+// only a partial write - the next frame boundary is lost - disconnects.
+// Members are held, so c->fd is still this client's socket.
+static void deliver_audience(const SharedMsg* m, struct Client* const* members, int n, int strict) {
+    long sent = 0, dropped = 0;
+    for (int i = 0; i < n; i++) {
+        struct Client* c = members[i];
+        ssize_t r = send(c->fd, m->data, m->len, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (r == (ssize_t)m->len) { sent++; continue; }
+        dropped++;
+        if (!strict && r <= 0) continue;
+        server_log("Fan-out: %s too slow, disconnecting", c->name);
+        shutdown(c->fd, SHUT_RDWR);
+    }
+    count_delivery(m, sent, dropped);
+}
+
+static void* fanout_thread(void* arg) {
+    FanoutWorker* w = (FanoutWorker*)arg;
+
+    while (1) {
+        pthread_mutex_lock(&w->mtx);
+        while (!w->head)
+            pthread_cond_wait(&w->cv, &w->mtx);
+        FanoutJob* job = w->head;
+        w->head = job->next;
+        if (!w->head) w->tail = NULL;
+        pthread_mutex_unlock(&w->mtx);
+
+        if (job->target == TARGET_AUDIENCE) {
+            deliver_audience(job->msg, job->audience->members, job->audience->n, 1);
+        } else if (job->target == TARGET_CLIENTS) {
+            deliver_audience(job->msg, job->audience->members + job->off, job->n, 0);
+        } else {
+            Audience* lobby = client_lobby_audience();
+            if (lobby) deliver_audience(job->msg, lobby->members, lobby->n, 0);
+            audience_release(lobby);
+        }
+
+        shared_msg_release(job->msg);
+        audience_release(job->audience);
+        free(job);
+        atomic_fetch_sub(&g_pending, 1);
+    }
+    return NULL;
+}
+
+// Takes ownership of msg and one reference on audience
+static void enqueue(FanoutTarget target, int shard, Audience* audience, SharedMsg* msg) {
+    FanoutJob* job = NULL;
+    // Workers not running (early startup) - nothing to deliver to yet
+    if (msg && g_worker_count > 0) job = malloc(sizeof(FanoutJob));
+    if (!job) {
+        shared_msg_release(msg);
+        audience_release(audience);
+        return;
+    }
+    job->next = NULL;
+    job->target = target;
+    job->room_id = shard;
+    job->audience = audience;
+    job->off = 0;
+    job->n = audience ? audience->n : 0;
+    job->msg = msg;
+
+    unsigned idx = (unsigned)shard % (unsigned)g_worker_count;
+    FanoutWorker* w = &g_workers[idx];
+    atomic_fetch_add(&g_pending, 1);
+    pthread_mutex_lock(&w->mtx);
+    if (w->tail) w->tail->next = job;
+    else         w->head = job;
+    w->tail = job;
+    pthread_cond_signal(&w->cv);
+    pthread_mutex_unlock(&w->mtx);
+}
+
+
+// ============================================================
+//  Public API
+// ============================================================
+
+void fanout_start(int workers) {
+    if (g_worker_count > 0) return;
+    if (workers < 1) workers = 1;
+    if (workers > FANOUT_MAX_WORKERS) workers = FANOUT_MAX_WORKERS;
+
+    for (int i = 0; i < workers; i++) {
+        FanoutWorker* w = &g_workers[i];
+        pthread_mutex_init(&w->mtx, NULL);
+        pthread_cond_init(&w->cv, NULL);
+        w->head = w->tail = NULL;
+        if (pthread_create(&w->thread, NULL, fanout_thread, w) != 0) {
+            perror("pthread_create");
+            break;
+        }
+        pthread_detach(w->thread);
+        g_worker_count = i + 1;
+    }
+    server_log("Fan-out started with %d worker(s)", g_worker_count);
+}
+
+int fanout_pending(void) {
+    return atomic_load(&g_pending);
+}
+
+void fanout_room(const Room* r, const char* fmt, ...) {
+    if (!r->audience) return;
+    va_list ap;
+    va_start(ap, fmt);
+    SharedMsg* m = shared_msg_vcreate(fmt, ap);
+    va_end(ap);
+    atomic_fetch_add(&r->audience->refs, 1);
+    enqueue(TARGET_AUDIENCE, r->id, r->audience, m);
+}
+
+void fanout_snapshot(const Room* r, struct Client* c, const char* data, size_t len) {
+    Audience* one = NULL;
+    if (!audience_add(&one, c)) return;
+    SharedMsg* m = malloc(sizeof(SharedMsg) + len + 1);
+    if (m) {
+        atomic_init(&m->refs, 1);
+        m->len = len;
+        memcpy(m->data, data, len);
+        m->data[len] = '\0';
+    }
+    enqueue(TARGET_AUDIENCE, r->id, one, m);
+}
+
+void fanout_lobby(const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    SharedMsg* m = shared_msg_vcreate(fmt, ap);
+    va_end(ap);
+    enqueue(TARGET_LOBBY, SHARD_LOBBY, NULL, m);
+}
+
+void fanout_broadcast(Audience* a, const char* fmt, ...) {
+    if (!a) return;
+    if (g_worker_count == 0) { audience_release(a); return; }
+    va_list ap;
+    va_start(ap, fmt);
+    SharedMsg* m = shared_msg_vcreate(fmt, ap);
+    va_end(ap);
+    if (!m) { audience_release(a); return; }
+
+    // Build every worker's chain first, then splice each in one go
+    FanoutJob* heads[FANOUT_MAX_WORKERS] = { 0 };
+    FanoutJob* tails[FANOUT_MAX_WORKERS] = { 0 };
+    int jobs = 0;
+    for (int off = 0; off < a->n; off += FANOUT_BATCH) {
+        FanoutJob* job = malloc(sizeof(FanoutJob));
+        if (!job) break;
+
+        job->next = NULL;
+        job->target = TARGET_CLIENTS;
+        job->room_id = SHARD_LOBBY;
+        job->audience = a;
+        job->off = off;
+        job->n = (a->n - off < FANOUT_BATCH) ? a->n - off : FANOUT_BATCH;
+        job->msg = m;
+
+        int w = jobs++ % g_worker_count;
+        if (tails[w]) tails[w]->next = job;
+        else          heads[w] = job;
+        tails[w] = job;
+    }
+
+    // One reference per job; the creation references are dropped below
+    atomic_fetch_add(&m->refs, jobs);
+    atomic_fetch_add(&a->refs, jobs);
+    atomic_fetch_add(&g_pending, jobs);
+    for (int i = 0; i < g_worker_count; i++) {
+        if (!heads[i]) continue;
+        FanoutWorker* w = &g_workers[i];
+        pthread_mutex_lock(&w->mtx);
+        if (w->tail) w->tail->next = heads[i];
+        else         w->head = heads[i];
+        w->tail = tails[i];
+        pthread_cond_signal(&w->cv);
+        pthread_mutex_unlock(&w->mtx);
+    }
+    shared_msg_release(m);
+    audience_release(a);
+}
+
+void fanout_clients(int shard, Audience* a, const char* fmt, ...) {
+    if (!a) return;
+    va_list ap;
+    va_start(ap, fmt);
+    SharedMsg* m = shared_msg_vcreate(fmt, ap);
+    va_end(ap);
+    enqueue(TARGET_CLIENTS, shard, a, m);
+}
@@ -0,0 +1,85 @@
+// ============================================================
+//  FEED MODULE IMPLEMENTATION
+//  ------------------------------------------------------------
+//  A handful of subscriber slots behind a leaf lock. Updates
+//  are written straight from the room code (under g_rooms_mtx),
+//  so a subscriber sees them in the order they happened.
+// ============================================================
+
+#include "feed.h"
+#include "client.h"
+#include "room.h"
+#include "utils.h"
+#include "log.h"
+
+#include <pthread.h>
+
+static struct Client* g_subs[FEED_MAX_SUBSCRIBERS];
+static int g_sub_count = 0;
+static pthread_mutex_t g_feed_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+
+// Expects g_feed_mtx held
+static void send_room(int fd, const Room* r) {
+    sendp(fd, "FEED|ROOM|%d|%s|%d|%d|%s|%s|%s|%s",
+          r->id, r->state == ROOM_WAITING ? "WAITING" : "PLAYING",
+          (r->p1 != NULL) + (r->p2 != NULL), r->opts.is_private ? 1 : 0,
+          r->invite_code, r->p1_name, r->p2_name, r->name);
+}
+
+
+// ============================================================
+//  Subscribers
+// ============================================================
+int feed_subscribe(struct Client* c) {
+    pthread_mutex_lock(&g_rooms_mtx);
+    pthread_mutex_lock(&g_feed_mtx);
+    int ok = 0;
+    for (int i = 0; i < g_sub_count; i++)
+        if (g_subs[i] == c) ok = 1;
+    if (!ok && g_sub_count < FEED_MAX_SUBSCRIBERS) {
+        g_subs[g_sub_count++] = c;
+        ok = 1;
+        for (int i = 0; i < g_room_count; i++)
+            if (g_rooms[i]->state != ROOM_EMPTY) send_room(c->fd, g_rooms[i]);
+        server_log("Room feed: %s subscribed (%d rooms)", c->name[0] ? c->name : "(unknown)", g_room_count);
+    }
+    pthread_mutex_unlock(&g_feed_mtx);
+    pthread_mutex_unlock(&g_rooms_mtx);
+    return ok;
+}
+
+void feed_unsubscribe(struct Client* c) {
+    pthread_mutex_lock(&g_feed_mtx);
+    for (int i = 0; i < g_sub_count; i++) {
+        if (g_subs[i] != c) continue;
+        g_subs[i] = g_subs[--g_sub_count];
+        break;
+    }
+    pthread_mutex_unlock(&g_feed_mtx);
+}
+
+int feed_is_subscribed(const struct Client* c) {
+    int found = 0;
+    pthread_mutex_lock(&g_feed_mtx);
+    for (int i = 0; i < g_sub_count; i++)
+        if (g_subs[i] == c) found = 1;
+    pthread_mutex_unlock(&g_feed_mtx);
+    return found;
+}
+
+
+// ============================================================
+//  Updates (g_rooms_mtx held by the caller)
+// ============================================================
+void feed_room(const Room* r) {
+    pthread_mutex_lock(&g_feed_mtx);
+    for (int i = 0; i < g_sub_count; i++) send_room(g_subs[i]->fd, r);
+    pthread_mutex_unlock(&g_feed_mtx);
+}
+
+void feed_gone(int room_id) {
+    pthread_mutex_lock(&g_feed_mtx);
+    for (int i = 0; i < g_sub_count; i++) sendp(g_subs[i]->fd, "FEED|GONE|%d", room_id);
+    pthread_mutex_unlock(&g_feed_mtx);
+}
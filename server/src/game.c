@@ -10,6 +10,9 @@
 #include "room.h"
 #include "utils.h"
 #include "log.h"
+#include "fanout.h"
+#include "matchmaking.h"
+#include "bot.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -61,17 +64,23 @@ int game_move(struct Room* r, struct Client* who, int x, int y) {
     // --- place symbol ---
     char sym = (who == r->p1) ? 'X' : 'O';
     g->board[y][x] = sym;
+    room_clock_stop(r, 1);
     server_log("Move: room %s %s (%c) -> %d,%d", r->name, who->name, sym, x, y);
 
     // Broadcast move to both players
     if (r->p1) sendp(r->p1->fd, "MOVE|%s|%d|%d", who->name, x, y);
     if (r->p2) sendp(r->p2->fd, "MOVE|%s|%d|%d", who->name, x, y);
 
+    // Spectators are served afterwards, by the fan-out workers
+    fanout_room(r, "MOVE|%s|%d|%d", who->name, x, y);
+
     // --- check for result ---
     int res = check_win(g->board);
     if (res == 1) { // Win
         g->state = 1;
         r->replay_p1 = r->replay_p2 = 0;
+        fanout_room(r, "RESULT|WIN|%s", who->name);
+        mm_rate_result(r->p1, r->p2, who == r->p1 ? 1 : -1);
 
         if (who == r->p1) {
             if (r->p1) sendp(r->p1->fd, "WIN|You");
@@ -83,6 +92,8 @@ int game_move(struct Room* r, struct Client* who, int x, int y) {
             server_log("Game result room %s: %s wins vs %s", r->name, r->p2_name, r->p1_name);
         }
         
+        room_game_over(r, who);
+
         /* If opponent is missing, end game without replay option */
         if (!r->p1 || !r->p2) {
             if (r->p1) sendp(r->p1->fd, "INFO|Game ended");
@@ -96,7 +107,10 @@ int game_move(struct Room* r, struct Client* who, int x, int y) {
         r->replay_p1 = r->replay_p2 = 0;
         if (r->p1) sendp(r->p1->fd, "DRAW|");
         if (r->p2) sendp(r->p2->fd, "DRAW|");
+        fanout_room(r, "RESULT|DRAW");
+        mm_rate_result(r->p1, r->p2, 0);
         server_log("Game result room %s: draw", r->name);
+        room_game_over(r, NULL);
         return 1;
     }
 
@@ -104,6 +118,8 @@ int game_move(struct Room* r, struct Client* who, int x, int y) {
     g->current_turn = (g->current_turn == r->p1) ? r->p2 : r->p1;
     if (g->current_turn)
         sendp(g->current_turn->fd, "TURN|Your move");
+    room_clock_start(r);
+    bot_on_turn(r);
     return 1;
 }
 
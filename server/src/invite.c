@@ -0,0 +1,223 @@
+// ============================================================
+//  INVITE MODULE IMPLEMENTATION
+//  ------------------------------------------------------------
+//  Linear-probing hash table with tombstones. When live + deleted
+//  slots exceed half of the capacity the table is rebuilt, which
+//  sweeps the tombstones out; it only doubles if the live codes
+//  alone fill a quarter of it, so create/remove churn does not
+//  grow it.
+//
+//  The module lock is a leaf: it is safe to call these functions
+//  with g_rooms_mtx held.
+// ============================================================
+
+#include "invite.h"
+#include "timer.h"
+#include "utils.h"
+#include "rng.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+
+#define INVITE_INITIAL_CAP 64
+
+// Unambiguous alphabet (no 0/O, 1/I)
+static const char ALPHABET[] = "ABCDEFGHJKLMNPQRSTUVWXYZ23456789";
+
+typedef enum { SLOT_FREE = 0, SLOT_USED = 1, SLOT_DELETED = 2 } SlotState;
+
+typedef struct {
+    SlotState state;
+    char code[INVITE_CODE_LEN + 1];
+    int room_id;
+    long long expires_ms;
+} InviteSlot;
+
+static InviteSlot* g_table = NULL;
+static size_t g_cap = 0;        // Always a power of two
+static size_t g_used = 0;       // USED + DELETED slots
+static size_t g_live = 0;       // USED slots
+static pthread_mutex_t g_invite_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+
+// ============================================================
+//  Table helpers (expect g_invite_mtx held)
+// ============================================================
+
+static size_t hash_code(const char* code) {
+    size_t h = 2166136261u;     // FNV-1a
+    for (const char* p = code; *p; p++) {
+        h ^= (unsigned char)*p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static InviteSlot* find_slot(const char* code) {
+    if (!g_cap) return NULL;
+    size_t mask = g_cap - 1;
+    for (size_t i = hash_code(code) & mask, n = 0; n < g_cap; i = (i + 1) & mask, n++) {
+        InviteSlot* s = &g_table[i];
+        if (s->state == SLOT_FREE) return NULL;
+        if (s->state == SLOT_USED && strcmp(s->code, code) == 0) return s;
+    }
+    return NULL;
+}
+
+static void insert_slot(const char* code, int room_id, long long expires_ms) {
+    size_t mask = g_cap - 1;
+    size_t i = hash_code(code) & mask;
+    while (g_table[i].state == SLOT_USED) i = (i + 1) & mask;
+
+    if (g_table[i].state == SLOT_FREE) g_used++;
+    g_live++;
+    g_table[i].state = SLOT_USED;
+    memcpy(g_table[i].code, code, INVITE_CODE_LEN + 1);
+    g_table[i].room_id = room_id;
+    g_table[i].expires_ms = expires_ms;
+}
+
+static void delete_slot(InviteSlot* s) {
+    s->state = SLOT_DELETED;
+    g_live--;
+}
+
+// Rebuilds the table without tombstones, twice as large if needed
+static int rehash(void) {
+    size_t old_cap = g_cap;
+    InviteSlot* old = g_table;
+
+    size_t cap = old_cap ? old_cap : INVITE_INITIAL_CAP;
+    if ((g_live + 1) * 4 > cap) cap *= 2;
+    InviteSlot* t = calloc(cap, sizeof(InviteSlot));
+    if (!t) return 0;
+
+    g_table = t;
+    g_cap = cap;
+    g_used = 0;
+    g_live = 0;
+    for (size_t i = 0; i < old_cap; i++)
+        if (old[i].state == SLOT_USED)
+            insert_slot(old[i].code, old[i].room_id, old[i].expires_ms);
+    free(old);
+    return 1;
+}
+
+// Upper-cases a code; 0 unless it is exactly INVITE_CODE_LEN long
+static int normalize(const char* in, char* out) {
+    size_t i = 0;
+    for (; in[i] && i < INVITE_CODE_LEN; i++)
+        out[i] = (char)toupper((unsigned char)in[i]);
+    out[i] = '\0';
+    return i == INVITE_CODE_LEN && in[i] == '\0';
+}
+
+
+// ============================================================
+//  Expiry (timer thread)
+// ============================================================
+
+// The code itself travels in the timer argument (6 bytes fit in a
+// long), so expiry is a single hash lookup.
+static long pack_code(const char* code) {
+    unsigned long v = 0;
+    for (int i = 0; i < INVITE_CODE_LEN; i++)
+        v = (v << 8) | (unsigned char)code[i];
+    return (long)v;
+}
+
+static void unpack_code(long packed, char* out) {
+    unsigned long v = (unsigned long)packed;
+    for (int i = INVITE_CODE_LEN - 1; i >= 0; i--) {
+        out[i] = (char)(v & 0xff);
+        v >>= 8;
+    }
+    out[INVITE_CODE_LEN] = '\0';
+}
+
+static void on_expire(long packed, long room_id) {
+    char code[INVITE_CODE_LEN + 1];
+    unpack_code(packed, code);
+
+    pthread_mutex_lock(&g_invite_mtx);
+    InviteSlot* s = find_slot(code);
+    if (s && s->room_id == room_id && s->expires_ms <= now_ms())
+        delete_slot(s);
+    pthread_mutex_unlock(&g_invite_mtx);
+}
+
+
+// ============================================================
+//  Public API
+// ============================================================
+
+int invite_create(int room_id, long ttl_ms, char* out) {
+    pthread_mutex_lock(&g_invite_mtx);
+    if ((g_used + 1) * 2 > g_cap && !rehash()) {
+        pthread_mutex_unlock(&g_invite_mtx);
+        return 0;
+    }
+
+    char code[INVITE_CODE_LEN + 1];
+    do {
+        for (int i = 0; i < INVITE_CODE_LEN; i++)
+            code[i] = ALPHABET[rng_below(sizeof(ALPHABET) - 1)];
+        code[INVITE_CODE_LEN] = '\0';
+    } while (find_slot(code));
+
+    insert_slot(code, room_id, now_ms() + ttl_ms);
+    pthread_mutex_unlock(&g_invite_mtx);
+
+    timer_arm(ttl_ms, on_expire, pack_code(code), room_id);
+    memcpy(out, code, INVITE_CODE_LEN + 1);
+    return 1;
+}
+
+int invite_lookup(const char* code) {
+    char key[INVITE_CODE_LEN + 1];
+    if (!normalize(code, key)) return -1;
+
+    pthread_mutex_lock(&g_invite_mtx);
+    InviteSlot* s = find_slot(key);
+    int id = -1;
+    if (s) {
+        if (s->expires_ms > now_ms()) id = s->room_id;
+        else                          delete_slot(s);
+    }
+    pthread_mutex_unlock(&g_invite_mtx);
+    return id;
+}
+
+int invite_restore(const char* code, int room_id, long ttl_ms) {
+    if (!code || strlen(code) != INVITE_CODE_LEN || ttl_ms <= 0) return 0;
+
+    pthread_mutex_lock(&g_invite_mtx);
+    if (((g_used + 1) * 2 > g_cap && !rehash()) || find_slot(code)) {
+        pthread_mutex_unlock(&g_invite_mtx);
+        return 0;
+    }
+    insert_slot(code, room_id, now_ms() + ttl_ms);
+    pthread_mutex_unlock(&g_invite_mtx);
+
+    timer_arm(ttl_ms, on_expire, pack_code(code), room_id);
+    return 1;
+}
+
+long invite_ttl_left(const char* code) {
+    if (!code || !code[0]) return 0;
+    pthread_mutex_lock(&g_invite_mtx);
+    InviteSlot* s = find_slot(code);
+    long left = s ? (long)(s->expires_ms - now_ms()) : 0;
+    pthread_mutex_unlock(&g_invite_mtx);
+    return left > 0 ? left : 0;
+}
+
+void invite_remove(const char* code) {
+    if (!code || !code[0]) return;
+    pthread_mutex_lock(&g_invite_mtx);
+    InviteSlot* s = find_slot(code);
+    if (s) delete_slot(s);
+    pthread_mutex_unlock(&g_invite_mtx);
+}
@@ -11,20 +11,35 @@ static pthread_mutex_t g_log_mtx = PTHREAD_MUTEX_INITIALIZER;
 
 void log_init(const char* path) {
     if (g_log) return;
-    g_log = fopen(path, "w");
+    // Truncate, then append: a live-upgrade successor shares the file
+    FILE* f = fopen(path, "w");
+    if (f) fclose(f);
+    g_log = fopen(path, "a");
+}
+
+// Continues an existing log (process started by a live upgrade)
+void log_init_append(const char* path) {
+    if (g_log) return;
+    g_log = fopen(path, "a");
 }
 
 void log_close() {
+    pthread_mutex_lock(&g_log_mtx);     // other threads may still log
     if (g_log) {
         fclose(g_log);
         g_log = NULL;
     }
+    pthread_mutex_unlock(&g_log_mtx);
 }
 
 void server_log(const char* fmt, ...) {
     if (!g_log) return;
     
     pthread_mutex_lock(&g_log_mtx);
+    if (!g_log) {
+        pthread_mutex_unlock(&g_log_mtx);
+        return;
+    }
     time_t now = time(NULL);
     struct tm* tm_info = localtime(&now);
     char tbuf[32];
@@ -3,6 +3,7 @@
 #include <stdarg.h>
 
 void log_init(const char* path);
+void log_init_append(const char* path);
 void log_close();
 void server_log(const char* fmt, ...);
 
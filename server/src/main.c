@@ -2,12 +2,22 @@
 //  SERVER MAIN MODULE
 //  ------------------------------------------------------------
 //  Entry point for the Tic-Tac-Toe server. Handles:
-//   - socket initialization
+//   - socket initialization (TCP, plus LISTEN_UNIX for local gateways)
 //   - connection accept loop
 //   - client thread creation
 //   - heartbeat system for disconnection detection
+//   - optional multi-process mode (see shard.h)
+//   - live upgrade without dropping connections (see upgrade.h)
+//   - configuration reload on SIGHUP (see config.h)
+//   - graceful drain on SIGQUIT (see drain.h)
 // ============================================================
 
+#define _GNU_SOURCE  // SO_REUSEPORT
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -15,17 +25,41 @@
 #include <stdint.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <pthread.h>
-#include <time.h>
+#include <signal.h>
 
 #include "utils.h"
 #include "room.h"
 #include "client.h"
 #include "config.h"
 #include "log.h"
+#include "fanout.h"
+#include "matchmaking.h"
+#include "stats.h"
+#include "timer.h"
+#include "tournament.h"
+#include "presence.h"
+#include "shard.h"
+#include "upgrade.h"
+#include "drain.h"
+#include "ready.h"
+#include "overload.h"
+#include "rebalance.h"
+#include "connlimit.h"
 
 #define PING_INTERVAL 5     // Seconds between PINGs
 #define MAX_MISSED_PONGS 3   // Disconnect after 3 missed PONGs
+#define STATS_LOG_EVERY 12   // Heartbeat ticks between stats log lines (~1 min)
+#define LISTEN_BACKLOG 512   // Pending connections (capped by net.core.somaxconn)
+#define ACCEPT_BACKOFF_MIN_MS 10     // First pause after a resource error
+#define ACCEPT_BACKOFF_MAX_MS 1000   // Pauses double up to this
+
+// LISTEN_UNIX socket; opened by the supervisor in multi-process mode
+// so that all workers accept on the same one
+static int g_unix_fd = -1;
+
+static long long g_boot_ms;     // Process start, for the time-to-ready log line
 
 
 // ============================================================
@@ -34,17 +68,17 @@
 //  Periodically sends PING messages to all connected clients.
 //  If a client misses 3 consecutive PONG replies, it is
 //  considered disconnected and removed from the game.
+//  Under overload every other round is skipped (see overload.h).
 // ============================================================
 void* heartbeat_thread(void* arg) {
-    int limit = MAX_CLIENTS;
-    if (arg) {
-        int v = *(int*)arg;
-        if (v > 0 && v < limit) limit = v;
-    }
+    (void)arg;
+    int tick = 0;
     while (1) {
+        // Slow cadence: the round is skipped, so no PONG is counted missing
+        bool skip = (tick & 1) && overload_level() >= OVERLOAD_SLOW_PING;
         pthread_mutex_lock(&g_clients_mtx);
 
-        for (int i = 0; i < limit; i++) {
+        for (int i = 0; i < g_client_cap && !skip; i++) {
             struct Client* c = g_clients[i];
             if (!c || !c->connected) continue;
 
@@ -57,7 +91,8 @@ void* heartbeat_thread(void* arg) {
         }
 
         pthread_mutex_unlock(&g_clients_mtx);
-        rooms_prune_disconnected(30);
+        rooms_prune_disconnected(config_get()->disconnect_grace);
+        if (++tick % STATS_LOG_EVERY == 0) stats_log();
         sleep(PING_INTERVAL);
     }
     return NULL;
@@ -65,53 +100,63 @@ void* heartbeat_thread(void* arg) {
 
 
 // ============================================================
-//  main()
+//  signal_thread()
 //  ------------------------------------------------------------
-//  Initializes server socket, starts heartbeat, and enters
-//  accept loop for new client connections.
+//  Handles the process signals blocked in run_server():
+//   - SIGHUP  re-reads server.config and resizes the pools
+//   - SIGUSR2 starts a live upgrade
+//   - SIGQUIT starts draining
 // ============================================================
-int main(int argc, char** argv) {
-    ServerConfig cfg;
-    config_load("server.config", &cfg);
-    g_config = cfg;  // make available to other modules
-    if (g_config.max_rooms <= 0 || g_config.max_rooms > MAX_ROOMS) g_config.max_rooms = MAX_ROOMS;
-    if (g_config.max_clients <= 0 || g_config.max_clients > MAX_CLIENTS) g_config.max_clients = MAX_CLIENTS;
-    if (g_config.disconnect_grace <= 0) g_config.disconnect_grace = 15;
-    int port = g_config.port;
-    srand((unsigned)time(NULL));
-
-    // Initialize file logging (truncate on start)
-    log_init("server.log");
-    server_log("Server start, bind=%s port=%d, max_rooms=%d max_clients=%d grace=%ds",
-         g_config.bind_address, port, g_config.max_rooms, g_config.max_clients, g_config.disconnect_grace);
+static void* signal_thread(void* arg) {
+    const sigset_t* set = arg;
+    while (1) {
+        int sig;
+        if (sigwait(set, &sig) != 0) continue;
 
-    // CLI argument overrides config file port
-    if (argc >= 2) {
-        port = atoi(argv[1]);
-        if (port <= 0 || port > 65535) {
-            fprintf(stderr, "Invalid port number.\n");
-            return 1;
+        if (sig == SIGHUP) {
+            server_log("SIGHUP: reloading server.config");
+            if (config_reload("server.config")) {
+                const ServerConfig* cfg = config_get();
+                client_pool_resize(cfg->max_clients);
+                room_pool_resize(cfg->max_rooms);
+            }
+        } else if (sig == SIGUSR2) {
+            upgrade_run();
+        } else if (sig == SIGQUIT) {
+            drain_start(0);
         }
     }
+    return NULL;
+}
 
-    // --------------------------------------------------------
-    //  Setup listening socket
-    // --------------------------------------------------------
+
+// ============================================================
+//  open_listener()
+//  ------------------------------------------------------------
+//  Creates, binds and listens on the server socket.
+//  Returns the socket, or -1 on error.
+// ============================================================
+static int open_listener(int port, int reuseport) {
     int server_fd = socket(AF_INET, SOCK_STREAM, 0);
     if (server_fd < 0) {
         perror("socket");
-        return 1;
+        return -1;
     }
 
     int opt = 1;
     setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    if (reuseport && setsockopt(server_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        perror("setsockopt(SO_REUSEPORT)");
+        close(server_fd);
+        return -1;
+    }
 
     struct sockaddr_in addr;
     memset(&addr, 0, sizeof(addr));
     addr.sin_family = AF_INET;
     {
         struct in_addr ina;
-        if (inet_pton(AF_INET, g_config.bind_address, &ina) == 1) {
+        if (inet_pton(AF_INET, config_get()->bind_address, &ina) == 1) {
             addr.sin_addr = ina;
         } else {
             addr.sin_addr.s_addr = INADDR_ANY;
@@ -122,69 +167,416 @@ int main(int argc, char** argv) {
     if (bind(server_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
         perror("bind");
         close(server_fd);
-        return 1;
+        return -1;
     }
 
-    if (listen(server_fd, 32) < 0) {
+    if (listen(server_fd, LISTEN_BACKLOG) < 0) {
         perror("listen");
         close(server_fd);
+        return -1;
+    }
+    fcntl(server_fd, F_SETFL, O_NONBLOCK);     // accept loop polls
+    return server_fd;
+}
+
+
+// ============================================================
+//  open_unix_listener()
+//  ------------------------------------------------------------
+//  Creates the LISTEN_UNIX socket for gateways on this host
+//  (TLS terminator, WebSocket proxy, router). A stale socket
+//  file is replaced; one a live server still accepts on is not.
+//  Returns the socket, or -1 on error.
+// ============================================================
+static int open_unix_listener(const char* path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "LISTEN_UNIX path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket(AF_UNIX)");
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+        fprintf(stderr, "LISTEN_UNIX %s is in use by another server\n", path);
+        close(fd);
+        return -1;
+    }
+    close(fd);
+    unlink(path);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket(AF_UNIX)");
+        return -1;
+    }
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        perror("bind(LISTEN_UNIX)");
+        close(fd);
+        return -1;
+    }
+    if (listen(fd, LISTEN_BACKLOG) < 0) {
+        perror("listen(LISTEN_UNIX)");
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);            // shared by workers: losers get EAGAIN
+    return fd;
+}
+
+
+// ============================================================
+//  Accept errors
+//  ------------------------------------------------------------
+//  Out of descriptors, a pending connection can neither be
+//  accepted nor refused and keeps the listener readable, so a
+//  plain retry spins. One descriptor is held in reserve: it is
+//  released to accept the connection, which gets ERROR| and is
+//  closed, and then reserved again. Other resource errors (and
+//  a lost reserve) pause the accept loop, doubling the pause up
+//  to ACCEPT_BACKOFF_MAX_MS; any accepted connection resets it.
+// ============================================================
+static int  g_spare_fd = -1;
+static int  g_backoff_ms = 0;
+static bool g_fd_limited = false;
+
+static void spare_reserve(void) {
+    if (g_spare_fd < 0) g_spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+}
+
+static void accept_ok(void) {
+    g_backoff_ms = 0;
+    if (g_fd_limited) {
+        g_fd_limited = false;
+        server_log("Accepting again (descriptors available)");
+    }
+}
+
+static void accept_failed(int listen_fd, int err) {
+    if (err == EINTR || err == EAGAIN || err == ECONNABORTED || drain_active()) return;
+
+    if ((err == EMFILE || err == ENFILE) && g_spare_fd >= 0) {
+        if (!g_fd_limited) {
+            g_fd_limited = true;
+            server_log("Out of file descriptors: refusing new connections");
+        }
+        close(g_spare_fd);
+        g_spare_fd = -1;
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd >= 0) {
+            client_refuse(fd, "Server full");
+            close(fd);
+            stats_inc(STAT_REJECT_FD_LIMIT);
+        }
+        spare_reserve();
+        if (g_spare_fd >= 0) return;    // next pending connection, same way
+    } else {
+        server_log("accept: %s", strerror(err));
+    }
+
+    g_backoff_ms = g_backoff_ms ? g_backoff_ms * 2 : ACCEPT_BACKOFF_MIN_MS;
+    if (g_backoff_ms > ACCEPT_BACKOFF_MAX_MS) g_backoff_ms = ACCEPT_BACKOFF_MAX_MS;
+    stats_inc(STAT_ACCEPT_BACKOFF);
+    poll(NULL, 0, g_backoff_ms);        // SIGUSR1 (upgrade) cuts it short
+}
+
+
+// ============================================================
+//  run_server()
+//  ------------------------------------------------------------
+//  Opens the listening socket, starts the service threads and
+//  runs the accept loop. Used directly in single-process mode
+//  and by every worker in multi-process mode (reuseport = 1).
+//  A process started by a live upgrade takes the socket and
+//  all connections over from its predecessor instead.
+// ============================================================
+static int run_server(const char* log_path, int reuseport) {
+    // Own copy: this frame outlives any snapshot (see CONFIG_RETIRE_MS),
+    // and what it reads here only changes with a restart anyway
+    const ServerConfig boot = *config_get();
+    const ServerConfig* cfg = &boot;
+    int port = cfg->port;
+
+    // SIGHUP / SIGUSR2 / SIGQUIT go to the signal thread; block them before
+    // any other thread exists so every thread inherits the mask
+    static sigset_t sigs;
+    sigemptyset(&sigs);
+    sigaddset(&sigs, SIGHUP);
+    sigaddset(&sigs, SIGUSR2);
+    sigaddset(&sigs, SIGQUIT);
+    pthread_sigmask(SIG_BLOCK, &sigs, NULL);
+
+    // A peer that closes right after sending (e.g. a router rebinding a
+    // client) must not kill the process; send() returns EPIPE instead
+    signal(SIGPIPE, SIG_IGN);
+
+    // Initialize file logging (truncate on start, continue after an upgrade)
+    if (upgrade_is_child()) log_init_append(log_path);
+    else                    log_init(log_path);
+    server_log("Server start, bind=%s port=%d, max_rooms=%d max_clients=%d grace=%ds",
+         cfg->bind_address, port, cfg->max_rooms, cfg->max_clients, cfg->disconnect_grace);
+
+    // Client and room tables sized by the config
+    if (!client_pool_resize(cfg->max_clients) || !room_pool_resize(cfg->max_rooms)) {
+        fprintf(stderr, "Out of memory for the client / room tables\n");
         return 1;
     }
+    if (!upgrade_is_child()) room_set_next_id(cfg->room_id_base);
+
+    // Warm pools: the first connections and rooms reuse pre-faulted memory
+    size_t warm = client_prealloc(cfg->prealloc_clients) + room_prealloc(cfg->prealloc_rooms);
 
     // --------------------------------------------------------
-    //  Server startup message
+    //  Setup listening socket
     // --------------------------------------------------------
-    printf("=====================================\n");
-    printf("  Tic-Tac-Toe Server is running\n");
-    printf("  Listening on %s:%d\n", g_config.bind_address, port);
-    printf("=====================================\n\n");
-    server_log("Listening on %s:%d", g_config.bind_address, port);
+    int server_fd = -1;
+    if (!upgrade_is_child()) {
+        server_fd = open_listener(port, reuseport);
+        if (server_fd < 0) return 1;
+        if (g_unix_fd < 0 && cfg->listen_unix[0]) {
+            g_unix_fd = open_unix_listener(cfg->listen_unix);
+            if (g_unix_fd < 0) return 1;
+        }
+    }
+
+    // --------------------------------------------------------
+    //  Launch timer wheel (move clocks)
+    // --------------------------------------------------------
+    timer_start();
+
+    // --------------------------------------------------------
+    //  Launch spectator fan-out workers
+    // --------------------------------------------------------
+    fanout_start(cfg->fanout_workers);
+
+    // --------------------------------------------------------
+    //  Watch dispatch lag and queue depth (load shedding)
+    // --------------------------------------------------------
+    overload_start();
+
+    // --------------------------------------------------------
+    //  Load friend lists (presence events ride the timer wheel)
+    // --------------------------------------------------------
+    presence_start(cfg->friends_file);
+
+    // --------------------------------------------------------
+    //  Launch quick-match matcher
+    // --------------------------------------------------------
+    mm_start();
+
+    // --------------------------------------------------------
+    //  Launch tournament scheduler
+    // --------------------------------------------------------
+    tourney_start();
+
+    // --------------------------------------------------------
+    //  Accept clients handed over by other workers, and hand
+    //  idle ones to the least loaded worker (see rebalance.h)
+    // --------------------------------------------------------
+    shard_start_receiver();
+    rebalance_start();
 
     // --------------------------------------------------------
     //  Launch heartbeat thread
     // --------------------------------------------------------
     pthread_t hb;
-    static int hb_limit;
-    hb_limit = g_config.max_clients;
-    if (hb_limit <= 0 || hb_limit > MAX_CLIENTS) hb_limit = MAX_CLIENTS;
-    pthread_create(&hb, NULL, heartbeat_thread, &hb_limit);
+    pthread_create(&hb, NULL, heartbeat_thread, NULL);
     pthread_detach(hb);
 
     // --------------------------------------------------------
-    //  Accept incoming connections
+    //  Live upgrade: take over the predecessor's connections
     // --------------------------------------------------------
-    while (1) {
-        struct sockaddr_in cliaddr;
-        socklen_t clilen = sizeof(cliaddr);
-        int cfd = accept(server_fd, (struct sockaddr*)&cliaddr, &clilen);
-        if (cfd < 0) {
-            perror("accept");
-            continue;
-        }
+    if (upgrade_is_child()) {
+        server_fd = upgrade_take_over(&g_unix_fd);
+        if (server_fd < 0) return 1;
+        if (g_unix_fd < 0 && cfg->listen_unix[0])
+            g_unix_fd = open_unix_listener(cfg->listen_unix);   // predecessor had none
+    }
+    upgrade_start(server_fd, g_unix_fd);
+    // A shared LISTEN_UNIX socket stays open for the other workers
+    drain_init(server_fd, shard_enabled() ? -1 : g_unix_fd);
+
+    // --------------------------------------------------------
+    //  Launch signal thread (reload / upgrade / drain)
+    // --------------------------------------------------------
+    pthread_t sig_th;
+    pthread_create(&sig_th, NULL, signal_thread, &sigs);
+    pthread_detach(sig_th);
+
+    // --------------------------------------------------------
+    //  Server startup message
+    // --------------------------------------------------------
+    printf("=====================================\n");
+    printf("  Tic-Tac-Toe Server is running\n");
+    printf("  Listening on %s:%d\n", cfg->bind_address, port);
+    if (shard_enabled()) printf("  Worker %d (pid %d)\n", shard_self(), (int)getpid());
+    printf("=====================================\n\n");
+    server_log("Listening on %s:%d", cfg->bind_address, port);
+    if (g_unix_fd >= 0) {
+        printf("  Also accepting on %s\n\n", cfg->listen_unix);
+        server_log("Listening on unix:%s", cfg->listen_unix);
+    }
+    ready_mark(g_boot_ms, warm);
 
-        struct Client* c = client_create(cfd);
-        if (!c) {
-            close(cfd);
+    // --------------------------------------------------------
+    //  Accept incoming connections (until a drain starts)
+    // --------------------------------------------------------
+    struct pollfd lfds[2] = {
+        { .fd = server_fd, .events = POLLIN },
+        { .fd = g_unix_fd, .events = POLLIN },
+    };
+    int nlfds = (g_unix_fd >= 0) ? 2 : 1;
+    spare_reserve();
+    while (!drain_active()) {
+        if (upgrade_pending()) {
+            upgrade_park(NULL);
             continue;
         }
-
-        pthread_t th;
-        if (pthread_create(&th, NULL, client_thread, c) != 0) {
-            perror("pthread_create");
-            client_destroy(c);
+        if (poll(lfds, (nfds_t)nlfds, -1) < 0) {
+            if (errno != EINTR) perror("poll");
             continue;
         }
 
-        pthread_detach(th);
-        printf("[+] New client connected (fd=%d)\n", cfd);
-        server_log("Client connected fd=%d", cfd);
+        for (int i = 0; i < nlfds && !drain_active(); i++) {
+            if (!lfds[i].revents) continue;
+            // Both kinds of connection are served the same way
+            struct sockaddr_storage peer;
+            socklen_t peer_len = sizeof(peer);
+            int cfd = accept(lfds[i].fd, (struct sockaddr*)&peer, &peer_len);
+            if (cfd < 0) {
+                accept_failed(lfds[i].fd, errno);
+                continue;
+            }
+            accept_ok();
+
+            // Shedding: players already in a game come first
+            if (overload_level() >= OVERLOAD_REFUSE) {
+                stats_inc(STAT_REJECT_OVERLOAD);
+                client_refuse(cfd, "Server busy");
+                close(cfd);
+                continue;
+            }
+
+            // Per-address caps, before anything is allocated
+            uint32_t ip = 0;
+            if (peer.ss_family == AF_INET)
+                ip = ntohl(((struct sockaddr_in*)&peer)->sin_addr.s_addr);
+            if (!conn_admit(ip)) {
+                client_refuse(cfd, "Too many connections from your address");
+                close(cfd);
+                continue;
+            }
+
+            // Admission: refusals never wait for the peer (see client_refuse)
+            struct Client* c = client_create(cfd);
+            if (!c) {
+                conn_release(ip);
+                close(cfd);
+                continue;
+            }
+            c->ip_counted = true;
+
+            pthread_t th;
+            if (pthread_create(&th, NULL, client_thread, c) != 0) {
+                stats_inc(STAT_REJECT_NOMEM);
+                client_refuse(cfd, "Server busy");
+                client_destroy(c);
+                continue;
+            }
+
+            pthread_detach(th);
+            printf("[+] New client connected (fd=%d%s)\n", cfd, i ? ", unix" : "");
+            server_log("Client connected fd=%d%s", cfd, i ? " (unix)" : "");
+        }
     }
 
     // --------------------------------------------------------
-    //  Cleanup (unreachable in normal operation)
+    //  Drain: wait for the running games, then clean up
     // --------------------------------------------------------
     close(server_fd);
+    if (g_spare_fd >= 0) close(g_spare_fd);
+    if (g_unix_fd >= 0 && !shard_enabled()) {
+        close(g_unix_fd);
+        unlink(cfg->listen_unix);
+    }
+    drain_wait();
     server_log("Server shutting down");
     log_close();
     return 0;
 }
+
+
+// ============================================================
+//  worker_main()
+//  ------------------------------------------------------------
+//  Entry point of a forked worker (multi-process mode).
+// ============================================================
+static int worker_main(int worker) {
+    char log_path[32];
+    snprintf(log_path, sizeof(log_path), "server.%d.log", worker);
+
+    log_close();    // inherited from the supervisor
+    g_boot_ms = now_ms();
+    return run_server(log_path, 1);
+}
+
+
+// ============================================================
+//  main()
+//  ------------------------------------------------------------
+//  Loads the configuration, then runs the server in this process
+//  or, with WORKERS > 1, supervises forked worker processes.
+// ============================================================
+int main(int argc, char** argv) {
+    g_boot_ms = now_ms();
+    upgrade_init(argv);
+
+    ServerConfig cfg;
+    config_load("server.config", &cfg);
+    if (cfg.max_rooms <= 0 || cfg.max_rooms > MAX_ROOMS) cfg.max_rooms = MAX_ROOMS;
+    if (cfg.max_clients <= 0 || cfg.max_clients > MAX_CLIENTS) cfg.max_clients = MAX_CLIENTS;
+    if (cfg.disconnect_grace <= 0) cfg.disconnect_grace = 15;
+    if (cfg.invite_ttl <= 0) cfg.invite_ttl = 600;
+    if (cfg.series_pause_ms < 0) cfg.series_pause_ms = 1500;
+    if (cfg.workers < 1) cfg.workers = 1;
+    if (cfg.workers > SHARD_MAX_WORKERS) cfg.workers = SHARD_MAX_WORKERS;
+    if (cfg.drain_timeout <= 0) cfg.drain_timeout = 300;
+    if (cfg.room_id_base < 0) cfg.room_id_base = 0;
+    if (cfg.prealloc_clients < 0) cfg.prealloc_clients = 0;
+    if (cfg.prealloc_clients > cfg.max_clients) cfg.prealloc_clients = cfg.max_clients;
+    if (cfg.prealloc_rooms < 0) cfg.prealloc_rooms = 0;
+    if (cfg.prealloc_rooms > cfg.max_rooms) cfg.prealloc_rooms = cfg.max_rooms;
+
+    // CLI argument overrides config file port
+    if (argc >= 2) {
+        cfg.port = atoi(argv[1]);
+        if (cfg.port <= 0 || cfg.port > 65535) {
+            fprintf(stderr, "Invalid port number.\n");
+            return 1;
+        }
+    }
+    config_publish(&cfg);   // make available to other modules
+
+    if (cfg.workers > 1 && !upgrade_is_child()) {
+        // Workers inherit the LISTEN_UNIX socket (no SO_REUSEPORT for AF_UNIX)
+        if (cfg.listen_unix[0]) {
+            g_unix_fd = open_unix_listener(cfg.listen_unix);
+            if (g_unix_fd < 0) return 1;
+        }
+
+        // Supervisor log; every worker writes server.<n>.log
+        log_init("server.log");
+        int rc = shard_run(cfg.workers, worker_main);
+        log_close();
+        if (g_unix_fd >= 0) unlink(cfg.listen_unix);
+        return rc;
+    }
+    return run_server("server.log", 0);
+}
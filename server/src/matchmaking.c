@@ -0,0 +1,292 @@
+// ============================================================
+//  MATCHMAKING MODULE IMPLEMENTATION
+//  ------------------------------------------------------------
+//  Quick-match queue with rating buckets. All queue state and the
+//  ratings live under its own mutex. A matched pair is taken off
+//  the queue with both clients held (client_hold) and placed after
+//  the mutex is released: no send and no room call runs under it.
+//
+//  Lock order: g_rooms_mtx -> g_mm_mtx (leaf; Elo updates come
+//  from finished games).
+// ============================================================
+
+#include "matchmaking.h"
+#include "client.h"
+#include "room.h"
+#include "utils.h"
+#include "stats.h"
+#include "drain.h"
+#include "log.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// ------------------------------------------------------------
+//  Queue state
+// ------------------------------------------------------------
+typedef struct {
+    QueueEntry* head;   // oldest
+    QueueEntry* tail;   // newest
+} Bucket;
+
+static Bucket g_buckets[MM_BUCKETS];
+static pthread_mutex_t g_mm_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+// A pair taken off the queue, placed once g_mm_mtx is released
+typedef struct {
+    struct Client* a;
+    struct Client* b;
+    int rating_a, rating_b;
+} MatchedPair;
+
+
+// ============================================================
+//  Bucket list helpers (expect g_mm_mtx held)
+// ============================================================
+
+static int bucket_of(int rating) {
+    int b = rating / RATING_BUCKET_WIDTH;
+    if (b < 0) b = 0;
+    if (b >= MM_BUCKETS) b = MM_BUCKETS - 1;
+    return b;
+}
+
+static void bucket_push(QueueEntry* e) {
+    Bucket* bk = g_buckets + e->bucket;
+    e->next = NULL;
+    e->prev = bk->tail;
+    if (bk->tail) bk->tail->next = e;
+    else          bk->head = e;
+    bk->tail = e;
+}
+
+static void bucket_unlink(QueueEntry* e) {
+    Bucket* bk = g_buckets + e->bucket;
+    if (e->prev) e->prev->next = e->next;
+    else         bk->head = e->next;
+    if (e->next) e->next->prev = e->prev;
+    else         bk->tail = e->prev;
+    e->prev = e->next = NULL;
+}
+
+// Oldest live entry of a bucket other than 'self'
+static QueueEntry* bucket_pick(int b, const QueueEntry* self) {
+    if (b < 0 || b >= MM_BUCKETS) return NULL;
+    for (QueueEntry* e = g_buckets[b].head; e; e = e->next) {
+        if (e != self && e->client->connected) return e;
+    }
+    return NULL;
+}
+
+// Nearest bucket first, so the closest rating wins within the spread
+static QueueEntry* find_partner(const QueueEntry* self, int spread) {
+    for (int d = 0; d <= spread; d++) {
+        QueueEntry* p = bucket_pick(self->bucket - d, self);
+        if (!p && d > 0) p = bucket_pick(self->bucket + d, self);
+        if (p) return p;
+    }
+    return NULL;
+}
+
+
+// ============================================================
+//  Placement
+// ============================================================
+
+// Takes a pair off the queue (expects g_mm_mtx held)
+static void take_pair(QueueEntry* a, QueueEntry* b, MatchedPair* out) {
+    long long now = now_ms();
+    out->a = a->client;
+    out->b = b->client;
+    out->rating_a = out->a->rating;
+    out->rating_b = out->b->rating;
+    client_hold(out->a);
+    client_hold(out->b);
+
+    bucket_unlink(a);
+    bucket_unlink(b);
+    stats_observe(HIST_QUEUE_WAIT_MS, (long)(now - a->enqueued_ms));
+    stats_observe(HIST_QUEUE_WAIT_MS, (long)(now - b->enqueued_ms));
+    stats_inc(STAT_QUEUE_MATCHED);
+    out->a->queue_entry = NULL;
+    out->b->queue_entry = NULL;
+    free(a);
+    free(b);
+}
+
+// Seats a pair (no lock held). A player who disconnected meanwhile is
+// refused by room_create / room_join (Client.dying); the other one
+// goes back into the queue. Neither can be freed before the releases.
+static void place_pair(MatchedPair* m) {
+    struct Client* ca = m->a;
+    struct Client* cb = m->b;
+    server_log("Quick match: %s (%d) vs %s (%d)", ca->name, m->rating_a, cb->name, m->rating_b);
+    sendp(ca->fd, "MATCHED|%s|%d", cb->name, m->rating_b);
+    sendp(cb->fd, "MATCHED|%s|%d", ca->name, m->rating_a);
+
+    // Reuse the regular room flow: creator = p1 (X), joiner = p2 (O)
+    Room* r = room_create("Quick match", ca, NULL);
+    int room_id = r ? r->id : -1;
+    if (!r) {
+        if (ca->connected) sendp(cb->fd, "ERROR|Lobby full");
+        else               mm_enqueue(cb);
+    } else if (!room_join(room_id, cb)) {
+        // Never leave ca alone in a public room: close it, both wait again
+        room_close(room_id, "Opponent unavailable");
+        if (ca->connected) mm_enqueue(ca);
+        if (cb->connected && !cb->current_room) mm_enqueue(cb);
+    }
+    client_release(ca);
+    client_release(cb);
+}
+
+
+// ============================================================
+//  Matcher thread
+//  ------------------------------------------------------------
+//  Once per second lets long-waiting players accept opponents
+//  from neighbouring buckets (spread grows with wait time).
+// ============================================================
+static void* matcher_thread(void* arg) {
+    (void)arg;
+    MatchedPair* pairs = NULL;
+    int pairs_cap = 0;
+
+    while (1) {
+        sleep(1);
+        int n = 0;
+        pthread_mutex_lock(&g_mm_mtx);
+        long long now = now_ms();
+
+        for (int b = 0; b < MM_BUCKETS; b++) {
+            QueueEntry* e = g_buckets[b].head;
+            while (e) {
+                QueueEntry* next = e->next;
+                int spread = (int)((now - e->enqueued_ms) / 1000 / MM_WIDEN_SECONDS);
+                if (spread > MM_MAX_SPREAD) spread = MM_MAX_SPREAD;
+
+                QueueEntry* p = (spread > 0 && e->client->connected) ? find_partner(e, spread) : NULL;
+                if (p && n == pairs_cap) {
+                    int cap = pairs_cap ? pairs_cap * 2 : 16;
+                    MatchedPair* grown = realloc(pairs, (size_t)cap * sizeof(MatchedPair));
+                    if (!grown) p = NULL;   // paired on the next pass
+                    else { pairs = grown; pairs_cap = cap; }
+                }
+                if (p) {
+                    take_pair(e, p, &pairs[n++]);
+                    next = g_buckets[b].head;   // list changed, rescan bucket
+                }
+                e = next;
+            }
+        }
+        pthread_mutex_unlock(&g_mm_mtx);
+
+        for (int i = 0; i < n; i++) place_pair(&pairs[i]);
+    }
+    return NULL;
+}
+
+void mm_start(void) {
+    pthread_t th;
+    if (pthread_create(&th, NULL, matcher_thread, NULL) != 0) {
+        perror("pthread_create");
+        return;
+    }
+    pthread_detach(th);
+}
+
+
+// ============================================================
+//  mm_enqueue() / mm_dequeue()
+// ============================================================
+
+void mm_enqueue(struct Client* c) {
+    if (c->name[0] == '\0') {
+        sendp(c->fd, "ERROR|Join first");
+        return;
+    }
+    if (c->current_room != NULL || c->spectate_room_id >= 0) {
+        sendp(c->fd, "ERROR|Already in a room. Leave first.");
+        return;
+    }
+    if (drain_active()) {
+        sendp(c->fd, "ERROR|Server is draining");
+        return;
+    }
+
+    QueueEntry* e = calloc(1, sizeof(QueueEntry));
+    if (!e) {
+        sendp(c->fd, "ERROR|Queue unavailable");
+        return;
+    }
+
+    pthread_mutex_lock(&g_mm_mtx);
+    if (c->queue_entry || atomic_load(&c->dying)) {
+        bool queued = c->queue_entry != NULL;
+        pthread_mutex_unlock(&g_mm_mtx);
+        free(e);
+        if (queued) sendp(c->fd, "ERROR|Already queued");
+        return;
+    }
+    int rating = c->rating;
+    e->client = c;
+    e->bucket = bucket_of(rating);
+    e->enqueued_ms = now_ms();
+    c->queue_entry = e;
+    stats_inc(STAT_QUEUE_ENQUEUED);
+
+    // Fast path: somebody with a similar rating is already waiting
+    MatchedPair m;
+    QueueEntry* p = bucket_pick(e->bucket, e);
+    bucket_push(e);
+    if (p) take_pair(p, e, &m);
+    pthread_mutex_unlock(&g_mm_mtx);
+
+    sendp(c->fd, "QUEUED|%d", rating);
+    server_log("Player %s queued (rating %d)", c->name, rating);
+    if (p) place_pair(&m);
+}
+
+void mm_dequeue(struct Client* c, int notify) {
+    if (!c) return;
+    pthread_mutex_lock(&g_mm_mtx);
+    QueueEntry* e = c->queue_entry;
+    if (e) {
+        bucket_unlink(e);
+        c->queue_entry = NULL;
+        free(e);
+        stats_inc(STAT_QUEUE_CANCELLED);
+    }
+    pthread_mutex_unlock(&g_mm_mtx);
+
+    if (notify) sendp(c->fd, e ? "UNQUEUED|" : "ERROR|Not queued");
+}
+
+
+// ============================================================
+//  mm_rate_result()
+//  ------------------------------------------------------------
+//  Standard Elo update with K = 32.
+// ============================================================
+void mm_rate_result(struct Client* a, struct Client* b, int result) {
+    if (!a || !b) return;
+    if (a->is_bot || b->is_bot) return;     // games against bots are unrated
+
+    pthread_mutex_lock(&g_mm_mtx);
+    double ea = 1.0 / (1.0 + pow(10.0, (b->rating - a->rating) / 400.0));
+    double sa = result > 0 ? 1.0 : (result < 0 ? 0.0 : 0.5);
+    int delta = (int)lround(32.0 * (sa - ea));
+
+    a->rating += delta;
+    b->rating -= delta;
+    pthread_mutex_unlock(&g_mm_mtx);
+}
+
+int mm_rating(const struct Client* c) {
+    pthread_mutex_lock(&g_mm_mtx);
+    int rating = c->rating;
+    pthread_mutex_unlock(&g_mm_mtx);
+    return rating;
+}
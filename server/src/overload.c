@@ -0,0 +1,76 @@
+// ============================================================
+//  OVERLOAD MODULE IMPLEMENTATION
+//  ------------------------------------------------------------
+//  A self re-arming timer samples both signals; everything
+//  else only reads the level, an atomic int.
+// ============================================================
+
+#include "overload.h"
+#include "config.h"
+#include "fanout.h"
+#include "stats.h"
+#include "timer.h"
+#include "log.h"
+
+#include <stdatomic.h>
+
+static atomic_int g_level;
+static int g_calm;
+
+
+// How many times over its threshold a signal is: 0, 1, 2 or 3
+static int level_for(long value, long threshold) {
+    if (threshold <= 0 || value < threshold) return 0;
+    if (value < threshold * 2) return 1;
+    if (value < threshold * 4) return 2;
+    return 3;
+}
+
+// Timer thread
+static void on_sample(long unused_a, long unused_b) {
+    (void)unused_a;
+    (void)unused_b;
+    const ServerConfig* cfg = config_get();
+    long lag = timer_lag_ms();
+    long depth = fanout_pending();
+    stats_set(GAUGE_DISPATCH_LAG_MS, lag);
+    stats_set(GAUGE_FANOUT_QUEUE, depth);
+
+    int want = level_for(lag, cfg->overload_lag_ms);
+    int by_queue = level_for(depth, cfg->overload_queue);
+    if (by_queue > want) want = by_queue;
+
+    int level = atomic_load(&g_level);
+    int next = level;
+    if (want > level) {
+        next = want;
+        g_calm = 0;
+    } else if (want < level && ++g_calm >= OVERLOAD_CALM_TICKS) {
+        next = level - 1;
+        g_calm = 0;
+    } else if (want == level) {
+        g_calm = 0;
+    }
+
+    if (next != level) {
+        atomic_store(&g_level, next);
+        stats_set(GAUGE_OVERLOAD_LEVEL, next);
+        server_log("Overload level %d -> %d (dispatch lag %ld ms, fan-out queue %ld)",
+                   level, next, lag, depth);
+    }
+
+    if (!timer_arm(OVERLOAD_TICK_MS, on_sample, 0, 0))
+        server_log("Overload: no timer for the next sample, controller stopped");
+}
+
+
+// ============================================================
+//  Public API
+// ============================================================
+void overload_start(void) {
+    timer_arm(OVERLOAD_TICK_MS, on_sample, 0, 0);
+}
+
+int overload_level(void) {
+    return atomic_load(&g_level);
+}
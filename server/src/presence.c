@@ -0,0 +1,421 @@
+// ============================================================
+//  PRESENCE MODULE IMPLEMENTATION
+//  ------------------------------------------------------------
+//  Users live in a chained hash table; friend / subscriber lists
+//  hold plain pointers, so a user is only freed once it is offline
+//  and no list refers to it any more. An online user holds its
+//  connection, so notifications never reach a reused socket. The module lock is a leaf
+//  (only the fan-out queue is taken under it), so the room code
+//  may publish presence with g_rooms_mtx held. The friends file is
+//  written outside of it.
+// ============================================================
+
+#include "presence.h"
+#include "client.h"
+#include "fanout.h"
+#include "stats.h"
+#include "timer.h"
+#include "utils.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#define PRESENCE_BUCKETS 1024   // Power of two
+
+typedef struct User {
+    char name[32];
+    struct User* next;          // Hash chain
+
+    struct User** friends;      // Users this one follows
+    int friend_count, friend_cap;
+    struct User** subs;         // Users following this one
+    int sub_count, sub_cap;
+
+    struct Client* conn;        // Online connection, held (NULL = offline)
+    PresenceState st;
+    int room_id;
+    PresenceState sent_st;      // Last state published
+    int sent_room_id;
+
+    bool dirty;
+    struct User* dirty_next;
+} User;
+
+static User* g_buckets[PRESENCE_BUCKETS];
+static User* g_dirty = NULL;
+static bool g_flush_armed = false;
+static char g_path[128] = "";
+static pthread_mutex_t g_presence_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t g_save_mtx = PTHREAD_MUTEX_INITIALIZER;   // Taken before g_presence_mtx
+
+
+// ============================================================
+//  Helpers (expect g_presence_mtx held)
+// ============================================================
+
+static unsigned hash_name(const char* s) {
+    unsigned h = 2166136261u;   // FNV-1a
+    for (; *s; s++) {
+        h ^= (unsigned char)*s;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static User* user_get(const char* name, bool create) {
+    unsigned b = hash_name(name) & (PRESENCE_BUCKETS - 1);
+    for (User* u = g_buckets[b]; u; u = u->next)
+        if (strcmp(u->name, name) == 0) return u;
+    if (!create) return NULL;
+
+    User* u = calloc(1, sizeof(User));
+    if (!u) return NULL;
+    snprintf(u->name, sizeof(u->name), "%s", name);
+    u->room_id = u->sent_room_id = -1;
+    u->next = g_buckets[b];
+    g_buckets[b] = u;
+    return u;
+}
+
+// Frees a user nobody refers to: offline, no links, not queued
+static void user_release_if_idle(User* u) {
+    if (u->conn || u->friend_count || u->sub_count || u->dirty) return;
+    User** pp = &g_buckets[hash_name(u->name) & (PRESENCE_BUCKETS - 1)];
+    while (*pp && *pp != u) pp = &(*pp)->next;
+    if (*pp) *pp = u->next;
+    free(u->friends);
+    free(u->subs);
+    free(u);
+}
+
+static int list_find(User** arr, int n, const User* u) {
+    for (int i = 0; i < n; i++)
+        if (arr[i] == u) return i;
+    return -1;
+}
+
+static int list_push(User*** arr, int* n, int* cap, User* u) {
+    if (*n == *cap) {
+        int ncap = *cap ? *cap * 2 : 4;
+        User** grown = realloc(*arr, (size_t)ncap * sizeof(User*));
+        if (!grown) return 0;
+        *arr = grown;
+        *cap = ncap;
+    }
+    (*arr)[(*n)++] = u;
+    return 1;
+}
+
+static void list_remove(User** arr, int* n, const User* u) {
+    int i = list_find(arr, *n, u);
+    if (i >= 0) arr[i] = arr[--(*n)];
+}
+
+static int link_friend(User* u, User* f) {
+    if (list_find(u->friends, u->friend_count, f) >= 0) return 1;
+    if (!list_push(&u->friends, &u->friend_count, &u->friend_cap, f)) return 0;
+    if (!list_push(&f->subs, &f->sub_count, &f->sub_cap, u)) {
+        u->friend_count--;
+        return 0;
+    }
+    return 1;
+}
+
+static const char* state_name(PresenceState st) {
+    switch (st) {
+        case PRES_LOBBY:   return "LOBBY";
+        case PRES_WAITING: return "WAITING";
+        case PRES_PLAYING: return "PLAYING";
+        default:           return "OFFLINE";
+    }
+}
+
+// "LOBBY" or "PLAYING|3"
+static void format_state(const User* u, char* out, size_t cap) {
+    if (u->st == PRES_WAITING || u->st == PRES_PLAYING)
+        snprintf(out, cap, "%s|%d", state_name(u->st), u->room_id);
+    else
+        snprintf(out, cap, "%s", state_name(u->st));
+}
+
+// All "user<TAB>friend" lines in one buffer (caller frees), NULL if
+// out of memory
+static char* snapshot_locked(size_t* len) {
+    size_t cap = 1;
+    for (int b = 0; b < PRESENCE_BUCKETS; b++)
+        for (User* u = g_buckets[b]; u; u = u->next)
+            cap += (size_t)u->friend_count * (sizeof(u->name) * 2 + 2);
+
+    char* buf = malloc(cap);
+    size_t n = 0;
+    for (int b = 0; buf && b < PRESENCE_BUCKETS; b++)
+        for (User* u = g_buckets[b]; u; u = u->next)
+            for (int i = 0; i < u->friend_count; i++)
+                n += (size_t)snprintf(buf + n, cap - n, "%s\t%s\n", u->name, u->friends[i]->name);
+    *len = n;
+    return buf;
+}
+
+// Rewrites the friends file (small; only on ADD / DEL). The snapshot
+// is taken under g_save_mtx too, so the last write is the newest one,
+// while the disk I/O does not hold up presence_set() callers.
+static void save(void) {
+    if (!g_path[0]) return;
+    pthread_mutex_lock(&g_save_mtx);
+    size_t len = 0;
+    pthread_mutex_lock(&g_presence_mtx);
+    char* buf = snapshot_locked(&len);
+    pthread_mutex_unlock(&g_presence_mtx);
+
+    char tmp[160];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", g_path);
+    FILE* f = buf ? fopen(tmp, "w") : NULL;
+    if (!f) {
+        server_log("Cannot write %s", tmp);
+    } else {
+        fwrite(buf, 1, len, f);
+        fclose(f);
+        if (rename(tmp, g_path) != 0) server_log("Cannot replace %s", g_path);
+    }
+    pthread_mutex_unlock(&g_save_mtx);
+    free(buf);
+}
+
+
+// ============================================================
+//  on_flush() - timer thread
+//  ------------------------------------------------------------
+//  Publishes the latest state of every dirty user to the online
+//  subscribers. Intermediate states inside the window are lost
+//  on purpose; a return to the last published state sends nothing.
+// ============================================================
+static void on_flush(long a, long b) {
+    (void)a; (void)b;
+    pthread_mutex_lock(&g_presence_mtx);
+    User* list = g_dirty;
+    g_dirty = NULL;
+    g_flush_armed = false;
+
+    for (User* u = list; u; ) {
+        User* next = u->dirty_next;
+        u->dirty = false;
+        u->dirty_next = NULL;
+
+        if (u->st != u->sent_st || u->room_id != u->sent_room_id) {
+            u->sent_st = u->st;
+            u->sent_room_id = u->room_id;
+
+            Audience* to = u->sub_count ? audience_alloc(u->sub_count) : NULL;
+            for (int i = 0; to && i < u->sub_count; i++)
+                if (u->subs[i]->conn) audience_push(to, u->subs[i]->conn);
+
+            if (to && to->n > 0) {
+                char st[32];
+                format_state(u, st, sizeof(st));
+                fanout_clients((int)(hash_name(u->name) & 0x7fffffff), to,
+                               "PRESENCE|%s|%s", u->name, st);
+                stats_inc(STAT_PRESENCE_EVENTS);
+            } else {
+                audience_release(to);
+            }
+        }
+        user_release_if_idle(u);
+        u = next;
+    }
+    pthread_mutex_unlock(&g_presence_mtx);
+}
+
+// Expects g_presence_mtx held
+static void mark_dirty(User* u) {
+    if (u->dirty) {
+        stats_inc(STAT_PRESENCE_COALESCED);
+        return;
+    }
+    u->dirty = true;
+    u->dirty_next = g_dirty;
+    g_dirty = u;
+    if (!g_flush_armed) {
+        g_flush_armed = true;
+        timer_arm(PRESENCE_FLUSH_MS, on_flush, 0, 0);
+    }
+}
+
+
+// ============================================================
+//  presence_start()
+// ============================================================
+void presence_start(const char* path) {
+    pthread_mutex_lock(&g_presence_mtx);
+    snprintf(g_path, sizeof(g_path), "%s", path ? path : "");
+    FILE* f = g_path[0] ? fopen(g_path, "r") : NULL;
+    int pairs = 0;
+    if (f) {
+        char line[128];
+        while (fgets(line, sizeof(line), f)) {
+            trim_newline(line);
+            char* tab = strchr(line, '\t');
+            if (!tab || tab == line || tab[1] == '\0') continue;
+            *tab = '\0';
+            User* u = user_get(line, true);
+            User* fr = user_get(tab + 1, true);
+            if (u && fr && u != fr && link_friend(u, fr)) pairs++;
+        }
+        fclose(f);
+    }
+    pthread_mutex_unlock(&g_presence_mtx);
+    server_log("Presence: %d friend links loaded from %s", pairs, g_path[0] ? g_path : "(none)");
+}
+
+
+// Names are not unique: the user belongs to the connection that
+// came online first, or to a reconnect of the same session
+static bool owns_user(const User* u, const struct Client* c) {
+    return !u->conn || u->conn == c || atomic_load(&u->conn->dying) ||
+           strcmp(u->conn->session_id, c->session_id) == 0;
+}
+
+// Makes c the user's online connection. A dying client is already
+// past presence_offline() and must not be held again.
+static void bind_conn(User* u, struct Client* c) {
+    if (u->conn == c || atomic_load(&c->dying)) return;
+    client_hold(c);
+    if (u->conn) client_release(u->conn);
+    u->conn = c;
+}
+
+
+// ============================================================
+//  presence_set() / presence_offline()
+// ============================================================
+void presence_set(struct Client* c, PresenceState st, int room_id) {
+    if (!c || c->is_bot || c->name[0] == '\0') return;
+
+    pthread_mutex_lock(&g_presence_mtx);
+    User* u = user_get(c->name, true);
+    if (u && owns_user(u, c)) {
+        if (st != PRES_OFFLINE) bind_conn(u, c);
+        if (st != PRES_WAITING && st != PRES_PLAYING) room_id = -1;
+        if (u->st != st || u->room_id != room_id) {
+            u->st = st;
+            u->room_id = room_id;
+            mark_dirty(u);
+        }
+    }
+    pthread_mutex_unlock(&g_presence_mtx);
+}
+
+void presence_offline(struct Client* c) {
+    if (!c || c->is_bot || c->name[0] == '\0') return;
+
+    pthread_mutex_lock(&g_presence_mtx);
+    User* u = user_get(c->name, false);
+    if (u && u->conn == c) {
+        client_release(c);
+        u->conn = NULL;
+        u->st = PRES_OFFLINE;
+        u->room_id = -1;
+        mark_dirty(u);
+    }
+    pthread_mutex_unlock(&g_presence_mtx);
+}
+
+
+// ============================================================
+//  friend_command()
+// ============================================================
+void friend_command(struct Client* c, const char* payload) {
+    if (c->name[0] == '\0') {
+        sendp(c->fd, "ERROR|Join first");
+        return;
+    }
+
+    const char* arg = strchr(payload, '|');
+    arg = arg ? arg + 1 : "";
+
+    if (strncmp(payload, "LIST|", 5) == 0 || strcmp(payload, "LIST") == 0) {
+        MsgBuf mb;
+        msgbuf_init(&mb);
+        int count = 0;
+        pthread_mutex_lock(&g_presence_mtx);
+        User* u = user_get(c->name, false);
+        if (u && !owns_user(u, c)) {
+            pthread_mutex_unlock(&g_presence_mtx);
+            sendp(c->fd, "ERROR|Name in use");
+            return;
+        }
+        if (u) bind_conn(u, c);
+        for (int i = 0; u && i < u->friend_count; i++) {
+            char st[32];
+            format_state(u->friends[i], st, sizeof(st));
+            msgbuf_add(&mb, "FRIEND|%s|%s", u->friends[i]->name, st);
+            count++;
+        }
+        pthread_mutex_unlock(&g_presence_mtx);
+        msgbuf_add(&mb, "FRIENDS_END|%d", count);
+        msgbuf_send(c->fd, &mb);
+        return;
+    }
+
+    int add = (strncmp(payload, "ADD|", 4) == 0);
+    int del = (strncmp(payload, "DEL|", 4) == 0);
+    if ((!add && !del) || arg[0] == '\0' || strlen(arg) >= sizeof(c->name) ||
+        strpbrk(arg, "\t|") || strcmp(arg, c->name) == 0) {
+        sendp(c->fd, "ERROR|Invalid friend command");
+        return;
+    }
+
+    // Only users the server knows (online now, or in somebody's list)
+    // can be added: arbitrary names must not create records
+    pthread_mutex_lock(&g_presence_mtx);
+    User* u = user_get(c->name, true);
+    User* f = user_get(arg, false);
+    if (!u) {
+        pthread_mutex_unlock(&g_presence_mtx);
+        sendp(c->fd, "ERROR|Out of memory");
+        return;
+    }
+    if (!owns_user(u, c)) {
+        pthread_mutex_unlock(&g_presence_mtx);
+        sendp(c->fd, "ERROR|Name in use");
+        return;
+    }
+    bind_conn(u, c);
+    if (add && !f) {
+        pthread_mutex_unlock(&g_presence_mtx);
+        sendp(c->fd, "ERROR|Unknown user");
+        return;
+    }
+
+    if (add) {
+        if (u->friend_count >= FRIENDS_MAX &&
+            list_find(u->friends, u->friend_count, f) < 0) {
+            pthread_mutex_unlock(&g_presence_mtx);
+            sendp(c->fd, "ERROR|Friend list full");
+            return;
+        }
+        if (!link_friend(u, f)) {
+            pthread_mutex_unlock(&g_presence_mtx);
+            sendp(c->fd, "ERROR|Out of memory");
+            return;
+        }
+        char st[32];
+        format_state(f, st, sizeof(st));
+        pthread_mutex_unlock(&g_presence_mtx);
+        save();
+        sendp(c->fd, "FRIEND_ADDED|%s", arg);
+        sendp(c->fd, "PRESENCE|%s|%s", arg, st);
+    } else {
+        if (f) {
+            list_remove(u->friends, &u->friend_count, f);
+            list_remove(f->subs, &f->sub_count, u);
+            user_release_if_idle(f);
+        }
+        pthread_mutex_unlock(&g_presence_mtx);
+        if (f) save();
+        sendp(c->fd, "FRIEND_REMOVED|%s", arg);
+    }
+}
@@ -0,0 +1,58 @@
+// ============================================================
+//  PUBSUB MODULE IMPLEMENTATION
+//  ------------------------------------------------------------
+//  Topic resolution (client / room snapshots) and hand-off to
+//  fanout_broadcast().
+// ============================================================
+
+#include "pubsub.h"
+#include "client.h"
+#include "room.h"
+#include "fanout.h"
+#include "stats.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+
+int pubsub_parse(const char* s, Topic* out) {
+    out->room_id = -1;
+    if (strcasecmp(s, "ALL") == 0)     { out->kind = TOPIC_GLOBAL;  return 1; }
+    if (strcasecmp(s, "LOBBY") == 0)   { out->kind = TOPIC_LOBBY;   return 1; }
+    if (strcasecmp(s, "WAITING") == 0) { out->kind = TOPIC_WAITING; return 1; }
+    if (strcasecmp(s, "PLAYING") == 0) { out->kind = TOPIC_PLAYING; return 1; }
+
+    int id;
+    char extra;
+    if (strncasecmp(s, "ROOM:", 5) == 0 && sscanf(s + 5, "%d%c", &id, &extra) == 1 && id >= 0) {
+        out->kind = TOPIC_ROOM;
+        out->room_id = id;
+        return 1;
+    }
+    return 0;
+}
+
+int pubsub_publish(const Topic* t, const char* fmt, ...) {
+    Audience* a = NULL;
+    switch (t->kind) {
+        case TOPIC_GLOBAL:  a = client_state_audience(CLIENT_STATE_ANY); break;
+        case TOPIC_LOBBY:   a = client_state_audience(CLIENT_STATE_LOBBY); break;
+        case TOPIC_WAITING: a = client_state_audience(CLIENT_STATE_WAITING); break;
+        case TOPIC_PLAYING: a = client_state_audience(CLIENT_STATE_PLAYING); break;
+        case TOPIC_ROOM:    a = room_member_audience(t->room_id); break;
+    }
+    if (!a) return 0;
+    int n = a->n;
+
+    char payload[256];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(payload, sizeof(payload), fmt, ap);
+    va_end(ap);
+
+    fanout_broadcast(a, "%s", payload);
+    stats_inc(STAT_PUBSUB_PUBLISHED);
+    return n;
+}
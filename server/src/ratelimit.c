@@ -0,0 +1,109 @@
+// ============================================================
+//  RATE LIMIT MODULE IMPLEMENTATION
+//  ------------------------------------------------------------
+//  Lazy token bucket: tokens are refilled on use from the time
+//  elapsed since the last call, so idle buckets cost nothing.
+// ============================================================
+
+#include "ratelimit.h"
+#include "config.h"
+#include "stats.h"
+#include "utils.h"
+
+#include <pthread.h>
+
+void tb_init(TokenBucket* tb, double burst) {
+    tb->tokens = burst;
+    tb->last_ms = now_ms();
+}
+
+int tb_take(TokenBucket* tb, double rate, double burst, double cost) {
+    long long now = now_ms();
+    if (tb->last_ms == 0) {
+        tb->tokens = burst;
+    } else {
+        tb->tokens += (double)(now - tb->last_ms) * rate / 1000.0;
+        if (tb->tokens > burst) tb->tokens = burst;
+    }
+    tb->last_ms = now;
+
+    if (tb->tokens < cost) return 0;
+    tb->tokens -= cost;
+    return 1;
+}
+
+
+// ============================================================
+//  Command limiter
+// ============================================================
+
+#define IP_STRIPES 64           // Locks over the address table
+
+static const double g_class_rate[RL_CLASS_COUNT] = {
+    RL_GAME_RATE, RL_ROOM_RATE, RL_QUERY_RATE, RL_OTHER_RATE,
+};
+
+typedef struct {
+    uint32_t ip;
+    TokenBucket tb;
+} IpSlot;
+
+static IpSlot g_ip[RL_IP_SLOTS];
+static pthread_mutex_t g_ip_mtx[IP_STRIPES];
+static pthread_once_t g_ip_once = PTHREAD_ONCE_INIT;
+
+static void ip_init(void) {
+    for (int i = 0; i < IP_STRIPES; i++) pthread_mutex_init(&g_ip_mtx[i], NULL);
+}
+
+// One slot per address hash; another address landing on the same
+// slot takes it over with a full bucket (evictions only ever help
+// the newcomer, never lock anybody out)
+static int ip_take(uint32_t ip, double rate) {
+    unsigned slot = (ip * 2654435761u) & (RL_IP_SLOTS - 1);
+    pthread_mutex_t* m = &g_ip_mtx[slot % IP_STRIPES];
+    pthread_mutex_lock(m);
+    IpSlot* s = &g_ip[slot];
+    if (s->ip != ip) {
+        s->ip = ip;
+        tb_init(&s->tb, rate * RL_BURST_FACTOR);
+    }
+    int ok = tb_take(&s->tb, rate, rate * RL_BURST_FACTOR, 1.0);
+    pthread_mutex_unlock(m);
+    return ok;
+}
+
+void rl_init(CmdLimiter* l) {
+    pthread_once(&g_ip_once, ip_init);
+    tb_init(&l->all, config_get()->rate_client * RL_BURST_FACTOR);
+    for (int i = 0; i < RL_CLASS_COUNT; i++)
+        tb_init(&l->cls[i], g_class_rate[i] * RL_BURST_FACTOR);
+    tb_init(&l->strikes, RL_STRIKE_BURST);
+    l->notice_ms = 0;
+}
+
+RateVerdict rl_check(CmdLimiter* l, uint32_t ip, RateClass cls) {
+    const ServerConfig* cfg = config_get();
+    double rate = g_class_rate[cls];
+
+    int ok = tb_take(&l->cls[cls], rate, rate * RL_BURST_FACTOR, 1.0);
+    if (ok && cfg->rate_client > 0)
+        ok = tb_take(&l->all, cfg->rate_client, cfg->rate_client * RL_BURST_FACTOR, 1.0);
+    if (ok && ip && cfg->rate_ip > 0)
+        ok = ip_take(ip, cfg->rate_ip);
+    if (ok) return RL_PASS;
+
+    if (!tb_take(&l->strikes, RL_STRIKE_RATE, RL_STRIKE_BURST, 1.0)) {
+        stats_inc(STAT_RATE_KICK);
+        return RL_KICK;
+    }
+    stats_inc(STAT_RATE_DROP);
+    return RL_DROP;
+}
+
+int rl_notice_due(CmdLimiter* l) {
+    long long now = now_ms();
+    if (now - l->notice_ms < RL_NOTICE_MS) return 0;
+    l->notice_ms = now;
+    return 1;
+}
@@ -0,0 +1,66 @@
+// ============================================================
+//  READY MODULE IMPLEMENTATION
+// ============================================================
+
+#include "ready.h"
+#include "config.h"
+#include "drain.h"
+#include "shard.h"
+#include "utils.h"
+#include "log.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <unistd.h>
+
+static atomic_bool g_ready;
+static long g_time_to_ready_ms;
+static char g_file[140];        // READY_FILE of this process, "" if none
+
+
+// Resident set from /proc/self/statm, 0 if unknown
+static long rss_kib(void) {
+    long pages = 0;
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    if (fscanf(f, "%*s %ld", &pages) != 1) pages = 0;
+    fclose(f);
+    return pages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+void ready_mark(long long boot_ms, size_t prealloc_bytes) {
+    g_time_to_ready_ms = (long)(now_ms() - boot_ms);
+
+    const char* path = config_get()->ready_file;
+    if (path[0]) {
+        if (shard_enabled()) snprintf(g_file, sizeof(g_file), "%s.%d", path, shard_self());
+        else                 snprintf(g_file, sizeof(g_file), "%s", path);
+        FILE* f = fopen(g_file, "w");
+        if (f) {
+            fprintf(f, "%d\n", (int)getpid());
+            fclose(f);
+        } else {
+            server_log("Cannot write READY_FILE %s", g_file);
+            g_file[0] = '\0';
+        }
+    }
+
+    atomic_store(&g_ready, true);
+    server_log("Ready in %ld ms: %zu KiB pre-faulted, %ld KiB resident",
+               g_time_to_ready_ms, prealloc_bytes / 1024, rss_kib());
+}
+
+void ready_clear(void) {
+    if (!atomic_exchange(&g_ready, false)) return;
+    if (g_file[0]) unlink(g_file);
+}
+
+bool ready_get(void) {
+    return atomic_load(&g_ready);
+}
+
+void ready_send(int fd) {
+    if (drain_active())  sendp(fd, "HEALTH|DRAINING");
+    else if (ready_get()) sendp(fd, "HEALTH|READY|%ld", g_time_to_ready_ms);
+    else                 sendp(fd, "HEALTH|STARTING");
+}
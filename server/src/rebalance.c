@@ -0,0 +1,141 @@
+// ============================================================
+//  REBALANCE MODULE IMPLEMENTATION
+//  ------------------------------------------------------------
+//  Runs on the timer wheel. Only one worker moves clients in a
+//  round (the most loaded, lowest index on ties), so two of
+//  them never pour into the same target at once.
+// ============================================================
+
+#define _POSIX_C_SOURCE 200809L  // sigaction, pthread_kill
+
+#include "rebalance.h"
+#include "client.h"
+#include "config.h"
+#include "drain.h"
+#include "shard.h"
+#include "timer.h"
+#include "utils.h"
+#include "log.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+
+static bool g_report_after;     // Log the loads after last round's move
+
+
+static int loads_format(char* out, size_t cap, const ShardLoad* loads, int n) {
+    int off = 0;
+    out[0] = '\0';
+    for (int i = 0; i < n && off < (int)cap; i++)
+        off += snprintf(out + off, cap - off, "%s%d", i ? " " : "", loads[i].clients);
+    return off;
+}
+
+// Own load; also counts who could move (without the tournament check,
+// which the client thread does itself)
+static void load_measure(ShardLoad* l) {
+    long long now = now_ms();
+    memset(l, 0, sizeof(*l));
+    pthread_mutex_lock(&g_clients_mtx);
+    for (int i = 0; i < g_client_cap; i++) {
+        struct Client* c = g_clients[i];
+        if (!c || c->is_bot || !c->connected) continue;
+        l->clients++;
+        if (c->name[0] && !c->current_room && c->spectate_room_id < 0 && !c->queue_entry &&
+            now - c->last_rx_ms >= REBALANCE_IDLE_MS)
+            l->movable++;
+    }
+    pthread_mutex_unlock(&g_clients_mtx);
+}
+
+// Marks up to n idle clients for worker `to`; returns how many
+static int mark_clients(int to, int n) {
+    long long now = now_ms();
+    int marked = 0;
+    pthread_mutex_lock(&g_clients_mtx);
+    for (int i = 0; i < g_client_cap && marked < n; i++) {
+        struct Client* c = g_clients[i];
+        if (!c || c->is_bot || !c->connected || !c->alive || !c->has_thread) continue;
+        if (!c->name[0] || c->current_room || c->spectate_room_id >= 0 || c->queue_entry) continue;
+        if (now - c->last_rx_ms < REBALANCE_IDLE_MS) continue;
+        if (atomic_load(&c->migrate_to) >= 0) continue;
+        atomic_store(&c->migrate_to, to);
+        pthread_kill(c->thread, SIGUSR1);
+        marked++;
+    }
+    pthread_mutex_unlock(&g_clients_mtx);
+    return marked;
+}
+
+static void rebalance_round(void) {
+    ShardLoad mine;
+    load_measure(&mine);
+    shard_load_put(&mine);
+
+    ShardLoad loads[SHARD_MAX_WORKERS];
+    int n = shard_loads(loads);
+    int total = 0, hi = 0, lo = 0;
+    for (int i = 0; i < n; i++) {
+        total += loads[i].clients;
+        if (loads[i].clients > loads[hi].clients) hi = i;
+        if (loads[i].clients < loads[lo].clients) lo = i;
+    }
+
+    char line[SHARD_MAX_WORKERS * 6];
+    if (g_report_after) {
+        g_report_after = false;
+        loads_format(line, sizeof(line), loads, n);
+        server_log("Rebalance: worker loads after: %s", line);
+    }
+    if (n < 2 || hi != shard_self() || drain_active()) return;
+
+    int mean = total / n;
+    if (loads[hi].clients * 100 <= mean * (100 + REBALANCE_SLACK) ||
+        loads[hi].clients - loads[lo].clients < 2)
+        return;
+
+    // Bring both ends toward the mean, without overshooting either
+    int want = loads[hi].clients - mean;
+    if (mean - loads[lo].clients < want) want = mean - loads[lo].clients;
+    if (want > REBALANCE_BATCH) want = REBALANCE_BATCH;
+    if (want <= 0 || mine.movable == 0) return;
+
+    int marked = mark_clients(lo, want);
+    if (marked == 0) return;
+    loads_format(line, sizeof(line), loads, n);
+    server_log("Rebalance: worker loads before: %s (mean %d), moving %d idle clients to worker %d",
+               line, mean, marked, lo);
+    g_report_after = true;
+}
+
+// Timer thread
+static void on_tick(long unused_a, long unused_b) {
+    (void)unused_a;
+    (void)unused_b;
+    int every = config_get()->rebalance_ms;
+    if (every > 0) rebalance_round();
+    if (!timer_arm(every > 0 ? every : REBALANCE_OFF_MS, on_tick, 0, 0))
+        server_log("Rebalance: no timer for the next round, rebalancing stopped");
+}
+
+static void on_wake(int sig) {
+    (void)sig;      // only there to make recv() return EINTR
+}
+
+
+// ============================================================
+//  Public API
+// ============================================================
+void rebalance_start(void) {
+    if (!shard_enabled()) return;
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_wake;        // no SA_RESTART
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGUSR1, &sa, NULL);
+
+    int every = config_get()->rebalance_ms;
+    timer_arm(every > 0 ? every : REBALANCE_OFF_MS, on_tick, 0, 0);
+}
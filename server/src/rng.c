@@ -0,0 +1,223 @@
+// ============================================================
+//  RNG MODULE IMPLEMENTATION
+//  ------------------------------------------------------------
+//  ChaCha20 as in RFC 8439 (32-byte key, 96-bit nonce, 32-bit
+//  block counter), used as a keystream generator in the style of
+//  OpenBSD's arc4random: refill, rekey from the refill, serve
+//  the rest, wipe what was served.
+// ============================================================
+
+#define _POSIX_C_SOURCE 200809L  // O_CLOEXEC
+
+#include "rng.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/random.h>
+
+#define KEY_LEN    32
+#define NONCE_LEN  12
+#define SEED_LEN   (KEY_LEN + NONCE_LEN)
+#define BLOCK_LEN  64
+#define BUF_LEN    (RNG_BLOCKS * BLOCK_LEN)
+
+typedef struct {
+    uint32_t input[16];         // Constants, key, counter, nonce
+    uint8_t  buf[BUF_LEN];
+    size_t   avail;             // Unused bytes at the end of buf
+    size_t   since_seed;        // Bytes served since the last getrandom()
+    unsigned fork_gen;          // g_fork_gen when seeded
+    bool     seeded;
+} RngState;
+
+static _Thread_local RngState g_rng;
+static atomic_uint g_fork_gen;
+static pthread_once_t g_atfork_once = PTHREAD_ONCE_INIT;
+
+
+// ============================================================
+//  ChaCha20 block function
+// ============================================================
+
+#define ROTL(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+#define QR(a, b, c, d)                          \
+    do {                                        \
+        a += b; d ^= a; d = ROTL(d, 16);        \
+        c += d; b ^= c; b = ROTL(b, 12);        \
+        a += b; d ^= a; d = ROTL(d, 8);         \
+        c += d; b ^= c; b = ROTL(b, 7);         \
+    } while (0)
+
+static uint32_t load32(const uint8_t* p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void store32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static void chacha_block(const uint32_t in[16], uint8_t out[BLOCK_LEN]) {
+    uint32_t x[16];
+    memcpy(x, in, sizeof(x));
+    for (int i = 0; i < 10; i++) {
+        QR(x[0], x[4], x[8],  x[12]);      // columns
+        QR(x[1], x[5], x[9],  x[13]);
+        QR(x[2], x[6], x[10], x[14]);
+        QR(x[3], x[7], x[11], x[15]);
+        QR(x[0], x[5], x[10], x[15]);      // diagonals
+        QR(x[1], x[6], x[11], x[12]);
+        QR(x[2], x[7], x[8],  x[13]);
+        QR(x[3], x[4], x[9],  x[14]);
+    }
+    for (int i = 0; i < 16; i++) store32(out + 4 * i, x[i] + in[i]);
+}
+
+static void chacha_key(RngState* s, const uint8_t seed[SEED_LEN]) {
+    s->input[0] = 0x61707865;          // "expand 32-byte k"
+    s->input[1] = 0x3320646e;
+    s->input[2] = 0x79622d32;
+    s->input[3] = 0x6b206574;
+    for (int i = 0; i < 8; i++) s->input[4 + i] = load32(seed + 4 * i);
+    s->input[12] = 0;
+    for (int i = 0; i < 3; i++) s->input[13 + i] = load32(seed + KEY_LEN + 4 * i);
+}
+
+
+// ============================================================
+//  Seeding and refill
+// ============================================================
+
+static void on_fork_child(void) {
+    atomic_fetch_add(&g_fork_gen, 1);
+}
+
+static void atfork_init(void) {
+    pthread_atfork(NULL, NULL, on_fork_child);
+}
+
+// Kernel entropy; there is no safe fallback for session tokens
+static void os_random(uint8_t* out, size_t n) {
+    size_t got = 0;
+    while (got < n) {
+        ssize_t r = getrandom(out + got, n - got, 0);
+        if (r < 0 && errno == EINTR) continue;
+        if (r < 0) break;
+        got += (size_t)r;
+    }
+    if (got == n) return;
+
+    int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+    while (fd >= 0 && got < n) {
+        ssize_t r = read(fd, out + got, n - got);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) break;
+        got += (size_t)r;
+    }
+    if (fd >= 0) close(fd);
+    if (got == n) return;
+
+    perror("rng: no kernel entropy");
+    abort();
+}
+
+static void refill(RngState* s) {
+    for (int b = 0; b < RNG_BLOCKS; b++) {
+        chacha_block(s->input, s->buf + b * BLOCK_LEN);
+        s->input[12]++;
+    }
+    // Fast key erasure: the start of the batch becomes the next key
+    chacha_key(s, s->buf);
+    memset(s->buf, 0, SEED_LEN);
+    s->avail = BUF_LEN - SEED_LEN;
+}
+
+static void reseed(RngState* s) {
+    pthread_once(&g_atfork_once, atfork_init);
+    uint8_t seed[SEED_LEN];
+    os_random(seed, sizeof(seed));
+    if (s->seeded) {
+        // Mix into the running key rather than replace it
+        uint8_t cur[BLOCK_LEN];
+        chacha_block(s->input, cur);
+        for (int i = 0; i < SEED_LEN; i++) seed[i] ^= cur[i];
+        memset(cur, 0, sizeof(cur));
+    }
+    chacha_key(s, seed);
+    memset(seed, 0, sizeof(seed));
+    s->fork_gen = atomic_load(&g_fork_gen);
+    s->since_seed = 0;
+    s->seeded = true;
+    refill(s);
+}
+
+static RngState* state(size_t want) {
+    RngState* s = &g_rng;
+    if (!s->seeded || s->since_seed >= RNG_RESEED_BYTES ||
+        s->fork_gen != atomic_load_explicit(&g_fork_gen, memory_order_relaxed))
+        reseed(s);
+    s->since_seed += want;
+    return s;
+}
+
+
+// ============================================================
+//  Public API
+// ============================================================
+void rng_bytes(void* out, size_t n) {
+    RngState* s = state(n);
+    uint8_t* o = out;
+    while (n > 0) {
+        if (s->avail == 0) refill(s);
+        size_t take = n < s->avail ? n : s->avail;
+        uint8_t* src = s->buf + BUF_LEN - s->avail;
+        memcpy(o, src, take);
+        memset(src, 0, take);
+        o += take;
+        n -= take;
+        s->avail -= take;
+    }
+}
+
+uint32_t rng_below(uint32_t n) {
+    // Reject the values that would make some results more likely
+    uint32_t floor = (uint32_t)-n % n;
+    uint32_t v;
+    do {
+        rng_bytes(&v, sizeof(v));
+    } while (v < floor);
+    return v % n;
+}
+
+void rng_token(char* out, size_t cap) {
+    static const char B64[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+    if (cap < RNG_TOKEN_LEN + 1) {
+        if (cap) out[0] = '\0';
+        return;
+    }
+
+    uint8_t raw[RNG_TOKEN_BITS / 8 + 2] = { 0 };    // padded to 18 = 6 groups of 3
+    char enc[24];
+    rng_bytes(raw, RNG_TOKEN_BITS / 8);
+    for (int i = 0, o = 0; i < 18; i += 3) {
+        uint32_t v = (uint32_t)raw[i] << 16 | (uint32_t)raw[i + 1] << 8 | raw[i + 2];
+        enc[o++] = B64[(v >> 18) & 63];
+        enc[o++] = B64[(v >> 12) & 63];
+        enc[o++] = B64[(v >> 6) & 63];
+        enc[o++] = B64[v & 63];
+    }
+    memcpy(out, enc, RNG_TOKEN_LEN);    // the last 2 characters are padding
+    out[RNG_TOKEN_LEN] = '\0';
+    memset(raw, 0, sizeof(raw));
+    memset(enc, 0, sizeof(enc));
+}
@@ -7,25 +7,51 @@
 
 #include "room.h"
 #include "utils.h"
+#include "tournament.h"
+#include "invite.h"
+#include "bot.h"
+#include "presence.h"
+#include "shard.h"
 #include "client.h"
 #include "config.h"
 #include "log.h"
+#include "fanout.h"
+#include "matchmaking.h"
+#include "timer.h"
+#include "drain.h"
+#include "feed.h"
+#include "slab.h"
+#include "overload.h"
+#include "stats.h"
 
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <pthread.h>
 
 // ============================================================
 //  GLOBAL DATA
 // ============================================================
-Room g_rooms[MAX_ROOMS];
+Room** g_rooms = NULL;
 int  g_room_count = 0;
+int  g_room_cap = 0;
 static int g_next_room_id = 0;
 pthread_mutex_t g_rooms_mtx = PTHREAD_MUTEX_INITIALIZER;
 
+// Room structs; filled by room_prealloc()
+static Slab g_room_slab = SLAB_INIT("rooms", sizeof(Room));
+
 // Internal helper: assumes g_rooms_mtx is locked
 static void room_remove_if_empty_locked(Room* r);
 static void prune_slot(Room* r, struct Client** slot, bool* flag, time_t* ts);
+static long clock_arm(Room* r);
+static int clock_full(const Room* r);
+static void series_reset(Room* r);
+static void series_on_result(Room* r, struct Client* winner);
+static void room_fill_arm(Room* r);
+static void room_seat_freed_locked(Room* r);
+static void bot_game_over(Room* r);
+static void dir_publish(const Room* r);
 
 
 // ============================================================
@@ -34,22 +60,38 @@ static void prune_slot(Room* r, struct Client** slot, bool* flag, time_t* ts);
 //  Creates a new room, assigns the creator as Player 1 (p1),
 //  and sets the initial WAITING state.
 // ============================================================
-Room* room_create(const char* name, struct Client* creator) {
+Room* room_create(const char* name, struct Client* creator, const RoomOptions* opts) {
+    if (drain_active()) {
+        sendp(creator->fd, "ERROR|Server is draining");
+        return NULL;
+    }
     pthread_mutex_lock(&g_rooms_mtx);
-    if (g_room_count >= g_config.max_rooms) {
+    if (creator->dying) {       // seated by another thread while leaving
+        pthread_mutex_unlock(&g_rooms_mtx);
+        return NULL;
+    }
+    if (creator->current_room) {
+        pthread_mutex_unlock(&g_rooms_mtx);
+        sendp(creator->fd, "ERROR|Already in a room. Leave first.");
+        return NULL;
+    }
+    Room* r = NULL;
+    if (g_room_count < config_get()->max_rooms && g_room_count < g_room_cap)
+        r = room_alloc();
+    if (!r) {
         pthread_mutex_unlock(&g_rooms_mtx);
         sendp(creator->fd, "ERROR|Lobby full");
         return NULL;
     }
+    g_rooms[g_room_count++] = r;
 
-    Room* r = &g_rooms[g_room_count++];
-    memset(r, 0, sizeof(Room));
-
-    r->id = g_next_room_id++;
+    int gid = shard_next_room_id();     // cluster-wide IDs in multi-process mode
+    r->id = (gid >= 0) ? gid : g_next_room_id++;
     snprintf(r->name, sizeof(r->name), "%s", name);
 
     r->state = ROOM_WAITING;
     r->starting_player = 0;
+    if (opts) r->opts = *opts;
 
     r->p1 = creator;
     r->p2 = NULL;
@@ -62,39 +104,159 @@ Room* room_create(const char* name, struct Client* creator) {
 
     creator->current_room = r;
     creator->state = CLIENT_STATE_WAITING;
+    presence_set(creator, PRES_WAITING, r->id);
 
     r->turn_owner_disconnected = 0;
     r->replay_p1 = 0;
     r->replay_p2 = 0;
 
     sendp(creator->fd, "CREATED|%d|%s", r->id, r->name);
-    server_log("Room created: id=%d name=%s by %s", r->id, r->name, creator->name);
+    if (r->opts.is_private) {
+        if (invite_create(r->id, (long)config_get()->invite_ttl * 1000, r->invite_code))
+            sendp(creator->fd, "CODE|%s", r->invite_code);
+        else
+            sendp(creator->fd, "ERROR|No invite code available");
+    }
+    room_fill_arm(r);
+    dir_publish(r);
+    server_log("Room created: id=%d name=%s by %s%s", r->id, r->name, creator->name,
+               r->opts.is_private ? " (private)" : "");
     pthread_mutex_unlock(&g_rooms_mtx);
     return r;
 }
 
 
+// ============================================================
+//  room_options_parse()
+//  ------------------------------------------------------------
+//  "name|private|bo3|bot=20|move=30" or "name|fischer=180+2". Unknown options are
+//  rejected so that typos do not silently create a plain room.
+// ============================================================
+int room_options_parse(const char* payload, char* name, size_t name_cap, RoomOptions* opts) {
+    memset(opts, 0, sizeof(*opts));
+
+    const char* bar = strchr(payload, '|');
+    size_t len = bar ? (size_t)(bar - payload) : strlen(payload);
+    if (len >= name_cap) len = name_cap - 1;
+    memcpy(name, payload, len);
+    name[len] = '\0';
+
+    while (bar) {
+        const char* opt = bar + 1;
+        bar = strchr(opt, '|');
+        int olen = bar ? (int)(bar - opt) : (int)strlen(opt);
+        char tmp[32];
+        if (olen <= 0) continue;
+        if (olen >= (int)sizeof(tmp)) return 0;
+        memcpy(tmp, opt, (size_t)olen);
+        tmp[olen] = '\0';
+
+        int a, b;
+        char extra;
+        if (strcmp(tmp, "private") == 0) {
+            opts->is_private = true;
+        } else if (sscanf(tmp, "bo%d%c", &a, &extra) == 1 && (a == 3 || a == 5 || a == 7)) {
+            opts->series_len = a;
+        } else if (sscanf(tmp, "bot=%d%c", &a, &extra) == 1 && a > 0 && a <= 600) {
+            opts->bot_fill_ms = a * 1000;
+        } else if (sscanf(tmp, "move=%d%c", &a, &extra) == 1 && a > 0 && a <= 3600) {
+            opts->tc = TC_PER_MOVE;
+            opts->move_ms = a * 1000;
+        } else if (sscanf(tmp, "fischer=%d+%d%c", &a, &b, &extra) == 2 &&
+                   a > 0 && a <= 3600 && b >= 0 && b <= 60) {
+            opts->tc = TC_FISCHER;
+            opts->base_ms = a * 1000;
+            opts->inc_ms = b * 1000;
+        } else {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
 // ============================================================
 //  room_find_by_id()
 //  ------------------------------------------------------------
 //  Finds a room by its unique ID.
 // ============================================================
-static Room* room_find_by_id(int id) {
+Room* room_find_by_id(int id) {
     for (int i = 0; i < g_room_count; i++)
-        if (g_rooms[i].id == id) return &g_rooms[i];
+        if (g_rooms[i]->id == id) return g_rooms[i];
     return NULL;
 }
 
 
+// ============================================================
+//  dir_publish()
+//  ------------------------------------------------------------
+//  Tells the room feed (see feed.h) about a change and, in
+//  multi-process mode, refreshes this room's entry in the shared
+//  room directory (expects g_rooms_mtx held).
+// ============================================================
+static void dir_publish(const Room* r) {
+    feed_room(r);
+    if (!shard_enabled()) return;
+
+    ShardRoom e;
+    memset(&e, 0, sizeof(e));
+    e.room_id = r->id;
+    e.players = (r->p1 != NULL) + (r->p2 != NULL);
+    e.waiting = (r->state == ROOM_WAITING);
+    e.is_private = r->opts.is_private;
+    snprintf(e.name, sizeof(e.name), "%s", r->name);
+    snprintf(e.code, sizeof(e.code), "%s", r->invite_code);
+    snprintf(e.p1, sizeof(e.p1), "%s", r->p1_name);
+    snprintf(e.p2, sizeof(e.p2), "%s", r->p2_name);
+    shard_dir_put(&e);
+}
+
+
+// ============================================================
+//  chat_history_append()
+//  ------------------------------------------------------------
+//  Adds the room's chat ring, oldest first, to a MsgBuf
+//  (expects g_rooms_mtx held).
+// ============================================================
+static void chat_history_append(const Room* r, MsgBuf* mb) {
+    int start = (r->chat_count == CHAT_HISTORY_LEN) ? r->chat_head : 0;
+    for (int i = 0; i < r->chat_count; i++) {
+        const ChatLine* l = &r->chat[(start + i) % CHAT_HISTORY_LEN];
+        msgbuf_add(mb, "CHAT|ROOM|%s|%s", l->from, l->text);
+    }
+}
+
+
 // ============================================================
 //  room_join()
 //  ------------------------------------------------------------
 //  Allows a second player to join an existing WAITING room.
+//  Private rooms are reachable only through room_join_code().
 // ============================================================
+static Room* room_join_locked(Room* r, struct Client* joiner);
+
 Room* room_join(int room_id, struct Client* joiner) {
     pthread_mutex_lock(&g_rooms_mtx);
     Room* r = room_find_by_id(room_id);
+    if (r && r->opts.is_private) r = NULL;
+    return room_join_locked(r, joiner);
+}
+
+Room* room_join_code(const char* code, struct Client* joiner) {
+    int id = invite_lookup(code);
+    if (id < 0) {
+        sendp(joiner->fd, "ERROR|Invalid invite code");
+        return NULL;
+    }
+    pthread_mutex_lock(&g_rooms_mtx);
+    return room_join_locked(room_find_by_id(id), joiner);
+}
+
+// Expects g_rooms_mtx held; releases it before returning
+static Room* room_join_locked(Room* r, struct Client* joiner) {
+    if (joiner->dying) { pthread_mutex_unlock(&g_rooms_mtx); return NULL; }
     if (!r) { pthread_mutex_unlock(&g_rooms_mtx); sendp(joiner->fd, "ERROR|No such room"); return NULL; }
+    if (drain_active()) { pthread_mutex_unlock(&g_rooms_mtx); sendp(joiner->fd, "ERROR|Server is draining"); return NULL; }
     
     // Check if player is already in a room (any room)
     if (joiner->current_room != NULL) {
@@ -107,7 +269,7 @@ Room* room_join(int room_id, struct Client* joiner) {
 
     // Normalize room so that a lone player always occupies p1.
     // This avoids a "full" room when p1 left voluntarily after a replay decline.
-    if (r->p1 == NULL && r->p2 != NULL && !r->p2_disconnected) {
+    if (r->p1 == NULL && r->p2 != NULL && !r->p2_disconnected && !r->p2->is_bot) {
         r->p1 = r->p2;
         r->p2 = NULL;
         snprintf(r->p1_name, sizeof(r->p1_name), "%s", r->p1->name);
@@ -118,6 +280,14 @@ Room* room_join(int room_id, struct Client* joiner) {
         r->p2_disconnected_at = 0;
     }
 
+    // A bot keeps the seat until its game ends, then yields it to one waiting human
+    if (r->p2 && r->p2->is_bot && !joiner->is_bot && r->bot_waiter[0] == '\0') {
+        snprintf(r->bot_waiter, sizeof(r->bot_waiter), "%s", joiner->session_id);
+        pthread_mutex_unlock(&g_rooms_mtx);
+        sendp(joiner->fd, "INFO|A bot holds the seat, you get it after this game");
+        return NULL;
+    }
+
     // Room is considered full only if both slots are occupied
     if (r->state != ROOM_WAITING || (r->p1 != NULL && r->p2 != NULL)) { pthread_mutex_unlock(&g_rooms_mtx); sendp(joiner->fd, "ERROR|Room full"); return NULL; }
 
@@ -132,9 +302,14 @@ Room* room_join(int room_id, struct Client* joiner) {
         snprintf(r->p2_session, sizeof(r->p2_session), "%s", joiner->session_id);
     }
     r->state = ROOM_PLAYING;
+    timer_cancel(r->fill_timer);
+    r->fill_timer = 0;
+    if (strcmp(r->bot_waiter, joiner->session_id) == 0) r->bot_waiter[0] = '\0';
 
     joiner->current_room = r;
     joiner->state = CLIENT_STATE_PLAYING;
+    presence_set(r->p1, PRES_PLAYING, r->id);
+    presence_set(r->p2, PRES_PLAYING, r->id);
 
     // Notify both players
     sendp(joiner->fd, "JOINEDROOM|%d|%s", r->id, r->name);
@@ -156,6 +331,17 @@ Room* room_join(int room_id, struct Client* joiner) {
 
     r->replay_p1 = r->replay_p2 = 0;
     game_start(r);
+    r->clock_ms[0] = r->clock_ms[1] = clock_full(r);
+    room_clock_start(r);
+    series_reset(r);
+    bot_on_turn(r);
+
+    MsgBuf history;
+    msgbuf_init(&history);
+    chat_history_append(r, &history);
+    msgbuf_send(joiner->fd, &history);
+    fanout_room(r, "PLAYERS|%s|%s", first->name, second->name);
+    dir_publish(r);
     server_log("Room %s started game: %s (X) vs %s (O)", r->name, first->name, second->name);
     pthread_mutex_unlock(&g_rooms_mtx);
     return r;
@@ -169,10 +355,14 @@ Room* room_join(int room_id, struct Client* joiner) {
 //  reconnect, updates room state accordingly.
 // ============================================================
 void room_leave(struct Client* c) {
-    Room* r = c->current_room;
-    if (!r) return;
     pthread_mutex_lock(&g_rooms_mtx);
+    Room* r = c->current_room;
+    if (!r) {
+        pthread_mutex_unlock(&g_rooms_mtx);
+        return;
+    }
     int was_playing = (r->state == ROOM_PLAYING);
+    room_clock_stop(r, 0);
 
     if (r->p1 == c) r->p1 = NULL;
     if (r->p2 == c) r->p2 = NULL;
@@ -197,6 +387,7 @@ void room_leave(struct Client* c) {
     c->current_room = NULL;
     c->state = CLIENT_STATE_LOBBY;
     sendp(c->fd, "EXITED|");
+    presence_set(c, PRES_LOBBY, -1);
     server_log("Player %s left room %s", c->name, r->name);
 
     struct Client* other = (r->p1) ? r->p1 : r->p2;
@@ -204,16 +395,20 @@ void room_leave(struct Client* c) {
         sendp(other->fd, "INFO|Opponent left");
         sendp(other->fd, "WIN|You");
         server_log("Room %s: opponent left, awarding win to %s", r->name, other->name);
+        if (r->game.state == 0) room_game_over(r, other);
     }
 
     r->replay_p1 = r->replay_p2 = 0;
+    room_seat_freed_locked(r);
 
     if (!r->p1 && !r->p2) {
         r->state = ROOM_EMPTY;
-        room_remove_if_empty_locked(r);
         server_log("Room %s removed (empty)", r->name);
+        room_remove_if_empty_locked(r);
     } else if (!r->p1 || !r->p2) {
         r->state = ROOM_WAITING;
+        presence_set(r->p1 ? r->p1 : r->p2, PRES_WAITING, r->id);
+        dir_publish(r);
         server_log("Room %s set to WAITING (one player remaining)", r->name);
     }
     pthread_mutex_unlock(&g_rooms_mtx);
@@ -238,27 +433,77 @@ void room_remove_if_empty(Room* r) {
 //  rooms_list_send()
 //  ------------------------------------------------------------
 //  Sends the current list of rooms to a requesting client.
+//  Under overload the last reply is reused for up to
+//  OVERLOAD_LIST_CACHE_MS instead of walking every room.
 // ============================================================
+static struct {
+    pthread_mutex_t mtx;        // Leaf lock
+    char line[600];
+    long long at;               // now_ms() when built, 0 = empty
+} g_list_cache = { PTHREAD_MUTEX_INITIALIZER, "", 0 };
+
+static bool list_cached_send(int fd) {
+    if (overload_level() < OVERLOAD_LIST_CACHED) return false;
+    char line[sizeof(g_list_cache.line)];
+    pthread_mutex_lock(&g_list_cache.mtx);
+    bool fresh = g_list_cache.at && now_ms() - g_list_cache.at < OVERLOAD_LIST_CACHE_MS;
+    if (fresh) memcpy(line, g_list_cache.line, sizeof(line));
+    pthread_mutex_unlock(&g_list_cache.mtx);
+    if (!fresh) return false;
+    stats_inc(STAT_LIST_CACHED);
+    sendp(fd, "%s", line);
+    return true;
+}
+
+static void list_cache_store(int fd, int listed, const char* entries) {
+    pthread_mutex_lock(&g_list_cache.mtx);
+    snprintf(g_list_cache.line, sizeof(g_list_cache.line), "ROOMS|%d%s", listed, entries);
+    g_list_cache.at = now_ms();
+    pthread_mutex_unlock(&g_list_cache.mtx);
+    sendp(fd, "ROOMS|%d%s", listed, entries);
+}
+
 void rooms_list_send(struct Client* c) {
-    char buf[512];
+    char entries[512];
+    int off = 0, listed = 0;
+    entries[0] = '\0';
+
+    if (list_cached_send(c->fd)) return;
+
+    // Multi-process mode: list the rooms of every worker
+    if (shard_enabled()) {
+        ShardRoom list[64];
+        int n = shard_dir_list(list, 64);
+        for (int i = 0; i < n && off < (int)sizeof(entries); i++) {
+            off += snprintf(entries + off, sizeof(entries) - off,
+                            "|%d|%s|%s|%d/2",
+                            list[i].room_id, list[i].name,
+                            list[i].waiting ? "WAITING" : "PLAYING",
+                            list[i].players);
+            listed++;
+        }
+        list_cache_store(c->fd, listed, entries);
+        return;
+    }
+
     pthread_mutex_lock(&g_rooms_mtx);
-    int off = snprintf(buf, sizeof(buf), "ROOMS|%d", g_room_count);
-    for (int i = 0; i < g_room_count; i++) {
-        Room* r = &g_rooms[i];
-        if (r->state == ROOM_EMPTY) continue;
+    for (int i = 0; i < g_room_count && off < (int)sizeof(entries); i++) {
+        Room* r = g_rooms[i];
+        if (r->state == ROOM_EMPTY || r->opts.is_private) continue;
 
         int players = 0;
         if (r->p1) players++;
         if (r->p2) players++;
 
-        off += snprintf(buf + off, sizeof(buf) - off,
+        off += snprintf(entries + off, sizeof(entries) - off,
                         "|%d|%s|%s|%d/2",
                         r->id, r->name,
                         (r->state == ROOM_WAITING ? "WAITING" : "PLAYING"),
                         players);
+        listed++;
     }
     pthread_mutex_unlock(&g_rooms_mtx);
-    sendp(c->fd, "%s", buf);
+    list_cache_store(c->fd, listed, entries);
 }
 
 
@@ -268,36 +513,449 @@ void rooms_list_send(struct Client* c) {
 //  When both players confirm "Play Again", resets the board,
 //  swaps the starting player, and starts a new round.
 // ============================================================
+// Expects g_rooms_mtx held and both players present
+static void room_restart_locked(Room* r) {
+    r->starting_player = 1 - r->starting_player;
+
+    if (r->starting_player == 0) game_reset(&r->game, r->p1);
+    else                         game_reset(&r->game, r->p2);
+
+    r->state = ROOM_PLAYING;
+    r->replay_p1 = r->replay_p2 = 0;
+
+    sendp(r->p1->fd, "RESTART|");
+    sendp(r->p2->fd, "RESTART|");
+    fanout_room(r, "RESTART|");
+    server_log("Room %s replay agreed, starting player: %s", r->name,
+         r->starting_player == 0 ? r->p1->name : r->p2->name);
+
+    if (r->starting_player == 0) {
+        sendp(r->p1->fd, "TURN|Your move");
+        sendp(r->p1->fd, "SYMBOL|X");
+        sendp(r->p2->fd, "SYMBOL|O");
+    } else {
+        sendp(r->p2->fd, "TURN|Your move");
+        sendp(r->p2->fd, "SYMBOL|X");
+        sendp(r->p1->fd, "SYMBOL|O");
+    }
+
+    r->clock_ms[0] = r->clock_ms[1] = clock_full(r);
+    room_clock_start(r);
+    if (r->series_over) series_reset(r);
+    bot_on_turn(r);
+}
+
 void room_try_restart(Room* r) {
     if (!r || !r->p1 || !r->p2) return;
+    if (drain_active()) return;     // closed by the next drain pass
 
     pthread_mutex_lock(&g_rooms_mtx);
+    if (r->replay_p1 && r->replay_p2) room_restart_locked(r);
+    pthread_mutex_unlock(&g_rooms_mtx);
+}
 
-    if (r->replay_p1 && r->replay_p2) {
-        r->starting_player = 1 - r->starting_player;
 
-        if (r->starting_player == 0) game_reset(&r->game, r->p1);
-        else                         game_reset(&r->game, r->p2);
+// ============================================================
+//  room_replay()
+//  ------------------------------------------------------------
+//  A player's answer to "Play Again". Runs entirely under the
+//  rooms lock: the room may be freed by prune, flag-fall or bot
+//  callbacks as soon as the lock is dropped.
+// ============================================================
+int room_replay(struct Client* c, bool yes) {
+    pthread_mutex_lock(&g_rooms_mtx);
+    Room* r = c->current_room;
+    if (!r) {
+        pthread_mutex_unlock(&g_rooms_mtx);
+        return 0;
+    }
+    server_log("Replay vote from %s: %s (room %s)", c->name, yes ? "YES" : "NO", r->name);
+
+    if (yes) {
+        if (r->p1 == c) r->replay_p1 = 1;
+        if (r->p2 == c) r->replay_p2 = 1;
+        sendp(c->fd, "INFO|Replay confirmed");
+        if (r->p1 && r->p2 && r->replay_p1 && r->replay_p2 && !drain_active())
+            room_restart_locked(r);
+        pthread_mutex_unlock(&g_rooms_mtx);
+        return 1;
+    }
 
-        r->state = ROOM_PLAYING;
-        r->replay_p1 = r->replay_p2 = 0;
+    // Declined (voluntary exit - no reconnect allowed)
+    sendp(c->fd, "INFO|You declined replay");
 
-        sendp(r->p1->fd, "RESTART|");
-        sendp(r->p2->fd, "RESTART|");
-        server_log("Room %s replay agreed, starting player: %s", r->name,
-             r->starting_player == 0 ? r->p1->name : r->p2->name);
+    // Reset any pending replay flags; a decline cancels the restart cycle
+    r->replay_p1 = 0;
+    r->replay_p2 = 0;
 
-        if (r->starting_player == 0) {
-            sendp(r->p1->fd, "TURN|Your move");
-            sendp(r->p1->fd, "SYMBOL|X");
-            sendp(r->p2->fd, "SYMBOL|O");
+    struct Client* other = (r->p1 == c) ? r->p2 : r->p1;
+    if (other) {
+        sendp(other->fd, "INFO|Opponent declined replay");
+        sendp(other->fd, "CLEAR|");
+        game_reset(&r->game, other);
+        other->state = CLIENT_STATE_WAITING;
+        other->current_room = r;
+        presence_set(other, PRES_WAITING, r->id);
+    }
+
+    // Clear slot and DO NOT preserve reconnect info (voluntary exit)
+    if (r->p1 == c) {
+        r->p1 = NULL;
+        r->p1_name[0] = '\0';
+        r->p1_session[0] = '\0';
+        r->p1_disconnected = false;
+    }
+    if (r->p2 == c) {
+        r->p2 = NULL;
+        r->p2_name[0] = '\0';
+        r->p2_session[0] = '\0';
+        r->p2_disconnected = false;
+    }
+
+    c->current_room = NULL;
+    c->state = CLIENT_STATE_LOBBY;
+    r->state = ROOM_WAITING;
+    sendp(c->fd, "EXITED|");
+    presence_set(c, PRES_LOBBY, -1);
+
+    room_seat_freed_locked(r);
+
+    // If room is now empty, remove it
+    if (!r->p1 && !r->p2) {
+        r->state = ROOM_EMPTY;
+        room_remove_if_empty_locked(r);
+    } else {
+        dir_publish(r);
+    }
+    pthread_mutex_unlock(&g_rooms_mtx);
+    return 1;
+}
+
+
+// ============================================================
+//  room_rematch()
+//  ------------------------------------------------------------
+//  Server-initiated restart (e.g. a drawn knockout game).
+// ============================================================
+void room_rematch(int room_id) {
+    pthread_mutex_lock(&g_rooms_mtx);
+    Room* r = room_find_by_id(room_id);
+    if (r && r->p1 && r->p2 && !drain_active()) room_restart_locked(r);
+    pthread_mutex_unlock(&g_rooms_mtx);
+}
+
+
+// ============================================================
+//  room_close()
+//  ------------------------------------------------------------
+//  Server-initiated end of a room: both players return to the
+//  lobby and the room disappears.
+// ============================================================
+void room_close(int room_id, const char* reason) {
+    pthread_mutex_lock(&g_rooms_mtx);
+    Room* r = room_find_by_id(room_id);
+    if (!r) {
+        pthread_mutex_unlock(&g_rooms_mtx);
+        return;
+    }
+
+    room_clock_stop(r, 0);
+    struct Client* players[2] = { r->p1, r->p2 };
+    for (int i = 0; i < 2; i++) {
+        struct Client* p = players[i];
+        if (!p) continue;
+        if (p->is_bot) {
+            bot_destroy(p);
+            continue;
+        }
+        sendp(p->fd, "INFO|%s", reason);
+        sendp(p->fd, "EXITED|");
+        p->current_room = NULL;
+        p->state = CLIENT_STATE_LOBBY;
+        presence_set(p, PRES_LOBBY, -1);
+    }
+
+    r->p1 = r->p2 = NULL;
+    r->p1_name[0] = r->p2_name[0] = '\0';
+    r->p1_session[0] = r->p2_session[0] = '\0';
+    r->p1_disconnected = r->p2_disconnected = false;
+    r->state = ROOM_EMPTY;
+    server_log("Room %s closed: %s", r->name, reason);
+    room_remove_if_empty_locked(r);
+    pthread_mutex_unlock(&g_rooms_mtx);
+}
+
+
+// ============================================================
+//  room_drain_pass()
+//  ------------------------------------------------------------
+//  Drain mode (see drain.h): closes every room that has no game
+//  running. A game counts as running while it is undecided,
+//  including a player's reconnect grace period.
+// ============================================================
+int room_drain_pass(bool all, const char* reason) {
+    int ids[MAX_ROOMS];
+    int n = 0;
+
+    pthread_mutex_lock(&g_rooms_mtx);
+    for (int i = 0; i < g_room_count && n < MAX_ROOMS; i++) {
+        Room* r = g_rooms[i];
+        bool running = r->game.state == 0 &&
+                       (r->state == ROOM_PLAYING || r->p1_disconnected || r->p2_disconnected);
+        if (all || !running) ids[n++] = r->id;
+    }
+    pthread_mutex_unlock(&g_rooms_mtx);
+
+    for (int i = 0; i < n; i++) room_close(ids[i], reason);
+
+    pthread_mutex_lock(&g_rooms_mtx);
+    int left = g_room_count;
+    pthread_mutex_unlock(&g_rooms_mtx);
+    return left;
+}
+
+
+// ============================================================
+//  Best-of-N series
+//  ------------------------------------------------------------
+//  When a series game ends, the next round is fully prepared
+//  right away (per-player RESTART/TURN/SYMBOL/CLOCK/SERIES block)
+//  and a timer starts it after the configured pause with a
+//  single send per player.
+// ============================================================
+static void series_announce(Room* r) {
+    int s1 = r->series_score[0], s2 = r->series_score[1], n = r->opts.series_len;
+    if (r->p1) sendp(r->p1->fd, "SERIES|%d|%d|%d", s1, s2, n);
+    if (r->p2) sendp(r->p2->fd, "SERIES|%d|%d|%d", s1, s2, n);
+    fanout_room(r, "SERIES|%d|%d|%d", s1, s2, n);
+}
+
+static void series_reset(Room* r) {
+    r->series_score[0] = r->series_score[1] = 0;
+    r->series_over = false;
+    if (r->opts.series_len > 0) series_announce(r);
+}
+
+// Builds the messages of the next round for both seats (expects lock held)
+static void series_stage(Room* r) {
+    int starter = 1 - r->starting_player;
+    const char* starter_name = (starter == 0) ? r->p1->name : r->p2->name;
+    long budget = -1;
+    if (r->opts.tc == TC_PER_MOVE) budget = r->opts.move_ms;
+    if (r->opts.tc == TC_FISCHER)  budget = r->opts.base_ms;
+
+    for (int seat = 0; seat < 2; seat++) {
+        MsgBuf mb;
+        msgbuf_init(&mb);
+        msgbuf_add(&mb, "RESTART|");
+        if (seat == starter) {
+            msgbuf_add(&mb, "TURN|Your move");
+            msgbuf_add(&mb, "SYMBOL|X");
         } else {
-            sendp(r->p2->fd, "TURN|Your move");
-            sendp(r->p2->fd, "SYMBOL|X");
-            sendp(r->p1->fd, "SYMBOL|O");
+            msgbuf_add(&mb, "SYMBOL|O");
         }
+        if (budget >= 0) msgbuf_add(&mb, "CLOCK|%s|%ld", starter_name, budget);
+        msgbuf_add(&mb, "SERIES|%d|%d|%d", r->series_score[0], r->series_score[1], r->opts.series_len);
+
+        size_t len = mb.len < sizeof(r->series_stage[seat]) ? mb.len : 0;
+        memcpy(r->series_stage[seat], mb.data, len);
+        r->series_stage_len[seat] = (int)len;
+    }
+}
+
+// Timer thread: the pause after a series game is over
+static void on_series_next(long room_id, long seq) {
+    pthread_mutex_lock(&g_rooms_mtx);
+    Room* r = room_find_by_id((int)room_id);
+    if (!r || r->series_seq != seq || r->game.state == 0 || !r->p1 || !r->p2) {
+        pthread_mutex_unlock(&g_rooms_mtx);
+        return;
+    }
+
+    r->starting_player = 1 - r->starting_player;
+    game_reset(&r->game, r->starting_player == 0 ? r->p1 : r->p2);
+    r->state = ROOM_PLAYING;
+    r->replay_p1 = r->replay_p2 = 0;
+    r->clock_ms[0] = r->clock_ms[1] = clock_full(r);
+
+    sendraw(r->p1->fd, r->series_stage[0], (size_t)r->series_stage_len[0]);
+    sendraw(r->p2->fd, r->series_stage[1], (size_t)r->series_stage_len[1]);
+    fanout_room(r, "RESTART|");
+    clock_arm(r);
+    bot_on_turn(r);
+    server_log("Room %s series round started (%d:%d)", r->name,
+               r->series_score[0], r->series_score[1]);
+    pthread_mutex_unlock(&g_rooms_mtx);
+}
+
+static void series_on_result(Room* r, struct Client* winner) {
+    if (r->series_over) return;     // finished series: plain replays from now on
+
+    if (winner && winner == r->p1) r->series_score[0]++;
+    if (winner && winner == r->p2) r->series_score[1]++;
+    series_announce(r);
+
+    int need = r->opts.series_len / 2 + 1;
+    if (r->series_score[0] >= need || r->series_score[1] >= need) {
+        r->series_over = true;
+        const char* champ = (r->series_score[0] >= need) ? r->p1_name : r->p2_name;
+        if (r->p1) sendp(r->p1->fd, "SERIES_END|%s|%d|%d", champ, r->series_score[0], r->series_score[1]);
+        if (r->p2) sendp(r->p2->fd, "SERIES_END|%s|%d|%d", champ, r->series_score[0], r->series_score[1]);
+        fanout_room(r, "SERIES_END|%s|%d|%d", champ, r->series_score[0], r->series_score[1]);
+        server_log("Room %s series won by %s (%d:%d)", r->name, champ,
+                   r->series_score[0], r->series_score[1]);
+        return;
+    }
+
+    if (!r->p1 || !r->p2) return;
+    series_stage(r);
+    r->series_seq++;
+    timer_arm(config_get()->series_pause_ms, on_series_next, r->id, r->series_seq);
+}
+
+
+// ============================================================
+//  Bot fill-in
+//  ------------------------------------------------------------
+//  Rooms created with bot=<s> arm one timer-wheel entry while a
+//  lone human waits (O(1) to arm and cancel). When it fires, a
+//  bot takes the p2 seat. After each game the bot either agrees
+//  to a replay or, if a human asked for the seat meanwhile,
+//  leaves and the human is seated.
+// ============================================================
+static void on_fill(long room_id, long seq) {
+    pthread_mutex_lock(&g_rooms_mtx);
+    Room* r = room_find_by_id((int)room_id);
+    if (!r || r->fill_seq != seq || r->state != ROOM_WAITING ||
+        !r->p1 || r->p2 || r->p2_disconnected) {
+        pthread_mutex_unlock(&g_rooms_mtx);
+        return;
+    }
+    r->fill_timer = 0;
+
+    struct Client* bot = bot_create();
+    if (!bot) {
+        pthread_mutex_unlock(&g_rooms_mtx);
+        return;
+    }
+    server_log("Room %s: no opponent after %d s, seating %s", r->name,
+               r->opts.bot_fill_ms / 1000, bot->name);
+    if (!room_join_locked(r, bot)) bot_destroy(bot);
+}
+
+// Expects g_rooms_mtx held
+static void room_fill_arm(Room* r) {
+    if (r->opts.bot_fill_ms <= 0) return;
+    timer_cancel(r->fill_timer);
+    r->fill_seq++;
+    r->fill_timer = timer_arm(r->opts.bot_fill_ms, on_fill, r->id, r->fill_seq);
+}
+
+// Expects g_rooms_mtx held and the bot in the p2 seat
+static void bot_unseat_locked(Room* r) {
+    struct Client* bot = r->p2;
+    r->p2 = NULL;
+    r->p2_name[0] = '\0';
+    r->p2_session[0] = '\0';
+    r->p2_disconnected = false;
+    r->p2_disconnected_at = 0;
+    if (r->game.current_turn == bot) r->game.current_turn = NULL;
+    r->replay_p1 = r->replay_p2 = 0;
+    r->bot_seq++;
+    server_log("Room %s: %s left the seat", r->name, bot->name);
+    bot_destroy(bot);
+}
+
+static void room_seat_freed_locked(Room* r) {
+    if (!r->p1 && r->p2 && r->p2->is_bot) {
+        bot_unseat_locked(r);
+    } else if (r->p1 && !r->p2 && !r->p2_disconnected) {
+        room_fill_arm(r);
+    }
+}
+
+// Expects g_rooms_mtx held
+static bool bot_may_yield(const Room* r, long seq) {
+    return r && r->bot_seq == seq && r->game.state != 0 && r->p1 &&
+           r->p2 && r->p2->is_bot;
+}
+
+// Timer thread: hands the bot's seat to the human who asked for it
+static void on_bot_yield(long room_id, long seq) {
+    pthread_mutex_lock(&g_rooms_mtx);
+    Room* r = room_find_by_id((int)room_id);
+    if (!bot_may_yield(r, seq)) {
+        pthread_mutex_unlock(&g_rooms_mtx);
+        return;
+    }
+    char waiter[32];
+    snprintf(waiter, sizeof(waiter), "%s", r->bot_waiter);
+    r->bot_waiter[0] = '\0';
+    pthread_mutex_unlock(&g_rooms_mtx);
+
+    // The waiter is held by session (clients lock before rooms lock),
+    // then everything is checked again
+    struct Client* c = client_hold_by_session(waiter);
+    pthread_mutex_lock(&g_rooms_mtx);
+    r = room_find_by_id((int)room_id);
+    if (!bot_may_yield(r, seq)) {
+        pthread_mutex_unlock(&g_rooms_mtx);
+        client_release(c);
+        return;
+    }
+    if (!c || c->dying || c->current_room) {
+        r->replay_p2 = 1;   // nobody to yield to: the bot plays on
+        pthread_mutex_unlock(&g_rooms_mtx);
+        client_release(c);
+        return;
     }
+
+    struct Client* p1 = r->p1;
+    client_hold(p1);
+    bot_unseat_locked(r);
+    r->state = ROOM_WAITING;
+    p1->state = CLIENT_STATE_WAITING;
+    presence_set(p1, PRES_WAITING, r->id);
+    room_fill_arm(r);
+    dir_publish(r);
     pthread_mutex_unlock(&g_rooms_mtx);
+
+    sendp(p1->fd, "INFO|The bot left, %s takes the seat", c->name);
+    sendp(p1->fd, "CLEAR|");
+    client_release(p1);
+
+    // Seat the waiting human like a regular join
+    pthread_mutex_lock(&g_rooms_mtx);
+    room_join_locked(room_find_by_id((int)room_id), c);
+    client_release(c);
+}
+
+// Expects g_rooms_mtx held, bot in the p2 seat, game just finished
+static void bot_game_over(Room* r) {
+    if (r->bot_waiter[0] != '\0' && r->p1) {
+        r->bot_seq++;
+        timer_arm(0, on_bot_yield, r->id, r->bot_seq);
+    } else {
+        r->replay_p2 = 1;   // the bot always wants another game
+    }
+}
+
+
+// ============================================================
+//  room_game_over()
+//  ------------------------------------------------------------
+//  Single place for follow-ups of a finished game.
+// ============================================================
+void room_game_over(Room* r, struct Client* winner) {
+    if (!r) return;
+    if (r->opts.tourney_id)
+        tourney_report(r->opts.tourney_id, r->id, winner ? winner->session_id : NULL);
+    if (drain_active())
+        return;     // no next game; the next drain pass closes the room
+    if (r->opts.series_len > 0)
+        series_on_result(r, winner);
+    if (r->p2 && r->p2->is_bot)
+        bot_game_over(r);
 }
 
 
@@ -308,13 +966,21 @@ void room_try_restart(Room* r) {
 //  and marks the player slot as temporarily disconnected.
 // ============================================================
 void handle_disconnect(struct Client* c) {
-    if (!c || !c->current_room) return;
+    if (!c) return;
+    pthread_mutex_lock(&g_rooms_mtx);
     Room* r = c->current_room;
+    if (!r) {
+        pthread_mutex_unlock(&g_rooms_mtx);
+        return;
+    }
     time_t now = time(NULL);
 
     printf("Client %s disconnected\n", c->name);
     server_log("Client %s disconnected from room %s", c->name, r->name);
-    pthread_mutex_lock(&g_rooms_mtx);
+
+    // Clocks (and a bot opponent) pause for the whole grace period
+    room_clock_stop(r, 0);
+    r->bot_seq++;
 
     // Preserve identity for reconnect
     if (r->p1 == c) {
@@ -347,16 +1013,18 @@ void handle_disconnect(struct Client* c) {
     struct Client* other = (r->p1) ? r->p1 : r->p2;
     if (other) {
         pthread_mutex_unlock(&g_rooms_mtx);
-        sendp(other->fd, "INFO|Opponent disconnected, waiting %d s to reconnect", g_config.disconnect_grace);
+        sendp(other->fd, "INFO|Opponent disconnected, waiting %d s to reconnect", config_get()->disconnect_grace);
         pthread_mutex_lock(&g_rooms_mtx);
         other->state = CLIENT_STATE_WAITING;
         other->current_room = r;
         r->state = ROOM_WAITING;
+        presence_set(other, PRES_WAITING, r->id);
+        dir_publish(r);
         server_log("Room %s waiting for reconnect of %s", r->name, c->name);
     } else {
         r->state = ROOM_EMPTY;
-        room_remove_if_empty_locked(r);
         server_log("Room %s empty after disconnect", r->name);
+        room_remove_if_empty_locked(r);
     }
     pthread_mutex_unlock(&g_rooms_mtx);
 }
@@ -371,7 +1039,7 @@ void handle_disconnect(struct Client* c) {
 Room* room_reconnect(const char* nick, const char* session, struct Client* newcomer) {
     pthread_mutex_lock(&g_rooms_mtx);
     for (int i = 0; i < g_room_count; ++i) {
-        Room* r = &g_rooms[i];
+        Room* r = g_rooms[i];
 
         // Check P1: matches if slot is empty (disconnected) OR if slot is occupied but credentials match (session stealing)
         bool match_p1 = ( (!r->p1 && r->p1_disconnected) || (r->p1 && !r->p1_disconnected) ) &&
@@ -449,6 +1117,12 @@ Room* room_reconnect(const char* nick, const char* session, struct Client* newco
                 sendp(newcomer->fd, "TURN|");
             }
 
+            // === SEND CHAT HISTORY ===
+            MsgBuf history;
+            msgbuf_init(&history);
+            chat_history_append(r, &history);
+            msgbuf_send(newcomer->fd, &history);
+
             // Notify the other player
             if (opponent) {
                 sendp(opponent->fd, "INFO|Opponent reconnected");
@@ -473,6 +1147,13 @@ Room* room_reconnect(const char* nick, const char* session, struct Client* newco
                 }
             }
 
+            // Resume the clock paused by handle_disconnect()
+            room_clock_start(r);
+            bot_on_turn(r);
+            presence_set(newcomer, PRES_PLAYING, r->id);
+            if (opponent) presence_set(opponent, PRES_PLAYING, r->id);
+            dir_publish(r);
+
             server_log("Client %s reconnected to room %s as %c", newcomer->name, r->name, symbol);
             pthread_mutex_unlock(&g_rooms_mtx);
             return r;
@@ -485,6 +1166,260 @@ Room* room_reconnect(const char* nick, const char* session, struct Client* newco
 }
 
 
+// ============================================================
+//  room_move()
+//  ------------------------------------------------------------
+//  Serializes moves with the timer thread (flag-fall) and the
+//  other room operations.
+// ============================================================
+int room_move(struct Client* c, int x, int y) {
+    pthread_mutex_lock(&g_rooms_mtx);
+    Room* r = c->current_room;
+    int ok = r ? game_move(r, c, x, y) : 0;
+    pthread_mutex_unlock(&g_rooms_mtx);
+    if (!r) sendp(c->fd, "ERROR|Not in game room");
+    return ok;
+}
+
+
+// ============================================================
+//  Move clocks
+//  ------------------------------------------------------------
+//  Only the player on turn has a running clock. Its deadline is
+//  a single timer on the wheel; every stop bumps clock_seq, so a
+//  timer that already left the wheel recognizes itself as stale.
+// ============================================================
+static void on_flag_fall(long room_id, long seq);
+
+// Time a player starts a game with: the per-move budget or the base
+static int clock_full(const Room* r) {
+    return (r->opts.tc == TC_PER_MOVE) ? r->opts.move_ms : r->opts.base_ms;
+}
+
+// Arms the flag-fall timer for the player on turn without telling
+// anybody. Returns the granted budget in ms, or -1 if no clock runs.
+static long clock_arm(Room* r) {
+    if (!r || r->opts.tc == TC_NONE) return -1;
+    if (r->game.state != 0 || !r->p1 || !r->p2 || !r->game.current_turn) return -1;
+    if (r->clock_timer) return -1;  // already running
+
+    int slot = (r->game.current_turn == r->p1) ? 0 : 1;
+    long budget = r->clock_ms[slot];
+    if (budget < 0) budget = 0;
+
+    r->turn_started_ms = now_ms();
+    r->clock_seq++;
+    r->clock_timer = timer_arm(budget, on_flag_fall, r->id, r->clock_seq);
+    return budget;
+}
+
+void room_clock_start(Room* r) {
+    long budget = clock_arm(r);
+    if (budget < 0) return;
+
+    const char* mover = r->game.current_turn->name;
+    sendp(r->p1->fd, "CLOCK|%s|%ld", mover, budget);
+    sendp(r->p2->fd, "CLOCK|%s|%ld", mover, budget);
+    fanout_room(r, "CLOCK|%s|%ld", mover, budget);
+}
+
+void room_clock_stop(Room* r, int add_increment) {
+    if (!r || !r->clock_timer) return;
+
+    timer_cancel(r->clock_timer);
+    r->clock_timer = 0;
+    r->clock_seq++;
+
+    // A pause (disconnect) keeps what is left of the turn, so leaving
+    // and coming back does not buy time; a completed move refills a
+    // per-move clock for the player's next turn.
+    if (r->game.current_turn) {
+        int slot = (r->game.current_turn == r->p1) ? 0 : 1;
+        long elapsed = (long)(now_ms() - r->turn_started_ms);
+        r->clock_ms[slot] -= (int)elapsed;
+        if (r->clock_ms[slot] < 0) r->clock_ms[slot] = 0;
+        if (add_increment) {
+            if (r->opts.tc == TC_PER_MOVE) r->clock_ms[slot] = r->opts.move_ms;
+            else                           r->clock_ms[slot] += r->opts.inc_ms;
+        }
+    }
+}
+
+// Timer thread: the player on turn ran out of time. The win is
+// awarded the same way as the disconnect timeout in
+// rooms_prune_disconnected() (INFO + WIN|You), the loser sees LOSE.
+static void on_flag_fall(long room_id, long seq) {
+    pthread_mutex_lock(&g_rooms_mtx);
+    Room* r = room_find_by_id((int)room_id);
+    if (!r || r->clock_seq != seq || r->game.state != 0 ||
+        !r->p1 || !r->p2 || !r->game.current_turn) {
+        pthread_mutex_unlock(&g_rooms_mtx);
+        return;
+    }
+
+    struct Client* loser = r->game.current_turn;
+    struct Client* winner = (loser == r->p1) ? r->p2 : r->p1;
+    r->clock_timer = 0;
+    r->clock_seq++;
+    r->clock_ms[loser == r->p1 ? 0 : 1] = 0;
+
+    r->game.state = 1;
+    r->game.current_turn = winner;      // spectator snapshot reports the winner
+    r->replay_p1 = r->replay_p2 = 0;
+
+    sendp(winner->fd, "INFO|Opponent ran out of time");
+    sendp(winner->fd, "WIN|You");
+    sendp(loser->fd, "INFO|Your time ran out");
+    sendp(loser->fd, "LOSE|%s", winner->name);
+    fanout_room(r, "RESULT|WIN|%s", winner->name);
+    mm_rate_result(winner, loser, 1);
+    server_log("Room %s: %s flagged, win to %s", r->name, loser->name, winner->name);
+    room_game_over(r, winner);
+    pthread_mutex_unlock(&g_rooms_mtx);
+}
+
+
+// Expects g_rooms_mtx held; 0 if the audience cannot grow
+int room_spectator_add(Room* r, struct Client* c) {
+    if (!audience_add(&r->audience, c)) return 0;
+    c->spectate_room_id = r->id;
+    return 1;
+}
+
+
+// ============================================================
+//  room_spectate()
+//  ------------------------------------------------------------
+//  Adds a client to the room's audience. The snapshot is built
+//  and queued on the room's fan-out worker under the lock, so it
+//  arrives in one piece and before any later event of the room.
+// ============================================================
+Room* room_spectate(int room_id, struct Client* c) {
+    if (c->current_room != NULL || c->spectate_room_id >= 0) {
+        sendp(c->fd, "ERROR|Already in a room. Leave first.");
+        return NULL;
+    }
+
+    pthread_mutex_lock(&g_rooms_mtx);
+    Room* r = room_find_by_id(room_id);
+    if (!r || r->state == ROOM_EMPTY || r->opts.is_private) {
+        pthread_mutex_unlock(&g_rooms_mtx);
+        sendp(c->fd, "ERROR|No such room");
+        return NULL;
+    }
+
+    // === SNAPSHOT: header, board, result, chat history ===
+    MsgBuf mb;
+    msgbuf_init(&mb);
+    msgbuf_add(&mb, "SPECTATING|%d|%s|%s|%s", r->id, r->name, r->p1_name, r->p2_name);
+    for (int y = 0; y < SIZE; ++y) {
+        for (int x = 0; x < SIZE; ++x) {
+            char ch = r->game.board[y][x];
+            if (ch == 'X' || ch == 'O') {
+                const char* mover = (ch == 'X') ? r->p1_name : r->p2_name;
+                msgbuf_add(&mb, "MOVE|%s|%d|%d", mover, x, y);
+            }
+        }
+    }
+    if (r->game.state == 1 && r->game.current_turn)
+        msgbuf_add(&mb, "RESULT|WIN|%s", r->game.current_turn->name);
+    if (r->game.state == 2) msgbuf_add(&mb, "RESULT|DRAW");
+    MsgBuf history;
+    msgbuf_init(&history);
+    chat_history_append(r, &history);
+
+    if (!room_spectator_add(r, c)) {
+        pthread_mutex_unlock(&g_rooms_mtx);
+        sendp(c->fd, "ERROR|Cannot spectate");
+        return NULL;
+    }
+    char snap[sizeof(mb.data) + sizeof(history.data)];
+    memcpy(snap, mb.data, mb.len);
+    memcpy(snap + mb.len, history.data, history.len);
+    fanout_snapshot(r, c, snap, mb.len + history.len);
+    server_log("Client %s spectating room %s (%d watching)", c->name, r->name, r->audience->n);
+    pthread_mutex_unlock(&g_rooms_mtx);
+    return r;
+}
+
+
+// ============================================================
+//  room_unspectate()
+//  ------------------------------------------------------------
+//  Removes the client from its room's audience. Events already
+//  queued keep the previous snapshot and may still reach it.
+// ============================================================
+void room_unspectate(struct Client* c) {
+    if (!c || c->spectate_room_id < 0) return;
+
+    pthread_mutex_lock(&g_rooms_mtx);
+    Room* r = room_find_by_id(c->spectate_room_id);
+    if (r) audience_remove(&r->audience, c);
+    c->spectate_room_id = -1;
+    pthread_mutex_unlock(&g_rooms_mtx);
+}
+
+
+// ============================================================
+//  room_chat()
+//  ------------------------------------------------------------
+//  Records the line in the history ring, sends it to the players
+//  and leaves the audience to the fan-out workers.
+// ============================================================
+int room_chat(struct Client* c, const char* text) {
+    pthread_mutex_lock(&g_rooms_mtx);
+    Room* r = c->current_room;
+    if (!r && c->spectate_room_id >= 0) r = room_find_by_id(c->spectate_room_id);
+    if (!r) {
+        pthread_mutex_unlock(&g_rooms_mtx);
+        return 0;
+    }
+
+    ChatLine* l;
+    if (r->chat_count < CHAT_HISTORY_LEN) {
+        l = &r->chat[r->chat_count++];
+    } else {
+        l = &r->chat[r->chat_head];
+        r->chat_head = (r->chat_head + 1) % CHAT_HISTORY_LEN;
+    }
+    snprintf(l->from, sizeof(l->from), "%s", c->name);
+    snprintf(l->text, sizeof(l->text), "%s", text);
+
+    if (r->p1) sendp(r->p1->fd, "CHAT|ROOM|%s|%s", c->name, text);
+    if (r->p2) sendp(r->p2->fd, "CHAT|ROOM|%s|%s", c->name, text);
+    fanout_room(r, "CHAT|ROOM|%s|%s", c->name, text);
+    pthread_mutex_unlock(&g_rooms_mtx);
+    return 1;
+}
+
+
+// ============================================================
+//  room_member_audience()
+//  ------------------------------------------------------------
+//  Seated (human) players and the audience, each one held.
+// ============================================================
+struct Audience* room_member_audience(int room_id) {
+    Audience* out = NULL;
+    pthread_mutex_lock(&g_rooms_mtx);
+    Room* r = room_find_by_id(room_id);
+    if (r) {
+        const Audience* a = r->audience;
+        out = audience_alloc((a ? a->n : 0) + 2);
+        if (out) {
+            if (r->p1 && !r->p1->is_bot) audience_push(out, r->p1);
+            if (r->p2 && !r->p2->is_bot) audience_push(out, r->p2);
+            for (int i = 0; a && i < a->n; i++) audience_push(out, a->members[i]);
+        }
+    }
+    pthread_mutex_unlock(&g_rooms_mtx);
+    if (out && out->n == 0) {
+        audience_release(out);
+        out = NULL;
+    }
+    return out;
+}
+
+
 // ============================================================
 //  Remove long-disconnected players after grace period
 // ============================================================
@@ -494,7 +1429,7 @@ void rooms_prune_disconnected(int grace_seconds) {
 
     pthread_mutex_lock(&g_rooms_mtx);
     for (int i = 0; i < g_room_count; /* increment inside */) {
-        Room* r = &g_rooms[i];
+        Room* r = g_rooms[i];
         bool removed = false;
 
         // Check player 1 slot
@@ -506,9 +1441,12 @@ void rooms_prune_disconnected(int grace_seconds) {
                 sendp(other->fd, "INFO|Opponent did not return in time");
                 sendp(other->fd, "WIN|You");
                 server_log("Room %s: %s timed out, win to %s", r->name, r->p1_name, other->name);
+                if (r->game.state == 0) room_game_over(r, other);
                 other->current_room = NULL;
                 other->state = CLIENT_STATE_LOBBY;
+                presence_set(other, PRES_LOBBY, -1);
                 r->p2 = NULL;
+                if (other->is_bot) bot_destroy(other);
             }
             r->state = ROOM_EMPTY;
             room_remove_if_empty_locked(r);
@@ -524,8 +1462,10 @@ void rooms_prune_disconnected(int grace_seconds) {
                 sendp(other->fd, "INFO|Opponent did not return in time");
                 sendp(other->fd, "WIN|You");
                 server_log("Room %s: %s timed out, win to %s", r->name, r->p2_name, other->name);
+                if (r->game.state == 0) room_game_over(r, other);
                 other->current_room = NULL;
                 other->state = CLIENT_STATE_LOBBY;
+                presence_set(other, PRES_LOBBY, -1);
                 r->p1 = NULL;
             }
             r->state = ROOM_EMPTY;
@@ -544,6 +1484,80 @@ void rooms_prune_disconnected(int grace_seconds) {
 }
 
 
+// ============================================================
+//  room_pool_resize()
+//  ------------------------------------------------------------
+//  Rooms live on the heap, g_rooms only holds the pointers, so
+//  the table can grow or shrink while rooms keep their address.
+//  It never shrinks below the rooms that exist right now.
+//  The Room structs come from a slab (PREALLOC_ROOMS).
+// ============================================================
+int room_pool_resize(int cap) {
+    pthread_mutex_lock(&g_rooms_mtx);
+    if (cap < g_room_count) cap = g_room_count;
+    if (cap != g_room_cap) {
+        Room** t = realloc(g_rooms, (size_t)(cap > 0 ? cap : 1) * sizeof(Room*));
+        if (!t) {
+            pthread_mutex_unlock(&g_rooms_mtx);
+            return g_room_cap;
+        }
+        g_rooms = t;
+        g_room_cap = cap;
+    }
+    pthread_mutex_unlock(&g_rooms_mtx);
+    return cap;
+}
+
+Room* room_alloc(void) {
+    return slab_alloc(&g_room_slab);
+}
+
+size_t room_prealloc(int n) {
+    return slab_fill(&g_room_slab, n);
+}
+
+
+// ============================================================
+//  Live upgrade support (see upgrade.h)
+//  ------------------------------------------------------------
+//  Rooms arrive as plain data in the new process; timers do not
+//  survive exec, so everything that was armed is armed again.
+// ============================================================
+int room_next_id(void) {
+    return g_next_room_id;
+}
+
+void room_set_next_id(int id) {
+    g_next_room_id = id;
+}
+
+void room_resume(Room* r, long clock_left_ms) {
+    // Running clock: continue with the time that was left
+    if (clock_left_ms >= 0 && r->opts.tc != TC_NONE && r->game.state == 0 &&
+        r->p1 && r->p2 && r->game.current_turn) {
+        int slot = (r->game.current_turn == r->p1) ? 0 : 1;
+        r->clock_ms[slot] = (int)clock_left_ms;
+        r->turn_started_ms = now_ms();
+        r->clock_seq++;
+        r->clock_timer = timer_arm(clock_left_ms, on_flag_fall, r->id, r->clock_seq);
+    }
+
+    // Series game decided, next round still pending
+    if (r->opts.series_len > 0 && !r->series_over && r->game.state != 0 && r->p1 && r->p2) {
+        series_stage(r);
+        r->series_seq++;
+        timer_arm(config_get()->series_pause_ms, on_series_next, r->id, r->series_seq);
+    }
+
+    if (r->p2 && r->p2->is_bot) {
+        if (r->game.state == 0) bot_on_turn(r);
+        else                    bot_game_over(r);
+    }
+    if (r->state == ROOM_WAITING && r->p1 && !r->p2 && !r->p2_disconnected)
+        room_fill_arm(r);
+}
+
+
 // ============================================================
 //  Internal helper: remove room if empty (expects lock held)
 // ============================================================
@@ -552,12 +1566,34 @@ static void room_remove_if_empty_locked(Room* r) {
 
     int idx = -1;
     for (int i = 0; i < g_room_count; i++) {
-        if (&g_rooms[i] == r) { idx = i; break; }
+        if (g_rooms[i] == r) { idx = i; break; }
     }
     if (idx != -1 && !r->p1 && !r->p2) {
+        // Every removal path ends here: an undecided tournament game
+        // is a double forfeit, so the round can still complete
+        if (r->opts.tourney_id && r->game.state == 0)
+            tourney_report_abandoned(r->opts.tourney_id, r->id);
+        timer_cancel(r->clock_timer);
+        r->clock_timer = 0;
+        timer_cancel(r->fill_timer);
+        r->fill_timer = 0;
+        invite_remove(r->invite_code);
+        shard_dir_remove(r->id);
+        feed_gone(r->id);
+
+        // Release the audience; they are told by the fan-out workers
+        if (r->audience) {
+            for (int i = 0; i < r->audience->n; i++)
+                r->audience->members[i]->spectate_room_id = -1;
+            fanout_room(r, "SPECTATE_END|%d", r->id);
+            audience_release(r->audience);
+            r->audience = NULL;
+        }
+
         for (int j = idx; j < g_room_count - 1; j++)
             g_rooms[j] = g_rooms[j + 1];
         g_room_count--;
+        slab_free(&g_room_slab, r);
     }
 }
 
@@ -0,0 +1,881 @@
+// ============================================================
+//  ROUTER MAIN MODULE
+//  ------------------------------------------------------------
+//  Front process for several game servers (backends) on the
+//  same host. Clients connect to the router and speak the
+//  ordinary protocol; every client is bound to one backend at
+//  a time over a local socket (AF_UNIX or loopback TCP).
+//
+//  Room directory: the router subscribes to the room feed of
+//  every backend (##ADMIN|<token>|FEED, see feed.h) and keeps
+//  a merged table. ##LIST| is answered from that table, so a
+//  listing never costs a backend round trip, and the table
+//  tells which backend owns a room ID, an invite code or a
+//  seat. Backends need distinct ROOM_ID_BASE values; reached
+//  over loopback TCP they also need RATE_IP=0, CONN_PER_IP=0 and
+//  CONN_PER_NET24=0, since every line comes from the router's
+//  address (AF_UNIX connections are never limited per address).
+//
+//  Placement, decided on the command that needs it while the
+//  player is not seated anywhere:
+//   - ##CREATE|             least-loaded backend (fewest rooms,
+//                           then fewest router connections)
+//   - ##JOINROOM| / ##SPECTATE| / ##JOINCODE| / ##RECONNECT|
+//                           backend owning the room / code / seat
+//   - ##QUEUE| / ##TOURNEY| first backend that is up, so all
+//                           queued players meet on one server
+//  Moving to another backend closes the old backend connection
+//  and replays ##JOIN| on the new one; the client only sees the
+//  new ##SESSION|.
+//
+//  Data path: client -> backend lines are parsed (they are few
+//  and short). Backend -> client bytes, which carry the game,
+//  chat and spectator traffic, go socket -> pipe -> socket with
+//  splice() and never enter user space. The router only reads
+//  that stream while it has to add a line of its own or drop
+//  the greeting of a new backend connection. The last byte of
+//  every spliced chunk is sent by hand, so the router always
+//  knows whether the client's stream is at a line boundary;
+//  its own lines are only inserted there.
+//
+//  Per backend (not shared through the router): lobby chat,
+//  presence / friends, quick match and tournaments.
+//
+//  Usage: ./router [router.config]
+// ============================================================
+
+#define _GNU_SOURCE  // splice()
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "utils.h"
+#include "log.h"
+
+#define ROUTER_MAX_BACKENDS 8
+#define ROUTER_MAX_ROOMS    4096    // Rooms tracked across all backends
+#define ROUTER_LINE         512     // Longest protocol line (as CLIENT_INBUF)
+#define ROUTER_PIPE_CHUNK   65536   // Bytes moved per splice()
+#define ROUTER_RETRY_MS     1000    // Feed reconnect interval
+#define ROUTER_STATS_EVERY  60      // Seconds between traffic log lines
+#define ROUTER_BACKOFF_MIN_MS 10    // First accept pause after a resource error
+#define ROUTER_BACKOFF_MAX_MS 1000  // Pauses double up to this
+
+
+// ------------------------------------------------------------
+//  Configuration (router.config, KEY=VALUE like server.config)
+// ------------------------------------------------------------
+typedef struct {
+    int  port;                  ///< Client port (default: 10000)
+    char bind_address[32];      ///< Client address (default: "0.0.0.0")
+    int  max_clients;           ///< Concurrent client connections (default: 1024)
+    char admin_token[64];       ///< ADMIN_TOKEN of the backends (needed for the feed)
+    char backends[ROUTER_MAX_BACKENDS][108];    ///< BACKEND=unix:/path or host:port
+    int  backend_count;
+} RouterConfig;
+
+static RouterConfig g_cfg;
+
+static int router_config_load(const char* filename, RouterConfig* cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->port = 10000;
+    strcpy(cfg->bind_address, "0.0.0.0");
+    cfg->max_clients = 1024;
+
+    FILE* f = fopen(filename, "r");
+    if (!f) return 0;
+
+    char line[256];
+    char addr[108];
+    while (fgets(line, sizeof(line), f)) {
+        (void)sscanf(line, "PORT=%d", &cfg->port);
+        (void)sscanf(line, "BIND_ADDRESS=%31s", cfg->bind_address);
+        (void)sscanf(line, "MAX_CLIENTS=%d", &cfg->max_clients);
+        (void)sscanf(line, "ADMIN_TOKEN=%63s", cfg->admin_token);
+        if (sscanf(line, "BACKEND=%107s", addr) == 1 && cfg->backend_count < ROUTER_MAX_BACKENDS)
+            snprintf(cfg->backends[cfg->backend_count++], sizeof(cfg->backends[0]), "%s", addr);
+    }
+    fclose(f);
+    return 1;
+}
+
+
+// ------------------------------------------------------------
+//  Backends and the merged room table
+// ------------------------------------------------------------
+typedef struct {
+    bool up;                    ///< Feed connected and subscribed
+    int  rooms;                 ///< Rooms it reported
+    int  clients;               ///< Router connections bound to it
+} Backend;
+
+typedef struct {
+    int  id;
+    int  backend;
+    bool waiting;
+    int  players;
+    bool is_private;
+    char code[8];
+    char p1[32];
+    char p2[32];
+    char name[32];
+} RouteRoom;
+
+static Backend   g_backends[ROUTER_MAX_BACKENDS];
+static RouteRoom g_routes[ROUTER_MAX_ROOMS];
+static int       g_route_count = 0;
+static pthread_mutex_t g_route_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+static atomic_int       g_client_count;
+static atomic_llong     g_bytes_spliced;
+static atomic_llong     g_bytes_copied;
+
+// Expects g_route_mtx held
+static RouteRoom* route_find(int id) {
+    for (int i = 0; i < g_route_count; i++)
+        if (g_routes[i].id == id) return &g_routes[i];
+    return NULL;
+}
+
+// Expects g_route_mtx held
+static void route_remove_at(int i) {
+    g_backends[g_routes[i].backend].rooms--;
+    g_routes[i] = g_routes[--g_route_count];
+}
+
+static void route_drop_backend(int b) {
+    pthread_mutex_lock(&g_route_mtx);
+    for (int i = g_route_count - 1; i >= 0; i--)
+        if (g_routes[i].backend == b) route_remove_at(i);
+    g_backends[b].up = false;
+    pthread_mutex_unlock(&g_route_mtx);
+}
+
+// FEED|ROOM|<id>|<state>|<players>|<private>|<code>|<p1>|<p2>|<name>
+// (rest starts after "FEED|ROOM|"; the name is last and may be anything)
+static void route_put(int b, char* rest) {
+    char* f[8];
+    for (int n = 0; n < 7; n++) {
+        char* bar = strchr(rest, '|');
+        if (!bar) return;
+        *bar = '\0';
+        f[n] = rest;
+        rest = bar + 1;
+    }
+    f[7] = rest;
+
+    pthread_mutex_lock(&g_route_mtx);
+    int id = atoi(f[0]);
+    RouteRoom* r = route_find(id);
+    if (r && r->backend != b) {
+        server_log("Room %d reported by backends %d and %d, check ROOM_ID_BASE", id, r->backend, b);
+        route_remove_at((int)(r - g_routes));
+        r = NULL;
+    }
+    if (!r) {
+        if (g_route_count >= ROUTER_MAX_ROOMS) {
+            pthread_mutex_unlock(&g_route_mtx);
+            return;
+        }
+        r = &g_routes[g_route_count++];
+        r->id = id;
+        r->backend = b;
+        g_backends[b].rooms++;
+    }
+    r->waiting = strcmp(f[1], "WAITING") == 0;
+    r->players = atoi(f[2]);
+    r->is_private = atoi(f[3]) != 0;
+    snprintf(r->code, sizeof(r->code), "%s", f[4]);
+    snprintf(r->p1, sizeof(r->p1), "%s", f[5]);
+    snprintf(r->p2, sizeof(r->p2), "%s", f[6]);
+    snprintf(r->name, sizeof(r->name), "%s", f[7]);
+    pthread_mutex_unlock(&g_route_mtx);
+}
+
+static void route_gone(int id) {
+    pthread_mutex_lock(&g_route_mtx);
+    RouteRoom* r = route_find(id);
+    if (r) route_remove_at((int)(r - g_routes));
+    pthread_mutex_unlock(&g_route_mtx);
+}
+
+// Owner of a room ID, an invite code or a seat (-1 if unknown)
+static int owner_of_room(int id) {
+    pthread_mutex_lock(&g_route_mtx);
+    RouteRoom* r = route_find(id);
+    int b = r ? r->backend : -1;
+    pthread_mutex_unlock(&g_route_mtx);
+    return b;
+}
+
+static int owner_of_code(const char* code) {
+    int b = -1;
+    pthread_mutex_lock(&g_route_mtx);
+    for (int i = 0; i < g_route_count && b < 0; i++)
+        if (g_routes[i].code[0] && strcasecmp(g_routes[i].code, code) == 0) b = g_routes[i].backend;
+    pthread_mutex_unlock(&g_route_mtx);
+    return b;
+}
+
+static int owner_of_player(const char* name) {
+    int b = -1;
+    if (!name[0]) return -1;
+    pthread_mutex_lock(&g_route_mtx);
+    for (int i = 0; i < g_route_count && b < 0; i++)
+        if (strcmp(g_routes[i].p1, name) == 0 || strcmp(g_routes[i].p2, name) == 0)
+            b = g_routes[i].backend;
+    pthread_mutex_unlock(&g_route_mtx);
+    return b;
+}
+
+static int least_loaded(void) {
+    int best = -1;
+    pthread_mutex_lock(&g_route_mtx);
+    for (int i = 0; i < g_cfg.backend_count; i++) {
+        const Backend* b = &g_backends[i];
+        if (!b->up) continue;
+        if (best < 0 || b->rooms < g_backends[best].rooms ||
+            (b->rooms == g_backends[best].rooms && b->clients < g_backends[best].clients))
+            best = i;
+    }
+    pthread_mutex_unlock(&g_route_mtx);
+    return best;
+}
+
+static int first_up(void) {
+    int best = -1;
+    pthread_mutex_lock(&g_route_mtx);
+    for (int i = 0; i < g_cfg.backend_count && best < 0; i++)
+        if (g_backends[i].up) best = i;
+    pthread_mutex_unlock(&g_route_mtx);
+    return best;
+}
+
+// ROOMS|<n>|<id>|<name>|<state>|<players>/2... like rooms_list_send()
+static size_t rooms_reply(char* out, size_t cap) {
+    char entries[1024];
+    size_t off = 0;
+    int listed = 0;
+    entries[0] = '\0';
+
+    pthread_mutex_lock(&g_route_mtx);
+    for (int i = 0; i < g_route_count; i++) {
+        const RouteRoom* r = &g_routes[i];
+        if (r->is_private) continue;
+        int w = snprintf(entries + off, sizeof(entries) - off, "|%d|%s|%s|%d/2",
+                         r->id, r->name, r->waiting ? "WAITING" : "PLAYING", r->players);
+        if (w < 0 || (size_t)w >= sizeof(entries) - off) {
+            entries[off] = '\0';
+            break;
+        }
+        off += (size_t)w;
+        listed++;
+    }
+    pthread_mutex_unlock(&g_route_mtx);
+    int n = snprintf(out, cap, "##ROOMS|%d%s\n", listed, entries);
+    return (n < 0) ? 0 : ((size_t)n < cap ? (size_t)n : cap - 1);
+}
+
+
+// ------------------------------------------------------------
+//  Socket helpers
+// ------------------------------------------------------------
+static int send_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        data += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+// "unix:/path" or "host:port"
+static int backend_connect(const char* addr) {
+    if (strncmp(addr, "unix:", 5) == 0) {
+        struct sockaddr_un sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sun_family = AF_UNIX;
+        snprintf(sa.sun_path, sizeof(sa.sun_path), "%s", addr + 5);
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        if (connect(fd, (struct sockaddr*)&sa, sizeof(sa)) < 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    char host[64];
+    int port = 0;
+    const char* colon = strrchr(addr, ':');
+    if (!colon || (size_t)(colon - addr) >= sizeof(host)) return -1;
+    memcpy(host, addr, (size_t)(colon - addr));
+    host[colon - addr] = '\0';
+    port = atoi(colon + 1);
+
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, host, &sa.sin_addr) != 1) return -1;
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr*)&sa, sizeof(sa)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Buffered line reader for the parsed directions
+typedef struct {
+    char   buf[ROUTER_LINE * 4];
+    size_t len;
+} LineBuf;
+
+// Returns bytes read, 0 on EOF, -1 on error (EINTR / EAGAIN give 1)
+static ssize_t lb_fill(int fd, LineBuf* lb) {
+    if (lb->len == sizeof(lb->buf)) lb->len = 0;     // line too long: drop it
+    ssize_t n = recv(fd, lb->buf + lb->len, sizeof(lb->buf) - lb->len, 0);
+    if (n < 0 && (errno == EINTR || errno == EAGAIN)) return 1;
+    if (n > 0) lb->len += (size_t)n;
+    return n;
+}
+
+// Pops the next complete line including '\n'; returns its length or 0.
+// Lines that do not fit in out are skipped: the server would refuse
+// them, and a truncated one would lose its '\n'.
+static size_t lb_pop(LineBuf* lb, char* out, size_t cap) {
+    char* nl;
+    while ((nl = memchr(lb->buf, '\n', lb->len)) != NULL) {
+        size_t n = (size_t)(nl - lb->buf) + 1;
+        bool fits = n < cap;
+        if (fits) {
+            memcpy(out, lb->buf, n);
+            out[n] = '\0';
+        }
+        memmove(lb->buf, lb->buf + n, lb->len - n);
+        lb->len -= n;
+        if (fits) return n;
+    }
+    return 0;
+}
+
+
+// ============================================================
+//  feed_thread()
+//  ------------------------------------------------------------
+//  One per backend: keeps the room table of that backend in
+//  sync and reconnects when the backend goes away.
+// ============================================================
+static void* feed_thread(void* arg) {
+    int b = (int)(intptr_t)arg;
+    const char* addr = g_cfg.backends[b];
+    bool warned = false;
+    LineBuf* lb = malloc(sizeof(LineBuf));
+    if (!lb) return NULL;
+
+    while (1) {
+        int fd = backend_connect(addr);
+        if (fd < 0) {
+            if (!warned) server_log("Backend %d (%s) unreachable, retrying", b, addr);
+            warned = true;
+            usleep(ROUTER_RETRY_MS * 1000);
+            continue;
+        }
+        warned = false;
+
+        char req[128];
+        int n = snprintf(req, sizeof(req), "##ADMIN|%s|FEED\n", g_cfg.admin_token);
+        send_all(fd, req, (size_t)n);
+        lb->len = 0;
+
+        char line[ROUTER_LINE];
+        while (lb_fill(fd, lb) > 0) {
+            while (lb_pop(lb, line, sizeof(line)) > 0) {
+                trim_newline(line);
+                if (strncmp(line, "##FEED|ROOM|", 12) == 0) {
+                    route_put(b, line + 12);
+                } else if (strncmp(line, "##FEED|GONE|", 12) == 0) {
+                    route_gone(atoi(line + 12));
+                } else if (strcmp(line, "##ADMIN_OK|FEED") == 0) {
+                    pthread_mutex_lock(&g_route_mtx);
+                    g_backends[b].up = true;
+                    int rooms = g_backends[b].rooms;
+                    pthread_mutex_unlock(&g_route_mtx);
+                    server_log("Backend %d (%s) up, %d rooms", b, addr, rooms);
+                } else if (strcmp(line, "##PING|") == 0) {
+                    send_all(fd, "##PONG|\n", 8);
+                } else if (strncmp(line, "##ERROR|", 8) == 0) {
+                    server_log("Backend %d refused the feed: %s", b, line + 8);
+                }
+            }
+        }
+
+        close(fd);
+        route_drop_backend(b);
+        server_log("Backend %d (%s) down", b, addr);
+        usleep(ROUTER_RETRY_MS * 1000);
+    }
+    return NULL;
+}
+
+
+// ============================================================
+//  Client sessions
+// ============================================================
+typedef struct {
+    int  cfd;                   // Client socket
+    int  bfd;                   // Backend socket, -1 = not bound yet
+    int  backend;
+    int  pipefd[2];             // splice() buffer (backend -> client)
+    bool splice_ok;             // False once splice() was refused
+
+    char name[32];              // From ##JOIN|
+    char join_line[96];         // Replayed on a new backend connection
+
+    // Backend -> client in line mode (instead of splicing)
+    bool line_mode;
+    bool at_nl;                 // Last byte sent to the client was '\n'
+    bool expect_hello;          // Drop the greeting of a new backend connection
+    bool expect_joined;         // Waiting for the answer to a ##JOIN|
+    bool joined_sent;           // Client has its JOINED|; drop replayed ones
+    char pending[2048];         // Router lines waiting for a boundary
+    size_t pend_len;
+
+    LineBuf from_client;
+    LineBuf from_backend;
+} Session;
+
+// Every byte for the client goes through here (or through the
+// splice path, which keeps at_nl itself)
+static int client_send(Session* s, const char* data, size_t len) {
+    if (len == 0) return 1;
+    s->at_nl = (data[len - 1] == '\n');
+    return send_all(s->cfd, data, len);
+}
+
+// Switches backend -> client forwarding to line mode. Splicing may
+// have stopped inside a line: its rest is forwarded as is, and our
+// own lines wait until at_nl says the client is at a boundary.
+static void session_lines(Session* s) {
+    s->line_mode = true;
+}
+
+// Queues a line of our own for the client. Unbound clients get it
+// at once; otherwise it waits for a boundary of the backend stream.
+static void session_say(Session* s, const char* data, size_t len) {
+    if (s->bfd < 0) {
+        client_send(s, data, len);
+        return;
+    }
+    if (s->pend_len + len > sizeof(s->pending)) return;
+    memcpy(s->pending + s->pend_len, data, len);
+    s->pend_len += len;
+    session_lines(s);
+}
+
+static void session_unbind(Session* s) {
+    if (s->bfd < 0) return;
+    close(s->bfd);
+    s->bfd = -1;
+    pthread_mutex_lock(&g_route_mtx);
+    g_backends[s->backend].clients--;
+    pthread_mutex_unlock(&g_route_mtx);
+    s->backend = -1;
+}
+
+// Connects the client to backend b and replays its ##JOIN|
+static int session_bind(Session* s, int b) {
+    int fd = (b >= 0) ? backend_connect(g_cfg.backends[b]) : -1;
+    if (fd < 0) {
+        // A bound client simply stays where it is
+        if (s->bfd < 0) session_say(s, "##ERROR|Server unavailable\n", 27);
+        return 0;
+    }
+    session_unbind(s);
+    // The old stream may have been cut inside a line; end it, or the
+    // new backend's first line would be glued to it
+    if (!s->at_nl) client_send(s, "\n", 1);
+
+    s->bfd = fd;
+    s->backend = b;
+    pthread_mutex_lock(&g_route_mtx);
+    g_backends[b].clients++;
+    pthread_mutex_unlock(&g_route_mtx);
+
+    s->from_backend.len = 0;
+    s->line_mode = true;
+    s->expect_hello = true;
+    s->expect_joined = false;
+    if (s->join_line[0]) {
+        send_all(fd, s->join_line, strlen(s->join_line));
+        s->expect_joined = true;
+    }
+    return 1;
+}
+
+// Moves an unseated client to backend b if it is not there yet
+static void session_route(Session* s, int b) {
+    if (b < 0 || b == s->backend) return;
+    if (s->bfd >= 0 && owner_of_player(s->name) == s->backend) return;    // seated: stay
+    session_bind(s, b);
+}
+
+static void client_line(Session* s, const char* line, size_t len) {
+    if (strncmp(line, "##LIST|", 7) == 0) {
+        char reply[1200];
+        size_t n = rooms_reply(reply, sizeof(reply));
+        session_say(s, reply, n);
+        return;
+    }
+
+    if (strncmp(line, "##JOIN|", 7) == 0 && !s->name[0]) {
+        // Bind before remembering the line, so it is not replayed as well
+        if (s->bfd < 0 && !session_bind(s, least_loaded())) return;
+        snprintf(s->name, sizeof(s->name), "%.*s", (int)strcspn(line + 7, "|\r\n"), line + 7);
+        snprintf(s->join_line, sizeof(s->join_line), "##JOIN|%s\n", s->name);
+        s->expect_joined = true;
+        session_lines(s);
+    } else if (strncmp(line, "##CREATE|", 9) == 0) {
+        session_route(s, least_loaded());
+    } else if (strncmp(line, "##JOINROOM|", 11) == 0) {
+        session_route(s, owner_of_room(atoi(line + 11)));
+    } else if (strncmp(line, "##SPECTATE|", 11) == 0) {
+        session_route(s, owner_of_room(atoi(line + 11)));
+    } else if (strncmp(line, "##JOINCODE|", 11) == 0) {
+        char code[16];
+        snprintf(code, sizeof(code), "%.*s", (int)strcspn(line + 11, "|\r\n"), line + 11);
+        session_route(s, owner_of_code(code));
+    } else if (strncmp(line, "##RECONNECT|", 12) == 0) {
+        char who[32];
+        snprintf(who, sizeof(who), "%.*s", (int)strcspn(line + 12, "|\r\n"), line + 12);
+        if (!s->name[0]) snprintf(s->name, sizeof(s->name), "%s", who);
+        session_route(s, owner_of_player(who));
+    } else if (strncmp(line, "##QUEUE|", 8) == 0 || strncmp(line, "##TOURNEY|", 10) == 0) {
+        session_route(s, first_up());
+    }
+
+    if (s->bfd < 0 && !session_bind(s, least_loaded())) return;
+    send_all(s->bfd, line, len);
+}
+
+// Line mode filter: 0 drops the greeting of a new backend
+// connection and replayed JOINED| answers
+static int backend_line_wanted(Session* s, const char* line) {
+    if (s->expect_hello && strncmp(line, "##HELLO|", 8) == 0) {
+        s->expect_hello = false;
+        return 0;
+    }
+    if (s->expect_joined && strncmp(line, "##JOINED|", 9) == 0) {
+        s->expect_joined = false;
+        if (s->joined_sent) return 0;
+        s->joined_sent = true;
+    }
+    if (strncmp(line, "##ERROR|", 8) == 0) s->expect_joined = false;
+    return 1;
+}
+
+// Line mode: forwards complete backend lines unchanged, whatever
+// their length. Returns 0 if the backend closed.
+static int backend_lines(Session* s) {
+    LineBuf* lb = &s->from_backend;
+    ssize_t n = lb_fill(s->bfd, lb);
+    if (n <= 0) return 0;
+
+    size_t off = 0;
+    char* nl;
+    while ((nl = memchr(lb->buf + off, '\n', lb->len - off)) != NULL) {
+        const char* line = lb->buf + off;
+        size_t len = (size_t)(nl - line) + 1;
+        off += len;
+        // The rest of a line already sent in part is not a line of its own
+        if (s->at_nl && !backend_line_wanted(s, line)) continue;
+        client_send(s, line, len);
+        atomic_fetch_add(&g_bytes_copied, (long long)len);
+    }
+    memmove(lb->buf, lb->buf + off, lb->len - off);
+    lb->len -= off;
+
+    // No '\n' in a full buffer: pass the line on in parts
+    if (lb->len == sizeof(lb->buf)) {
+        client_send(s, lb->buf, lb->len);
+        atomic_fetch_add(&g_bytes_copied, (long long)lb->len);
+        lb->len = 0;
+    }
+    return 1;
+}
+
+// Splice mode: backend socket -> pipe -> client socket.
+// Returns 0 if either side closed.
+static int backend_splice(Session* s) {
+    if (!s->splice_ok) {
+        char buf[4096];
+        ssize_t n = recv(s->bfd, buf, sizeof(buf), 0);
+        if (n < 0 && errno == EINTR) return 1;
+        if (n <= 0) return 0;
+        atomic_fetch_add(&g_bytes_copied, (long long)n);
+        return client_send(s, buf, (size_t)n);
+    }
+
+    ssize_t n = splice(s->bfd, NULL, s->pipefd[1], NULL, ROUTER_PIPE_CHUNK,
+                       SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (n < 0 && (errno == EINTR || errno == EAGAIN)) return 1;
+    if (n < 0 && errno == EINVAL) {
+        server_log("splice() not supported for this backend socket, copying");
+        s->splice_ok = false;
+        return 1;
+    }
+    if (n <= 0) return 0;
+
+    // All but the last byte go out zero-copy; that one is read, so
+    // at_nl tells whether the chunk ended on a line boundary
+    atomic_fetch_add(&g_bytes_spliced, (long long)n);
+    while (n > 1) {
+        ssize_t m = splice(s->pipefd[0], NULL, s->cfd, NULL, (size_t)n - 1,
+                           SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (m < 0 && errno == EINTR) continue;
+        if (m <= 0) return 0;
+        n -= m;
+    }
+    char last;
+    ssize_t m;
+    do {
+        m = read(s->pipefd[0], &last, 1);
+    } while (m < 0 && errno == EINTR);
+    return m == 1 && client_send(s, &last, 1);
+}
+
+// Flushes our own lines once the client's stream is at a boundary;
+// splicing resumes when nothing is left to filter or complete
+static void session_flush(Session* s) {
+    if (!s->line_mode || !s->at_nl) return;
+
+    if (s->pend_len > 0) {
+        client_send(s, s->pending, s->pend_len);
+        s->pend_len = 0;
+    }
+    if (!s->expect_hello && !s->expect_joined && s->from_backend.len == 0)
+        s->line_mode = false;
+}
+
+static void* session_thread(void* arg) {
+    Session* s = arg;
+    client_send(s, "##HELLO|\n", 9);
+
+    char line[ROUTER_LINE];
+    while (1) {
+        session_flush(s);
+
+        struct pollfd p[2] = {
+            { .fd = s->cfd, .events = POLLIN },
+            { .fd = s->bfd, .events = POLLIN },
+        };
+        int r = poll(p, s->bfd >= 0 ? 2 : 1, -1);
+        if (r < 0 && errno != EINTR) break;
+        if (r <= 0) continue;
+
+        if (s->bfd >= 0 && (p[1].revents & (POLLIN | POLLHUP | POLLERR))) {
+            int ok = s->line_mode ? backend_lines(s) : backend_splice(s);
+            if (!ok) break;     // backend gone (drained / crashed): client reconnects
+        }
+        if (p[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+            if (lb_fill(s->cfd, &s->from_client) <= 0) break;
+            size_t len;
+            while ((len = lb_pop(&s->from_client, line, sizeof(line))) > 0)
+                client_line(s, line, len);
+        }
+    }
+
+    session_unbind(s);
+    close(s->cfd);
+    close(s->pipefd[0]);
+    close(s->pipefd[1]);
+    free(s);
+    atomic_fetch_sub(&g_client_count, 1);
+    return NULL;
+}
+
+
+// ============================================================
+//  stats_thread()
+//  ------------------------------------------------------------
+//  Logs how much backend traffic went through splice() and how
+//  much had to be copied.
+// ============================================================
+static void* stats_thread(void* arg) {
+    (void)arg;
+    while (1) {
+        sleep(ROUTER_STATS_EVERY);
+        server_log("Traffic: %d clients, %lld bytes spliced, %lld bytes copied",
+                   atomic_load(&g_client_count), atomic_load(&g_bytes_spliced),
+                   atomic_load(&g_bytes_copied));
+    }
+    return NULL;
+}
+
+
+// ============================================================
+//  Accept errors
+//  ------------------------------------------------------------
+//  Same handling as the server's accept loop: out of descriptors,
+//  the reserve descriptor is released to accept and refuse the
+//  pending connection, which would otherwise keep the listener
+//  readable and the loop spinning. Other resource errors (and a
+//  lost reserve) pause accepting, doubling the pause up to
+//  ROUTER_BACKOFF_MAX_MS; any accepted connection resets it.
+// ============================================================
+static int  g_spare_fd = -1;
+static int  g_backoff_ms = 0;
+static bool g_fd_limited = false;
+
+static void spare_reserve(void) {
+    if (g_spare_fd < 0) g_spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+}
+
+static void accept_ok(void) {
+    g_backoff_ms = 0;
+    if (g_fd_limited) {
+        g_fd_limited = false;
+        server_log("Accepting again (descriptors available)");
+    }
+}
+
+static void accept_failed(int listen_fd, int err) {
+    if (err == EINTR || err == EAGAIN || err == ECONNABORTED) return;
+
+    if ((err == EMFILE || err == ENFILE) && g_spare_fd >= 0) {
+        if (!g_fd_limited) {
+            g_fd_limited = true;
+            server_log("Out of file descriptors: refusing new connections");
+        }
+        close(g_spare_fd);
+        g_spare_fd = -1;
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd >= 0) {
+            send_all(fd, "##ERROR|Server full\n", 20);
+            close(fd);
+        }
+        spare_reserve();
+        if (g_spare_fd >= 0) return;    // next pending connection, same way
+    } else {
+        server_log("accept: %s", strerror(err));
+    }
+
+    g_backoff_ms = g_backoff_ms ? g_backoff_ms * 2 : ROUTER_BACKOFF_MIN_MS;
+    if (g_backoff_ms > ROUTER_BACKOFF_MAX_MS) g_backoff_ms = ROUTER_BACKOFF_MAX_MS;
+    poll(NULL, 0, g_backoff_ms);
+}
+
+
+// ============================================================
+//  main()
+// ============================================================
+int main(int argc, char** argv) {
+    const char* path = (argc >= 2) ? argv[1] : "router.config";
+    router_config_load(path, &g_cfg);
+    if (g_cfg.backend_count == 0) {
+        fprintf(stderr, "No BACKEND= in %s\n", path);
+        return 1;
+    }
+    if (g_cfg.max_clients <= 0) g_cfg.max_clients = 1024;
+    signal(SIGPIPE, SIG_IGN);
+
+    log_init("router.log");
+    server_log("Router start, bind=%s port=%d, %d backends",
+               g_cfg.bind_address, g_cfg.port, g_cfg.backend_count);
+
+    for (int i = 0; i < g_cfg.backend_count; i++) {
+        pthread_t th;
+        pthread_create(&th, NULL, feed_thread, (void*)(intptr_t)i);
+        pthread_detach(th);
+    }
+    pthread_t st;
+    pthread_create(&st, NULL, stats_thread, NULL);
+    pthread_detach(st);
+
+    int server_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (server_fd < 0) {
+        perror("socket");
+        return 1;
+    }
+    int opt = 1;
+    setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)g_cfg.port);
+    if (inet_pton(AF_INET, g_cfg.bind_address, &addr.sin_addr) != 1)
+        addr.sin_addr.s_addr = INADDR_ANY;
+    if (bind(server_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(server_fd, 128) < 0) {
+        perror("bind/listen");
+        close(server_fd);
+        return 1;
+    }
+
+    printf("=====================================\n");
+    printf("  Tic-Tac-Toe Router is running\n");
+    printf("  Listening on %s:%d, %d backends\n", g_cfg.bind_address, g_cfg.port, g_cfg.backend_count);
+    printf("=====================================\n\n");
+
+    spare_reserve();
+    while (1) {
+        int cfd = accept4(server_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (cfd < 0) {
+            accept_failed(server_fd, errno);
+            continue;
+        }
+        accept_ok();
+        if (atomic_fetch_add(&g_client_count, 1) >= g_cfg.max_clients) {
+            atomic_fetch_sub(&g_client_count, 1);
+            send_all(cfd, "##ERROR|Server full\n", 20);
+            close(cfd);
+            continue;
+        }
+
+        Session* s = calloc(1, sizeof(Session));
+        if (!s || pipe2(s->pipefd, O_CLOEXEC) < 0) {
+            free(s);
+            atomic_fetch_sub(&g_client_count, 1);
+            send_all(cfd, "##ERROR|Server full\n", 20);
+            close(cfd);
+            continue;
+        }
+        s->cfd = cfd;
+        s->bfd = -1;
+        s->backend = -1;
+        s->splice_ok = true;
+        s->at_nl = true;
+
+        pthread_t th;
+        if (pthread_create(&th, NULL, session_thread, s) != 0) {
+            perror("pthread_create");
+            close(s->pipefd[0]);
+            close(s->pipefd[1]);
+            free(s);
+            atomic_fetch_sub(&g_client_count, 1);
+            close(cfd);
+            continue;
+        }
+        pthread_detach(th);
+    }
+    return 0;
+}
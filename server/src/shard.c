@@ -0,0 +1,554 @@
+// ============================================================
+//  SHARD MODULE IMPLEMENTATION
+//  ------------------------------------------------------------
+//  Directory: open-addressing table keyed by room ID in an
+//  anonymous MAP_SHARED mapping created before fork(). It is
+//  guarded by a process-shared robust mutex, so a worker that
+//  dies while holding it cannot wedge the others. Two more
+//  open-addressing tables in the same mapping index the rooms
+//  by invite code and by player name; they hold only the key's
+//  hash and the room ID, and a hit is checked against the room.
+//
+//  Handoff: worker i owns the receiving end of datagram socket
+//  pair i; everybody else writes to the sending end. Each
+//  datagram carries one client fd (SCM_RIGHTS) and a HandoffMsg.
+// ============================================================
+
+#define _GNU_SOURCE  // MAP_ANONYMOUS, robust mutexes, SCM_RIGHTS
+
+#include "shard.h"
+#include "client.h"
+#include "matchmaking.h"
+#include "stats.h"
+#include "log.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+typedef enum { SLOT_FREE = 0, SLOT_USED = 1, SLOT_DELETED = 2 } SlotState;
+
+typedef struct {
+    int state;
+    ShardRoom room;
+} DirSlot;
+
+typedef struct {
+    int state;
+    unsigned hash;                  // Hash of the key (code or player name)
+    int room_id;
+} IdxSlot;
+
+#define IDX_CODE_CAP    SHARD_DIR_CAP       // At most one code per room
+#define IDX_PLAYER_CAP  (SHARD_DIR_CAP * 2) // Two seats per room
+
+typedef struct {
+    pthread_mutex_t mtx;            // PTHREAD_PROCESS_SHARED + ROBUST
+    atomic_int next_room_id;
+    int used;                       // USED + DELETED slots
+    ShardLoad load[SHARD_MAX_WORKERS];
+    DirSlot slots[SHARD_DIR_CAP];
+    int code_used, player_used;     // USED + DELETED index slots
+    IdxSlot by_code[IDX_CODE_CAP];
+    IdxSlot by_player[IDX_PLAYER_CAP];
+} ShardDir;
+
+typedef struct {
+    char name[32];
+    char session[32];
+    int  rating;
+    char line[256];
+} HandoffMsg;
+
+static ShardDir* g_dir = NULL;
+static int g_links[SHARD_MAX_WORKERS][2];   // [i][0] = worker i reads, [i][1] = others write
+static int g_worker_count = 0;
+static int g_self = -1;
+
+
+// ============================================================
+//  Directory helpers
+// ============================================================
+
+static void dir_lock(void) {
+    if (pthread_mutex_lock(&g_dir->mtx) == EOWNERDEAD)
+        pthread_mutex_consistent(&g_dir->mtx);
+}
+
+static void dir_unlock(void) {
+    pthread_mutex_unlock(&g_dir->mtx);
+}
+
+static unsigned slot_of(int room_id) {
+    return ((unsigned)room_id * 2654435761u) & (SHARD_DIR_CAP - 1);
+}
+
+// Expects the directory lock held
+static DirSlot* dir_find(int room_id) {
+    for (unsigned i = slot_of(room_id), n = 0; n < SHARD_DIR_CAP;
+         i = (i + 1) & (SHARD_DIR_CAP - 1), n++) {
+        DirSlot* s = &g_dir->slots[i];
+        if (s->state == SLOT_FREE) return NULL;
+        if (s->state == SLOT_USED && s->room.room_id == room_id) return s;
+    }
+    return NULL;
+}
+
+// Drops all tombstones (expects the directory lock held)
+static void dir_rehash(void) {
+    DirSlot* copy = malloc(sizeof(g_dir->slots));
+    if (!copy) return;
+    memcpy(copy, g_dir->slots, sizeof(g_dir->slots));
+    memset(g_dir->slots, 0, sizeof(g_dir->slots));
+    g_dir->used = 0;
+
+    for (int k = 0; k < SHARD_DIR_CAP; k++) {
+        if (copy[k].state != SLOT_USED) continue;
+        unsigned i = slot_of(copy[k].room.room_id);
+        while (g_dir->slots[i].state != SLOT_FREE) i = (i + 1) & (SHARD_DIR_CAP - 1);
+        g_dir->slots[i] = copy[k];
+        g_dir->used++;
+    }
+    free(copy);
+}
+
+
+// ------------------------------------------------------------
+//  Secondary indexes (expect the directory lock held)
+// ------------------------------------------------------------
+
+// FNV-1a; codes are matched case-insensitively, so they are folded
+static unsigned key_hash(const char* s, bool fold) {
+    unsigned h = 2166136261u;
+    for (; *s; s++) {
+        unsigned char ch = (unsigned char)*s;
+        if (fold && ch >= 'A' && ch <= 'Z') ch = (unsigned char)(ch - 'A' + 'a');
+        h ^= ch;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Drops all tombstones of an index
+static void idx_rehash(IdxSlot* t, unsigned cap, int* used) {
+    IdxSlot* copy = malloc(cap * sizeof(IdxSlot));
+    if (!copy) return;
+    memcpy(copy, t, cap * sizeof(IdxSlot));
+    memset(t, 0, cap * sizeof(IdxSlot));
+    *used = 0;
+
+    for (unsigned k = 0; k < cap; k++) {
+        if (copy[k].state != SLOT_USED) continue;
+        unsigned i = copy[k].hash & (cap - 1);
+        while (t[i].state != SLOT_FREE) i = (i + 1) & (cap - 1);
+        t[i] = copy[k];
+        (*used)++;
+    }
+    free(copy);
+}
+
+static void idx_insert(IdxSlot* t, unsigned cap, int* used, unsigned h, int room_id) {
+    if (*used >= (int)(cap * 3 / 4)) idx_rehash(t, cap, used);
+    unsigned i = h & (cap - 1);
+    while (t[i].state == SLOT_USED) i = (i + 1) & (cap - 1);
+    if (*used >= (int)cap - 1 && t[i].state == SLOT_FREE) return;    // full
+    if (t[i].state == SLOT_FREE) (*used)++;
+    t[i].state = SLOT_USED;
+    t[i].hash = h;
+    t[i].room_id = room_id;
+}
+
+static void idx_erase(IdxSlot* t, unsigned cap, unsigned h, int room_id) {
+    for (unsigned i = h & (cap - 1), n = 0; n < cap; i = (i + 1) & (cap - 1), n++) {
+        if (t[i].state == SLOT_FREE) return;
+        if (t[i].state == SLOT_USED && t[i].hash == h && t[i].room_id == room_id) {
+            t[i].state = SLOT_DELETED;
+            return;
+        }
+    }
+}
+
+// Adds (or drops) the index entries of a directory entry
+static void index_room(const ShardRoom* r, bool add) {
+    if (r->is_private && r->code[0]) {
+        unsigned h = key_hash(r->code, true);
+        if (add) idx_insert(g_dir->by_code, IDX_CODE_CAP, &g_dir->code_used, h, r->room_id);
+        else     idx_erase(g_dir->by_code, IDX_CODE_CAP, h, r->room_id);
+    }
+    const char* seats[2] = { r->p1, r->p2 };
+    for (int k = 0; k < 2; k++) {
+        if (!seats[k][0]) continue;
+        unsigned h = key_hash(seats[k], false);
+        if (add) idx_insert(g_dir->by_player, IDX_PLAYER_CAP, &g_dir->player_used, h, r->room_id);
+        else     idx_erase(g_dir->by_player, IDX_PLAYER_CAP, h, r->room_id);
+    }
+}
+
+
+// ============================================================
+//  Directory API
+// ============================================================
+
+bool shard_enabled(void) { return g_self >= 0; }
+int  shard_self(void)    { return g_self; }
+
+int shard_next_room_id(void) {
+    if (!shard_enabled()) return -1;
+    return atomic_fetch_add(&g_dir->next_room_id, 1);
+}
+
+void shard_dir_put(const ShardRoom* e) {
+    if (!shard_enabled()) return;
+    dir_lock();
+    DirSlot* s = dir_find(e->room_id);
+    if (!s) {
+        if (g_dir->used >= SHARD_DIR_CAP * 3 / 4) dir_rehash();
+        unsigned i = slot_of(e->room_id);
+        while (g_dir->slots[i].state == SLOT_USED) i = (i + 1) & (SHARD_DIR_CAP - 1);
+        s = &g_dir->slots[i];
+        if (g_dir->used >= SHARD_DIR_CAP - 1 && s->state == SLOT_FREE) {
+            dir_unlock();
+            server_log("Shard directory full, room %d not published", e->room_id);
+            return;
+        }
+        if (s->state == SLOT_FREE) g_dir->used++;
+        s->state = SLOT_USED;
+    } else {
+        index_room(&s->room, false);
+    }
+    s->room = *e;
+    s->room.owner = g_self;
+    index_room(&s->room, true);
+    dir_unlock();
+}
+
+void shard_dir_remove(int room_id) {
+    if (!shard_enabled()) return;
+    dir_lock();
+    DirSlot* s = dir_find(room_id);
+    if (s) {
+        index_room(&s->room, false);
+        s->state = SLOT_DELETED;
+    }
+    dir_unlock();
+}
+
+int shard_owner_of_room(int room_id) {
+    if (!shard_enabled()) return -1;
+    dir_lock();
+    DirSlot* s = dir_find(room_id);
+    int owner = s ? s->room.owner : -1;
+    dir_unlock();
+    return owner;
+}
+
+int shard_owner_of_code(const char* code) {
+    if (!shard_enabled() || !code[0]) return -1;
+    unsigned h = key_hash(code, true);
+    int owner = -1;
+    dir_lock();
+    for (unsigned i = h & (IDX_CODE_CAP - 1), n = 0; n < IDX_CODE_CAP && owner < 0;
+         i = (i + 1) & (IDX_CODE_CAP - 1), n++) {
+        const IdxSlot* x = &g_dir->by_code[i];
+        if (x->state == SLOT_FREE) break;
+        if (x->state != SLOT_USED || x->hash != h) continue;
+        const DirSlot* s = dir_find(x->room_id);
+        if (s && s->room.is_private && strcasecmp(s->room.code, code) == 0)
+            owner = s->room.owner;
+    }
+    dir_unlock();
+    return owner;
+}
+
+int shard_owner_of_player(const char* name) {
+    if (!shard_enabled() || !name[0]) return -1;
+    unsigned h = key_hash(name, false);
+    int owner = -1;
+    dir_lock();
+    for (unsigned i = h & (IDX_PLAYER_CAP - 1), n = 0; n < IDX_PLAYER_CAP && owner < 0;
+         i = (i + 1) & (IDX_PLAYER_CAP - 1), n++) {
+        const IdxSlot* x = &g_dir->by_player[i];
+        if (x->state == SLOT_FREE) break;
+        if (x->state != SLOT_USED || x->hash != h) continue;
+        const DirSlot* s = dir_find(x->room_id);
+        if (s && (strcmp(s->room.p1, name) == 0 || strcmp(s->room.p2, name) == 0))
+            owner = s->room.owner;
+    }
+    dir_unlock();
+    return owner;
+}
+
+int shard_dir_list(ShardRoom* out, int cap) {
+    if (!shard_enabled()) return 0;
+    int n = 0;
+    dir_lock();
+    for (int i = 0; i < SHARD_DIR_CAP && n < cap; i++) {
+        const DirSlot* s = &g_dir->slots[i];
+        if (s->state == SLOT_USED && !s->room.is_private) out[n++] = s->room;
+    }
+    dir_unlock();
+    return n;
+}
+
+void shard_load_put(const ShardLoad* l) {
+    if (!shard_enabled()) return;
+    dir_lock();
+    g_dir->load[g_self] = *l;
+    dir_unlock();
+}
+
+int shard_loads(ShardLoad* out) {
+    if (!shard_enabled()) return 0;
+    dir_lock();
+    memcpy(out, g_dir->load, sizeof(ShardLoad) * (size_t)g_worker_count);
+    dir_unlock();
+    return g_worker_count;
+}
+
+// Parent only: forget the rooms and load of a worker that died
+static void dir_purge_owner(int worker) {
+    dir_lock();
+    memset(&g_dir->load[worker], 0, sizeof(ShardLoad));
+    for (int i = 0; i < SHARD_DIR_CAP; i++) {
+        DirSlot* s = &g_dir->slots[i];
+        if (s->state != SLOT_USED || s->room.owner != worker) continue;
+        index_room(&s->room, false);
+        s->state = SLOT_DELETED;
+    }
+    dir_unlock();
+}
+
+
+// ============================================================
+//  Client handoff
+// ============================================================
+
+int shard_handoff(const struct Client* c, int worker, const char* line) {
+    if (!shard_enabled() || worker < 0 || worker >= g_worker_count || worker == g_self)
+        return 0;
+
+    HandoffMsg m;
+    memset(&m, 0, sizeof(m));
+    snprintf(m.name, sizeof(m.name), "%s", c->name);
+    snprintf(m.session, sizeof(m.session), "%s", c->session_id);
+    m.rating = mm_rating(c);
+    snprintf(m.line, sizeof(m.line), "%s", line);
+
+    struct iovec iov = { .iov_base = &m, .iov_len = sizeof(m) };
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } ctl;
+    memset(&ctl, 0, sizeof(ctl));
+
+    struct msghdr mh;
+    memset(&mh, 0, sizeof(mh));
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = ctl.buf;
+    mh.msg_controllen = sizeof(ctl.buf);
+
+    struct cmsghdr* cm = CMSG_FIRSTHDR(&mh);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cm), &c->fd, sizeof(int));
+
+    if (sendmsg(g_links[worker][1], &mh, MSG_NOSIGNAL) != (ssize_t)sizeof(m)) {
+        perror("sendmsg");
+        return 0;
+    }
+    stats_inc(STAT_SHARD_HANDOFF_OUT);
+    server_log("Handed %s over to worker %d (%s)", c->name, worker, line[0] ? line : "rebalance");
+    return 1;
+}
+
+static void* receiver_thread(void* arg) {
+    (void)arg;
+    int rx = g_links[g_self][0];
+
+    while (1) {
+        HandoffMsg m;
+        struct iovec iov = { .iov_base = &m, .iov_len = sizeof(m) };
+        union {
+            char buf[CMSG_SPACE(sizeof(int))];
+            struct cmsghdr align;
+        } ctl;
+
+        struct msghdr mh;
+        memset(&mh, 0, sizeof(mh));
+        mh.msg_iov = &iov;
+        mh.msg_iovlen = 1;
+        mh.msg_control = ctl.buf;
+        mh.msg_controllen = sizeof(ctl.buf);
+
+        ssize_t r = recvmsg(rx, &mh, 0);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            perror("recvmsg");
+            break;
+        }
+
+        int fd = -1;
+        struct cmsghdr* cm = CMSG_FIRSTHDR(&mh);
+        if (cm && cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_RIGHTS)
+            memcpy(&fd, CMSG_DATA(cm), sizeof(int));
+        if (fd < 0) continue;
+        if (r != (ssize_t)sizeof(m)) {
+            close(fd);
+            continue;
+        }
+
+        m.name[sizeof(m.name) - 1] = '\0';
+        m.session[sizeof(m.session) - 1] = '\0';
+        m.line[sizeof(m.line) - 1] = '\0';
+        stats_inc(STAT_SHARD_HANDOFF_IN);
+        server_log("Adopted %s from another worker (%s)", m.name, m.line[0] ? m.line : "rebalance");
+        if (!client_adopt(fd, m.name, m.session, m.rating, m.line))
+            close(fd);
+    }
+    return NULL;
+}
+
+void shard_start_receiver(void) {
+    if (!shard_enabled()) return;
+    pthread_t th;
+    if (pthread_create(&th, NULL, receiver_thread, NULL) != 0) {
+        perror("pthread_create");
+        return;
+    }
+    pthread_detach(th);
+}
+
+
+// ============================================================
+//  shard_run() - parent / supervisor
+// ============================================================
+
+static volatile sig_atomic_t g_stop = 0;
+static volatile sig_atomic_t g_hup = 0;
+static volatile sig_atomic_t g_drain = 0;
+
+static void on_stop_signal(int sig) {
+    (void)sig;
+    g_stop = 1;
+}
+
+// Workers keep these handlers until run_server() blocks the signals
+static void on_hup_signal(int sig) {
+    (void)sig;
+    g_hup = 1;
+}
+
+static void on_drain_signal(int sig) {
+    (void)sig;
+    g_drain = 1;
+}
+
+static pid_t spawn(int worker, int (*worker_main)(int)) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        g_self = worker;
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        signal(SIGUSR2, SIG_DFL);
+        _exit(worker_main(worker));
+    }
+    return pid;
+}
+
+int shard_run(int workers, int (*worker_main)(int worker)) {
+    if (workers > SHARD_MAX_WORKERS) workers = SHARD_MAX_WORKERS;
+
+    g_dir = mmap(NULL, sizeof(ShardDir), PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (g_dir == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    memset(g_dir, 0, sizeof(ShardDir));
+
+    pthread_mutexattr_t ma;
+    pthread_mutexattr_init(&ma);
+    pthread_mutexattr_setpshared(&ma, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&ma, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&g_dir->mtx, &ma);
+    pthread_mutexattr_destroy(&ma);
+
+    for (int i = 0; i < workers; i++) {
+        if (socketpair(AF_UNIX, SOCK_DGRAM, 0, g_links[i]) < 0) {
+            perror("socketpair");
+            return 1;
+        }
+    }
+    g_worker_count = workers;
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_stop_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sa.sa_handler = on_hup_signal;
+    sigaction(SIGHUP, &sa, NULL);
+    sa.sa_handler = on_drain_signal;
+    sigaction(SIGQUIT, &sa, NULL);
+    signal(SIGUSR2, SIG_IGN);       // no live upgrade in this mode
+
+    pid_t pids[SHARD_MAX_WORKERS];
+    for (int i = 0; i < workers; i++) pids[i] = spawn(i, worker_main);
+    printf("Started %d worker processes\n", workers);
+    server_log("Supervisor started %d workers", workers);
+
+    bool draining = false;
+    while (!g_stop) {
+        int status;
+        pid_t dead = waitpid(-1, &status, 0);
+        if (g_drain && !draining) {
+            // Workers drain on their own; none is restarted any more
+            draining = true;
+            server_log("SIGQUIT: draining %d workers", workers);
+            for (int i = 0; i < workers; i++)
+                if (pids[i] > 0) kill(pids[i], SIGQUIT);
+        }
+        if (g_hup) {
+            // Every worker reloads server.config on its own
+            g_hup = 0;
+            server_log("SIGHUP: forwarding to %d workers", workers);
+            for (int i = 0; i < workers; i++)
+                if (pids[i] > 0) kill(pids[i], SIGHUP);
+        }
+        if (dead < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (int i = 0; i < workers; i++) {
+            if (pids[i] != dead) continue;
+            if (draining) {
+                server_log("Worker %d (pid %d) drained", i, (int)dead);
+                dir_purge_owner(i);
+                pids[i] = -1;
+                continue;
+            }
+            server_log("Worker %d (pid %d) exited with status %d, restarting",
+                       i, (int)dead, status);
+            dir_purge_owner(i);
+            sleep(1);
+            if (!g_stop) pids[i] = spawn(i, worker_main);
+        }
+    }
+
+    for (int i = 0; i < workers; i++)
+        if (pids[i] > 0) kill(pids[i], SIGTERM);
+    while (wait(NULL) > 0) { }
+    server_log("Supervisor stopped");
+    return 0;
+}
@@ -0,0 +1,86 @@
+// ============================================================
+//  SLAB MODULE IMPLEMENTATION
+//  ------------------------------------------------------------
+//  Free objects are linked through their first bytes; the list
+//  is LIFO so a recycled object is likely still in cache.
+// ============================================================
+
+#define _GNU_SOURCE  // MAP_POPULATE
+
+#include "slab.h"
+#include "log.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+
+static bool in_slab(const Slab* s, const void* p) {
+    const char* c = p;
+    return s->base && c >= s->base && c < s->base + s->size * (size_t)s->count;
+}
+
+size_t slab_fill(Slab* s, int count) {
+    if (count <= 0 || s->base) return 0;
+    s->size = (s->size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+    size_t bytes = s->size * (size_t)count;
+
+    void* m = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (m == MAP_FAILED) {
+        server_log("Slab %s: cannot map %d objects, using malloc", s->name, count);
+        return 0;
+    }
+
+    pthread_mutex_lock(&s->mtx);
+    s->base = m;
+    s->count = count;
+    // Thread the free list back to front so objects go out in address order
+    s->free_list = NULL;
+    for (int i = count - 1; i >= 0; i--) {
+        void* obj = s->base + s->size * (size_t)i;
+        *(void**)obj = s->free_list;
+        s->free_list = obj;
+    }
+    s->free_count = count;
+    pthread_mutex_unlock(&s->mtx);
+    return bytes;
+}
+
+void* slab_alloc(Slab* s) {
+    pthread_mutex_lock(&s->mtx);
+    void* p = s->free_list;
+    if (p) {
+        s->free_list = *(void**)p;
+        s->free_count--;
+    } else if (s->base && !s->dry_logged) {
+        s->dry_logged = true;
+        server_log("Slab %s: all %d objects in use, using malloc", s->name, s->count);
+    }
+    pthread_mutex_unlock(&s->mtx);
+
+    if (!p) return calloc(1, s->size);
+    memset(p, 0, s->size);
+    return p;
+}
+
+void slab_free(Slab* s, void* p) {
+    if (!p) return;
+    if (!in_slab(s, p)) {
+        free(p);
+        return;
+    }
+    pthread_mutex_lock(&s->mtx);
+    *(void**)p = s->free_list;
+    s->free_list = p;
+    s->free_count++;
+    pthread_mutex_unlock(&s->mtx);
+}
+
+int slab_available(Slab* s) {
+    pthread_mutex_lock(&s->mtx);
+    int n = s->free_count;
+    pthread_mutex_unlock(&s->mtx);
+    return n;
+}
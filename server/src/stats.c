@@ -0,0 +1,171 @@
+// ============================================================
+//  STATS MODULE IMPLEMENTATION
+//  ------------------------------------------------------------
+//  Counters and histograms are plain atomics, so recording a
+//  metric never takes a lock on any hot path.
+// ============================================================
+
+#include "stats.h"
+#include "log.h"
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdatomic.h>
+
+#define HIST_BUCKETS 32     // bucket i holds values in [2^(i-1), 2^i) ms
+
+static atomic_long g_counters[STAT_COUNTER_COUNT];
+static atomic_long g_gauges[STAT_GAUGE_COUNT];
+static atomic_long g_hist[STAT_HIST_COUNT][HIST_BUCKETS];
+
+static const char* g_counter_names[STAT_COUNTER_COUNT] = {
+    "queue_enqueued",
+    "queue_matched",
+    "queue_cancelled",
+    "fanout_delivered",
+    "fanout_dropped",
+    "fanout_bytes",
+    "chat_room",
+    "chat_lobby",
+    "chat_drop_rate",
+    "chat_drop_length",
+    "presence_events",
+    "presence_coalesced",
+    "pubsub_published",
+    "shard_handoff_out",
+    "shard_handoff_in",
+    "reject_full",
+    "reject_fd_limit",
+    "reject_nomem",
+    "accept_backoff",
+    "reject_overload",
+    "list_cached",
+    "rebalance_moved",
+    "rate_drop",
+    "rate_kick",
+    "reject_per_ip",
+    "reject_per_net",
+    "malformed",
+};
+
+static const char* g_gauge_names[STAT_GAUGE_COUNT] = {
+    "overload_level",
+    "dispatch_lag_ms",
+    "fanout_queue",
+};
+
+static const char* g_hist_names[STAT_HIST_COUNT] = {
+    "queue_wait_ms",
+    "tourney_round_start_ms",
+    "upgrade_pause_ms",
+};
+
+
+// ============================================================
+//  Recording
+// ============================================================
+
+void stats_add(StatCounter c, long delta) {
+    if (c < 0 || c >= STAT_COUNTER_COUNT) return;
+    atomic_fetch_add_explicit(&g_counters[c], delta, memory_order_relaxed);
+}
+
+void stats_inc(StatCounter c) {
+    stats_add(c, 1);
+}
+
+void stats_set(StatGauge g, long v) {
+    if (g < 0 || g >= STAT_GAUGE_COUNT) return;
+    atomic_store_explicit(&g_gauges[g], v, memory_order_relaxed);
+}
+
+void stats_observe(StatHist h, long ms) {
+    if (h < 0 || h >= STAT_HIST_COUNT) return;
+    if (ms < 0) ms = 0;
+
+    int b = 0;
+    while (ms > 0 && b < HIST_BUCKETS - 1) {
+        ms >>= 1;
+        b++;
+    }
+    atomic_fetch_add_explicit(&g_hist[h][b], 1, memory_order_relaxed);
+}
+
+
+// ============================================================
+//  Reporting
+// ============================================================
+
+long stats_percentile(StatHist h, double p) {
+    if (h < 0 || h >= STAT_HIST_COUNT) return 0;
+
+    long counts[HIST_BUCKETS];
+    long total = 0;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        counts[b] = atomic_load_explicit(&g_hist[h][b], memory_order_relaxed);
+        total += counts[b];
+    }
+    if (total == 0) return 0;
+
+    long rank = (long)((p / 100.0) * (double)total + 0.5);
+    if (rank < 1) rank = 1;
+
+    long seen = 0;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        seen += counts[b];
+        if (seen >= rank) return b == 0 ? 0 : (1L << b) - 1;
+    }
+    return (1L << (HIST_BUCKETS - 1)) - 1;
+}
+
+// Calls emit() once per reported metric (histograms expand to p50/p90/p99).
+static void stats_each(void (*emit)(void* ctx, const char* key, long value), void* ctx) {
+    for (int i = 0; i < STAT_COUNTER_COUNT; i++) {
+        emit(ctx, g_counter_names[i],
+             atomic_load_explicit(&g_counters[i], memory_order_relaxed));
+    }
+    for (int i = 0; i < STAT_GAUGE_COUNT; i++) {
+        emit(ctx, g_gauge_names[i],
+             atomic_load_explicit(&g_gauges[i], memory_order_relaxed));
+    }
+    for (int h = 0; h < STAT_HIST_COUNT; h++) {
+        static const int pcts[] = { 50, 90, 99 };
+        for (int k = 0; k < 3; k++) {
+            char key[64];
+            snprintf(key, sizeof(key), "%s_p%d", g_hist_names[h], pcts[k]);
+            emit(ctx, key, stats_percentile(h, pcts[k]));
+        }
+    }
+}
+
+static void emit_msgbuf(void* ctx, const char* key, long value) {
+    msgbuf_add((MsgBuf*)ctx, "STAT|%s|%ld", key, value);
+}
+
+typedef struct {
+    char line[1024];
+    int off;
+} LogLine;
+
+static void emit_logline(void* ctx, const char* key, long value) {
+    LogLine* l = (LogLine*)ctx;
+    if (l->off >= (int)sizeof(l->line)) return;
+    l->off += snprintf(l->line + l->off, sizeof(l->line) - l->off, "%s%s=%ld",
+                       l->off ? " " : "", key, value);
+}
+
+void stats_send(int fd) {
+    MsgBuf mb;
+    msgbuf_init(&mb);
+    stats_each(emit_msgbuf, &mb);
+    msgbuf_add(&mb, "STATS_END|");
+    msgbuf_send(fd, &mb);
+}
+
+void stats_log(void) {
+    LogLine l;
+    l.line[0] = '\0';
+    l.off = 0;
+    stats_each(emit_logline, &l);
+    server_log("Stats: %s", l.line);
+}
@@ -0,0 +1,209 @@
+// ============================================================
+//  TIMER MODULE IMPLEMENTATION
+//  ------------------------------------------------------------
+//  Hashed timing wheel. Timers live in a slab (array of entries
+//  linked into wheel slots by index); a handle is the slab index
+//  plus a generation counter, so cancelling a timer that already
+//  fired is detected without any lookup structure.
+// ============================================================
+
+#define _POSIX_C_SOURCE 200809L  // nanosleep
+
+#include "timer.h"
+#include "utils.h"
+#include "log.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+
+typedef struct {
+    int prev, next;         // Slot list links (slab indices, -1 = none)
+    int slot;               // Wheel slot, -1 when free
+    long rounds;            // Full revolutions left before expiry
+    uint32_t gen;           // Bumped on every free, invalidates old handles
+    TimerFn fn;
+    long a, b;
+} TimerEntry;
+
+static TimerEntry* g_slab = NULL;
+static int g_slab_cap = 0;
+static int g_free = -1;                     // Free list head (via .next)
+static int g_wheel[TIMER_WHEEL_SIZE];       // Slot list heads
+static long long g_tick = 0;                // Ticks processed so far
+static pthread_mutex_t g_timer_mtx = PTHREAD_MUTEX_INITIALIZER;
+static atomic_long g_lag_max = 0;           // Worst tick lateness since the last read
+
+
+// ============================================================
+//  Entry pool helpers (expect g_timer_mtx held)
+// ============================================================
+
+static int timer_entry_alloc(void) {
+    if (g_free < 0) {
+        int cap = g_slab_cap ? g_slab_cap * 2 : 256;
+        TimerEntry* grown = realloc(g_slab, (size_t)cap * sizeof(TimerEntry));
+        if (!grown) return -1;
+        for (int i = g_slab_cap; i < cap; i++) {
+            grown[i].slot = -1;
+            grown[i].gen = 1;
+            grown[i].next = (i + 1 < cap) ? i + 1 : -1;
+        }
+        g_slab = grown;
+        g_free = g_slab_cap;
+        g_slab_cap = cap;
+    }
+    int idx = g_free;
+    g_free = g_slab[idx].next;
+    return idx;
+}
+
+static void timer_entry_free(int idx) {
+    g_slab[idx].slot = -1;
+    g_slab[idx].gen++;
+    g_slab[idx].next = g_free;
+    g_free = idx;
+}
+
+static void slot_unlink(int idx) {
+    TimerEntry* e = &g_slab[idx];
+    if (e->prev >= 0) g_slab[e->prev].next = e->next;
+    else              g_wheel[e->slot] = e->next;
+    if (e->next >= 0) g_slab[e->next].prev = e->prev;
+}
+
+
+// ============================================================
+//  Timer thread
+//  ------------------------------------------------------------
+//  Advances the wheel tick by tick (catching up if it was late)
+//  and fires expired entries outside the lock.
+// ============================================================
+
+typedef struct {
+    TimerFn fn;
+    long a, b;
+} Expired;
+
+static void* timer_thread(void* arg) {
+    (void)arg;
+    long long start = now_ms();
+    Expired* batch = NULL;
+    int batch_cap = 0;
+
+    while (1) {
+        long long due = start + (g_tick + 1) * TIMER_TICK_MS;
+        long long now = now_ms();
+        if (now < due) {
+            struct timespec ts = { 0, (long)(due - now) * 1000000L };
+            nanosleep(&ts, NULL);
+            continue;
+        }
+
+        long lag = (long)(now - due);
+        if (lag > atomic_load_explicit(&g_lag_max, memory_order_relaxed))
+            atomic_store_explicit(&g_lag_max, lag, memory_order_relaxed);
+
+        int n = 0;
+        pthread_mutex_lock(&g_timer_mtx);
+        g_tick++;
+        int slot = (int)(g_tick % TIMER_WHEEL_SIZE);
+        int idx = g_wheel[slot];
+        while (idx >= 0) {
+            TimerEntry* e = &g_slab[idx];
+            int next = e->next;
+            if (e->rounds > 0) {
+                e->rounds--;
+            } else {
+                if (n == batch_cap) {
+                    int cap = batch_cap ? batch_cap * 2 : 64;
+                    Expired* grown = realloc(batch, (size_t)cap * sizeof(Expired));
+                    if (!grown) break;  // fire the rest on the next revolution
+                    batch = grown;
+                    batch_cap = cap;
+                }
+                batch[n].fn = e->fn;
+                batch[n].a = e->a;
+                batch[n].b = e->b;
+                n++;
+                slot_unlink(idx);
+                timer_entry_free(idx);
+            }
+            idx = next;
+        }
+        pthread_mutex_unlock(&g_timer_mtx);
+
+        for (int i = 0; i < n; i++)
+            batch[i].fn(batch[i].a, batch[i].b);
+    }
+    return NULL;
+}
+
+void timer_start(void) {
+    for (int i = 0; i < TIMER_WHEEL_SIZE; i++) g_wheel[i] = -1;
+
+    pthread_t th;
+    if (pthread_create(&th, NULL, timer_thread, NULL) != 0) {
+        perror("pthread_create");
+        return;
+    }
+    pthread_detach(th);
+    server_log("Timer wheel started (%d slots x %d ms)", TIMER_WHEEL_SIZE, TIMER_TICK_MS);
+}
+
+
+long timer_lag_ms(void) {
+    return atomic_exchange(&g_lag_max, 0);
+}
+
+
+// ============================================================
+//  timer_arm() / timer_cancel()
+// ============================================================
+
+TimerId timer_arm(long delay_ms, TimerFn fn, long a, long b) {
+    if (!fn) return 0;
+    long ticks = (delay_ms + TIMER_TICK_MS - 1) / TIMER_TICK_MS;
+    if (ticks < 1) ticks = 1;
+
+    pthread_mutex_lock(&g_timer_mtx);
+    int idx = timer_entry_alloc();
+    if (idx < 0) {
+        pthread_mutex_unlock(&g_timer_mtx);
+        return 0;
+    }
+
+    TimerEntry* e = &g_slab[idx];
+    long long target = g_tick + ticks;
+    e->slot = (int)(target % TIMER_WHEEL_SIZE);
+    e->rounds = (ticks - 1) / TIMER_WHEEL_SIZE;
+    e->fn = fn;
+    e->a = a;
+    e->b = b;
+    e->prev = -1;
+    e->next = g_wheel[e->slot];
+    if (e->next >= 0) g_slab[e->next].prev = idx;
+    g_wheel[e->slot] = idx;
+
+    TimerId id = ((TimerId)e->gen << 32) | (TimerId)(idx + 1);
+    pthread_mutex_unlock(&g_timer_mtx);
+    return id;
+}
+
+int timer_cancel(TimerId id) {
+    if (id == 0) return 0;
+    int idx = (int)(id & 0xffffffffu) - 1;
+    uint32_t gen = (uint32_t)(id >> 32);
+
+    pthread_mutex_lock(&g_timer_mtx);
+    int ok = (idx >= 0 && idx < g_slab_cap &&
+              g_slab[idx].gen == gen && g_slab[idx].slot >= 0);
+    if (ok) {
+        slot_unlink(idx);
+        timer_entry_free(idx);
+    }
+    pthread_mutex_unlock(&g_timer_mtx);
+    return ok;
+}
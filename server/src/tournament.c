@@ -0,0 +1,859 @@
+// ============================================================
+//  TOURNAMENT MODULE IMPLEMENTATION
+//  ------------------------------------------------------------
+//  All tournament state is owned by the scheduler thread's lock.
+//  Network threads only register players or push events onto a
+//  small queue; pairing, room creation and result bookkeeping
+//  happen on the scheduler thread.
+//
+//  Players are bound to their session token (carried over on
+//  RECONNECT), never looked up by name. Anything that sends or
+//  touches rooms is queued as an action while g_tourney_mtx is
+//  held and run by the scheduler after releasing it.
+//
+//  Lock order: g_tourney_mtx -> g_clients_mtx (session lookups).
+//  The event queue lock is a leaf (safe under g_rooms_mtx).
+// ============================================================
+
+#define _POSIX_C_SOURCE 200809L  // strtok_r
+
+#include "tournament.h"
+#include "client.h"
+#include "room.h"
+#include "matchmaking.h"
+#include "utils.h"
+#include "stats.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
+#include <time.h>
+
+#define TOURNEY_RETRY_MS     1000   // Retry interval for games waiting for a free room
+#define TOURNEY_BUSY_WAIT_MS 60000  // How long a game waits for a player busy elsewhere
+#define TOURNEY_MAX_ROUNDS   64     // Largest SWISS round count accepted at CREATE
+#define TOURNEY_EXTRA_ROUNDS 2      // Swiss rounds allowed beyond ceil(log2(players))
+#define TOURNEY_OPEN_MAX     2      // Unfinished tournaments one session may create
+
+typedef enum { FMT_SWISS = 0, FMT_SE = 1 } TourneyFormat;
+typedef enum { T_REGISTERING = 0, T_RUNNING = 1, T_FINISHED = 2 } TourneyState;
+
+typedef struct {
+    char name[32];          // Display name at registration
+    char session[32];       // Client.session_id, identifies the player
+    struct Client* conn;    // Connection of that session, held; NULL once gone
+    int  rating;            // Seed (rating at registration)
+    int  score2;            // Score in half points (win = 2, draw = 1)
+    bool eliminated;        // SE: knocked out
+    bool had_bye;
+    int* opponents;         // Indices of past opponents (Swiss rematch avoidance)
+    int  opp_count;
+    int  opp_cap;
+} TPlayer;
+
+typedef struct {
+    int a, b;               // Player indices
+    int room_id;            // -1 while waiting for a free room
+    bool placing;           // ACT_PLACE queued, room not known yet
+    long long busy_until;   // Forfeit deadline while a player is busy, 0 = none
+    bool done;
+} TGame;
+
+typedef struct Tournament {
+    int id;
+    char name[32];
+    char creator[32];       // Creator's session token
+    TourneyFormat format;
+    TourneyState state;
+    int round;
+    int total_rounds;       // Swiss only (SE runs until one player is left)
+
+    TPlayer* players;
+    int player_count;
+    int player_cap;
+
+    TGame* games;           // Games of the current round
+    int game_count;
+    int games_open;         // Games of the round without a result yet
+
+    long long round_trigger_ms; // When the round became due (latency metric)
+    bool round_started;         // All rooms of the round exist
+} Tournament;
+
+typedef enum { EV_START = 0, EV_RESULT = 1 } EventType;
+
+typedef struct TEvent {
+    struct TEvent* next;
+    EventType type;
+    int tourney_id;
+    int room_id;
+    bool draw;
+    bool abandoned;         // Room removed before the game was decided
+    char winner[32];        // Winner's session token
+    long long at_ms;
+} TEvent;
+
+typedef enum { ACT_NOTIFY = 0, ACT_PLACE, ACT_CLOSE, ACT_REMATCH } ActionType;
+
+// Work that sends or takes g_rooms_mtx, run without g_tourney_mtx
+typedef struct TAction {
+    struct TAction* next;
+    ActionType type;
+    int tourney_id, round, game;    // ACT_PLACE
+    int room_id;                    // ACT_CLOSE / ACT_REMATCH
+    struct Client* conn[2];         // Held; ACT_NOTIFY: [0]; ACT_PLACE: both players
+    char name[2][32];               // ACT_PLACE
+    char text[160];                 // ACT_NOTIFY payload / ACT_PLACE room name
+} TAction;
+
+static Tournament** g_tourneys = NULL;
+static int g_tourney_count = 0;
+static int g_tourney_cap = 0;
+static int g_next_tourney_id = 1;
+static pthread_mutex_t g_tourney_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+static TEvent* g_ev_head = NULL;
+static TEvent* g_ev_tail = NULL;
+static pthread_mutex_t g_ev_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_ev_cv = PTHREAD_COND_INITIALIZER;
+
+static TAction* g_act_head = NULL;     // under g_tourney_mtx
+static TAction* g_act_tail = NULL;
+
+
+// ============================================================
+//  Lookup helpers (expect g_tourney_mtx held)
+// ============================================================
+
+static Tournament* tourney_find(int id) {
+    for (int i = 0; i < g_tourney_count; i++)
+        if (g_tourneys[i]->id == id) return g_tourneys[i];
+    return NULL;
+}
+
+static int player_index(const Tournament* t, const char* session) {
+    for (int i = 0; i < t->player_count; i++)
+        if (strcmp(t->players[i].session, session) == 0) return i;
+    return -1;
+}
+
+static TAction* queue_action(ActionType type) {
+    TAction* a = calloc(1, sizeof(TAction));
+    if (!a) return NULL;
+    a->type = type;
+    if (g_act_tail) g_act_tail->next = a;
+    else            g_act_head = a;
+    g_act_tail = a;
+    return a;
+}
+
+// Cached connection of a player, dropped once it is going away
+// (only a reconnect of the session, tourney_rebind(), brings it back)
+static struct Client* player_conn(TPlayer* p) {
+    struct Client* c = p->conn;
+    if (c && (!c->connected || atomic_load(&c->dying))) {
+        client_release(c);
+        p->conn = c = NULL;
+    }
+    return c;
+}
+
+static void notify(TPlayer* p, const char* fmt, ...) {
+    struct Client* c = player_conn(p);
+    if (!c) return;
+    TAction* a = queue_action(ACT_NOTIFY);
+    if (!a) return;
+    client_hold(c);
+    a->conn[0] = c;
+
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(a->text, sizeof(a->text), fmt, ap);
+    va_end(ap);
+}
+
+static void add_opponent(TPlayer* p, int idx) {
+    if (p->opp_count == p->opp_cap) {
+        int cap = p->opp_cap ? p->opp_cap * 2 : 8;
+        int* grown = realloc(p->opponents, (size_t)cap * sizeof(int));
+        if (!grown) return;
+        p->opponents = grown;
+        p->opp_cap = cap;
+    }
+    p->opponents[p->opp_count++] = idx;
+}
+
+static bool played_before(const TPlayer* p, int idx) {
+    for (int i = 0; i < p->opp_count; i++)
+        if (p->opponents[i] == idx) return true;
+    return false;
+}
+
+
+// ============================================================
+//  Event queue
+// ============================================================
+
+static void push_event(TEvent* ev) {
+    ev->next = NULL;
+    ev->at_ms = now_ms();
+    pthread_mutex_lock(&g_ev_mtx);
+    if (g_ev_tail) g_ev_tail->next = ev;
+    else           g_ev_head = ev;
+    g_ev_tail = ev;
+    pthread_cond_signal(&g_ev_cv);
+    pthread_mutex_unlock(&g_ev_mtx);
+}
+
+bool tourney_has_player(const char* session) {
+    bool found = false;
+    pthread_mutex_lock(&g_tourney_mtx);
+    for (int i = 0; i < g_tourney_count && !found; i++)
+        found = g_tourneys[i]->state != T_FINISHED && player_index(g_tourneys[i], session) >= 0;
+    pthread_mutex_unlock(&g_tourney_mtx);
+    return found;
+}
+
+void tourney_rebind(struct Client* c) {
+    if (!c->session_id[0]) return;
+    pthread_mutex_lock(&g_tourney_mtx);
+    for (int i = 0; i < g_tourney_count; i++) {
+        Tournament* t = g_tourneys[i];
+        int idx = (t->state != T_FINISHED) ? player_index(t, c->session_id) : -1;
+        if (idx < 0 || t->players[idx].conn == c) continue;
+        client_hold(c);
+        if (t->players[idx].conn) client_release(t->players[idx].conn);
+        t->players[idx].conn = c;
+    }
+    pthread_mutex_unlock(&g_tourney_mtx);
+}
+
+void tourney_report(int tourney_id, int room_id, const char* winner) {
+    TEvent* ev = calloc(1, sizeof(TEvent));
+    if (!ev) return;
+    ev->type = EV_RESULT;
+    ev->tourney_id = tourney_id;
+    ev->room_id = room_id;
+    ev->draw = (winner == NULL);
+    if (winner) snprintf(ev->winner, sizeof(ev->winner), "%s", winner);
+    push_event(ev);
+}
+
+void tourney_report_abandoned(int tourney_id, int room_id) {
+    TEvent* ev = calloc(1, sizeof(TEvent));
+    if (!ev) return;
+    ev->type = EV_RESULT;
+    ev->tourney_id = tourney_id;
+    ev->room_id = room_id;
+    ev->abandoned = true;
+    push_event(ev);
+}
+
+
+// ============================================================
+//  Pairing (scheduler thread, expects g_tourney_mtx held)
+// ============================================================
+
+// qsort() has no context argument; sorting only ever happens on the
+// scheduler thread, so the tournament being sorted is kept here.
+static const Tournament* g_sort_ctx = NULL;
+
+static int cmp_standing(const void* pa, const void* pb) {
+    const TPlayer* a = &g_sort_ctx->players[*(const int*)pa];
+    const TPlayer* b = &g_sort_ctx->players[*(const int*)pb];
+    if (a->score2 != b->score2) return b->score2 - a->score2;
+    if (a->rating != b->rating) return b->rating - a->rating;
+    return *(const int*)pa - *(const int*)pb;
+}
+
+static void sort_standings(const Tournament* t, int* order, int n) {
+    g_sort_ctx = t;
+    qsort(order, (size_t)n, sizeof(int), cmp_standing);
+    g_sort_ctx = NULL;
+}
+
+static void add_game(Tournament* t, int a, int b) {
+    TGame* g = &t->games[t->game_count++];
+    g->a = a;
+    g->b = b;
+    g->room_id = -1;
+    g->placing = false;
+    g->busy_until = 0;
+    g->done = false;
+    t->games_open++;
+    add_opponent(&t->players[a], b);
+    add_opponent(&t->players[b], a);
+}
+
+// Odd field: the lowest-ranked player in order[] without a bye yet
+// sits out (the lowest-ranked of all if everybody had one)
+static void give_bye(Tournament* t, int* order, int* n) {
+    int pick = *n - 1;
+    for (int k = *n - 1; k >= 0; k--)
+        if (!t->players[order[k]].had_bye) { pick = k; break; }
+
+    TPlayer* p = &t->players[order[pick]];
+    p->had_bye = true;
+    p->score2 += 2;
+    notify(p, "TOURNEY_BYE|%d|%d", t->id, t->round);
+
+    memmove(&order[pick], &order[pick + 1], (size_t)(*n - pick - 1) * sizeof(int));
+    (*n)--;
+}
+
+// Builds the game list of the next round. Returns the number of games.
+static int pair_round(Tournament* t) {
+    int n = 0;
+    int* order = malloc((size_t)(t->player_count ? t->player_count : 1) * sizeof(int));
+    if (!order) return 0;
+
+    for (int i = 0; i < t->player_count; i++)
+        if (!t->players[i].eliminated) order[n++] = i;
+
+    free(t->games);
+    t->games = calloc((size_t)(n / 2 + 1), sizeof(TGame));
+    t->game_count = 0;
+    t->games_open = 0;
+    if (!t->games) { free(order); return 0; }
+
+    if (t->format == FMT_SWISS) {
+        sort_standings(t, order, n);
+
+        if (n % 2) give_bye(t, order, &n);
+
+        // Greedy top-down pairing avoiding rematches where possible
+        bool* used = calloc((size_t)(n ? n : 1), sizeof(bool));
+        if (!used) { free(order); return 0; }
+        for (int i = 0; i < n; i++) {
+            if (used[i]) continue;
+            int partner = -1;
+            for (int j = i + 1; j < n; j++) {
+                if (used[j]) continue;
+                if (partner < 0) partner = j;     // fallback: rematch
+                if (!played_before(&t->players[order[i]], order[j])) { partner = j; break; }
+            }
+            if (partner < 0) break;
+            used[i] = used[partner] = true;
+            add_game(t, order[i], order[partner]);
+        }
+        free(used);
+    } else {
+        // Single elimination: bracket order = registration seed order
+        if (n % 2) give_bye(t, order, &n);
+        for (int i = 0; i + 1 < n; i += 2)
+            add_game(t, order[i], order[i + 1]);
+    }
+
+    free(order);
+    return t->game_count;
+}
+
+
+// ============================================================
+//  Room placement (scheduler thread, expects g_tourney_mtx held)
+// ============================================================
+
+static void record_result(Tournament* t, TGame* g, int winner_idx);
+
+typedef enum { P_READY = 0, P_BUSY, P_OFFLINE } Presence;
+
+// Only a hint: room_create / room_join re-check under g_rooms_mtx
+static Presence player_presence(TPlayer* p) {
+    struct Client* c = player_conn(p);
+    if (!c) return P_OFFLINE;
+    return c->current_room ? P_BUSY : P_READY;
+}
+
+static void round_check_started(Tournament* t) {
+    if (t->round_started) return;
+    for (int i = 0; i < t->game_count; i++)
+        if (!t->games[i].done && t->games[i].room_id < 0) return;
+    t->round_started = true;
+    stats_observe(HIST_TOURNEY_ROUND_START_MS, (long)(now_ms() - t->round_trigger_ms));
+}
+
+// Decides every game still waiting for a room, per player: offline
+// forfeits at once, busy in another room waits up to
+// TOURNEY_BUSY_WAIT_MS and then forfeits. Games with both players
+// ready get an ACT_PLACE; one that finds the lobby full is retried.
+static void place_games(Tournament* t) {
+    long long now = now_ms();
+
+    for (int i = 0; i < t->game_count; i++) {
+        TGame* g = &t->games[i];
+        if (g->done || g->placing || g->room_id >= 0) continue;
+
+        TPlayer* pa = &t->players[g->a];
+        TPlayer* pb = &t->players[g->b];
+        Presence sa = player_presence(pa);
+        Presence sb = player_presence(pb);
+
+        Presence lose = P_READY;
+        if (sa == P_OFFLINE || sb == P_OFFLINE) {
+            lose = P_OFFLINE;
+        } else if (sa == P_BUSY || sb == P_BUSY) {
+            if (!g->busy_until) g->busy_until = now + TOURNEY_BUSY_WAIT_MS;
+            if (now < g->busy_until) continue;
+            lose = P_BUSY;
+        }
+        if (lose != P_READY) {
+            const char* why = (lose == P_OFFLINE) ? "offline" : "busy";
+            if (sa == lose && sb == lose) {
+                server_log("Tournament %d: double forfeit in round %d (%s and %s %s)",
+                           t->id, t->round, pa->name, pb->name, why);
+                record_result(t, g, -1);
+            } else {
+                server_log("Tournament %d: forfeit in round %d (%s %s)",
+                           t->id, t->round, sa == lose ? pa->name : pb->name, why);
+                record_result(t, g, sa == lose ? g->b : g->a);
+            }
+            continue;
+        }
+
+        TAction* a = queue_action(ACT_PLACE);
+        if (!a) continue;
+        a->tourney_id = t->id;
+        a->round = t->round;
+        a->game = i;
+        client_hold(pa->conn);
+        client_hold(pb->conn);
+        a->conn[0] = pa->conn;
+        a->conn[1] = pb->conn;
+        snprintf(a->name[0], sizeof(a->name[0]), "%s", pa->name);
+        snprintf(a->name[1], sizeof(a->name[1]), "%s", pb->name);
+        snprintf(a->text, sizeof(a->text), "T%d R%d", t->id, t->round);
+        g->placing = true;
+    }
+
+    round_check_started(t);
+}
+
+static void finish(Tournament* t) {
+    int* order = malloc((size_t)(t->player_count ? t->player_count : 1) * sizeof(int));
+    if (!order) return;
+    for (int i = 0; i < t->player_count; i++) order[i] = i;
+
+    const char* winner = "";
+    if (t->format == FMT_SE) {
+        for (int i = 0; i < t->player_count; i++)
+            if (!t->players[i].eliminated) { winner = t->players[i].name; break; }
+    } else {
+        sort_standings(t, order, t->player_count);
+        if (t->player_count) winner = t->players[order[0]].name;
+    }
+
+    t->state = T_FINISHED;
+    for (int i = 0; i < t->player_count; i++)
+        notify(&t->players[i], "TOURNEY_END|%d|%s", t->id, winner);
+    server_log("Tournament %d (%s) finished, winner %s", t->id, t->name, winner);
+    free(order);
+}
+
+static int alive_count(const Tournament* t) {
+    int n = 0;
+    for (int i = 0; i < t->player_count; i++)
+        if (!t->players[i].eliminated) n++;
+    return n;
+}
+
+static void next_round(Tournament* t, long long trigger_ms) {
+    bool over = (t->format == FMT_SWISS) ? (t->round >= t->total_rounds)
+                                         : (alive_count(t) <= 1);
+    if (over) {
+        finish(t);
+        return;
+    }
+
+    t->round++;
+    t->round_trigger_ms = trigger_ms;
+    t->round_started = false;
+    int games = pair_round(t);
+    server_log("Tournament %d round %d: %d game(s)", t->id, t->round, games);
+
+    if (games == 0) {           // everybody had a bye or the field collapsed
+        next_round(t, trigger_ms);
+        return;
+    }
+    place_games(t);
+}
+
+// winner_idx = -1 means draw (Swiss) / double forfeit
+static void record_result(Tournament* t, TGame* g, int winner_idx) {
+    if (g->done) return;
+    g->done = true;
+    t->games_open--;
+
+    if (winner_idx < 0) {
+        if (t->format == FMT_SWISS) {
+            t->players[g->a].score2 += 1;
+            t->players[g->b].score2 += 1;
+        } else {
+            t->players[g->a].eliminated = true;
+            t->players[g->b].eliminated = true;
+        }
+    } else {
+        int loser = (winner_idx == g->a) ? g->b : g->a;
+        t->players[winner_idx].score2 += 2;
+        if (t->format == FMT_SE) t->players[loser].eliminated = true;
+    }
+}
+
+static void handle_result(const TEvent* ev) {
+    Tournament* t = tourney_find(ev->tourney_id);
+    if (!t || t->state != T_RUNNING) return;
+
+    TGame* g = NULL;
+    for (int i = 0; i < t->game_count; i++)
+        if (t->games[i].room_id == ev->room_id && !t->games[i].done) { g = &t->games[i]; break; }
+    if (!g) return;
+
+    if (ev->abandoned) {
+        // Both players left the room: nobody is there to play it again
+        server_log("Tournament %d: double forfeit in round %d (room %d abandoned)",
+                   t->id, t->round, ev->room_id);
+        record_result(t, g, -1);
+    } else if (ev->draw && t->format == FMT_SE) {
+        TAction* a = queue_action(ACT_REMATCH);     // knockout games cannot end drawn
+        if (a) a->room_id = ev->room_id;
+        return;
+    } else {
+        int w = ev->draw ? -1 : player_index(t, ev->winner);
+        record_result(t, g, w);
+        TAction* a = queue_action(ACT_CLOSE);
+        if (a) a->room_id = ev->room_id;
+    }
+
+    if (t->games_open == 0) next_round(t, ev->at_ms);
+}
+
+static void tourney_free(Tournament* t) {
+    for (int i = 0; i < t->player_count; i++) {
+        free(t->players[i].opponents);
+        if (t->players[i].conn) client_release(t->players[i].conn);
+    }
+    free(t->players);
+    free(t->games);
+    free(t);
+}
+
+// Drops finished tournaments; their players have been sent TOURNEY_END
+static void reap_finished(void) {
+    int kept = 0;
+    for (int i = 0; i < g_tourney_count; i++) {
+        if (g_tourneys[i]->state == T_FINISHED) tourney_free(g_tourneys[i]);
+        else                                    g_tourneys[kept++] = g_tourneys[i];
+    }
+    g_tourney_count = kept;
+}
+
+
+// ============================================================
+//  Actions (scheduler thread, g_tourney_mtx NOT held)
+// ============================================================
+
+// Seats both players of a game. Returns the room id, -1 if the game
+// has to be decided again (lobby full, a player busy or gone).
+static int place_game(const TAction* a) {
+    struct Client* ca = a->conn[0];
+    struct Client* cb = a->conn[1];
+    int room_id = -1;
+
+    if (ca && cb) {
+        RoomOptions opts;
+        memset(&opts, 0, sizeof(opts));
+        opts.tourney_id = a->tourney_id;
+
+        room_unspectate(ca);
+        room_unspectate(cb);
+        mm_dequeue(ca, 0);
+        mm_dequeue(cb, 0);
+        Room* r = room_create(a->text, ca, &opts);
+        if (r) {
+            room_id = r->id;
+            sendp(ca->fd, "TOURNEY_ROUND|%d|%d|%s", a->tourney_id, a->round, a->name[1]);
+            sendp(cb->fd, "TOURNEY_ROUND|%d|%d|%s", a->tourney_id, a->round, a->name[0]);
+            if (!room_join(room_id, cb)) {
+                room_close(room_id, "Opponent unavailable");
+                room_id = -1;
+            }
+        }
+    }
+    return room_id;
+}
+
+static void placement_done(const TAction* a, int room_id) {
+    pthread_mutex_lock(&g_tourney_mtx);
+    Tournament* t = tourney_find(a->tourney_id);
+    bool stale = !t || t->state != T_RUNNING || t->round != a->round || a->game >= t->game_count;
+    if (!stale) {
+        TGame* g = &t->games[a->game];
+        g->placing = false;
+        if (room_id >= 0) {
+            g->room_id = room_id;
+            round_check_started(t);
+        }
+    }
+    pthread_mutex_unlock(&g_tourney_mtx);
+
+    if (stale && room_id >= 0) room_close(room_id, "Tournament game cancelled");
+}
+
+static void run_actions(TAction* a) {
+    while (a) {
+        TAction* next = a->next;
+        if (a->type == ACT_NOTIFY) {
+            sendp(a->conn[0]->fd, "%s", a->text);
+        } else if (a->type == ACT_PLACE) {
+            placement_done(a, place_game(a));
+        } else if (a->type == ACT_CLOSE) {
+            room_close(a->room_id, "Tournament game finished");
+        } else {
+            room_rematch(a->room_id);
+        }
+        if (a->conn[0]) client_release(a->conn[0]);
+        if (a->conn[1]) client_release(a->conn[1]);
+        free(a);
+        a = next;
+    }
+}
+
+
+// ============================================================
+//  Scheduler thread
+// ============================================================
+
+static void* scheduler_thread(void* arg) {
+    (void)arg;
+    while (1) {
+        pthread_mutex_lock(&g_ev_mtx);
+        if (!g_ev_head) {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_sec += TOURNEY_RETRY_MS / 1000;
+            pthread_cond_timedwait(&g_ev_cv, &g_ev_mtx, &ts);
+        }
+        TEvent* batch = g_ev_head;
+        g_ev_head = g_ev_tail = NULL;
+        pthread_mutex_unlock(&g_ev_mtx);
+
+        pthread_mutex_lock(&g_tourney_mtx);
+        while (batch) {
+            TEvent* ev = batch;
+            batch = batch->next;
+
+            if (ev->type == EV_START) {
+                Tournament* t = tourney_find(ev->tourney_id);
+                if (t && t->state == T_REGISTERING) {
+                    t->state = T_RUNNING;
+                    // Swiss: ceil(log2(players)) rounds find a winner;
+                    // a few more are allowed, not an endless event
+                    int r = 0;
+                    while ((1 << r) < t->player_count) r++;
+                    if (t->total_rounds <= 0)
+                        t->total_rounds = r;
+                    else if (t->total_rounds > r + TOURNEY_EXTRA_ROUNDS)
+                        t->total_rounds = r + TOURNEY_EXTRA_ROUNDS;
+                    next_round(t, ev->at_ms);
+                }
+            } else {
+                handle_result(ev);
+            }
+            free(ev);
+        }
+
+        // Retry rounds still waiting for free rooms or busy players
+        for (int i = 0; i < g_tourney_count; i++) {
+            Tournament* t = g_tourneys[i];
+            if (t->state == T_RUNNING && !t->round_started) place_games(t);
+            if (t->state == T_RUNNING && t->games_open == 0) next_round(t, now_ms());
+        }
+        reap_finished();
+
+        TAction* todo = g_act_head;
+        g_act_head = g_act_tail = NULL;
+        pthread_mutex_unlock(&g_tourney_mtx);
+
+        run_actions(todo);
+    }
+    return NULL;
+}
+
+void tourney_start(void) {
+    pthread_t th;
+    if (pthread_create(&th, NULL, scheduler_thread, NULL) != 0) {
+        perror("pthread_create");
+        return;
+    }
+    pthread_detach(th);
+}
+
+
+// ============================================================
+//  Command handling (network threads)
+// ============================================================
+
+static void cmd_create(struct Client* c, char* name, char* format, char* rounds) {
+    if (!name || !name[0] || !format) {
+        sendp(c->fd, "ERROR|Invalid tournament format");
+        return;
+    }
+
+    TourneyFormat fmt;
+    if (strcasecmp(format, "SWISS") == 0)   fmt = FMT_SWISS;
+    else if (strcasecmp(format, "SE") == 0) fmt = FMT_SE;
+    else {
+        sendp(c->fd, "ERROR|Invalid tournament format");
+        return;
+    }
+
+    long total = 0;
+    if (fmt == FMT_SWISS && rounds) {
+        char* end = NULL;
+        total = strtol(rounds, &end, 10);
+        if (end == rounds || *end != '\0' || total <= 0 || total > TOURNEY_MAX_ROUNDS) {
+            sendp(c->fd, "ERROR|Invalid round count");
+            return;
+        }
+    }
+
+    Tournament* t = calloc(1, sizeof(Tournament));
+    if (!t) return;
+    snprintf(t->name, sizeof(t->name), "%s", name);
+    snprintf(t->creator, sizeof(t->creator), "%s", c->session_id);
+    t->format = fmt;
+    t->state = T_REGISTERING;
+    t->total_rounds = (int)total;
+
+    pthread_mutex_lock(&g_tourney_mtx);
+    int open = 0;
+    for (int i = 0; i < g_tourney_count; i++)
+        if (g_tourneys[i]->state != T_FINISHED && strcmp(g_tourneys[i]->creator, t->creator) == 0)
+            open++;
+    if (open >= TOURNEY_OPEN_MAX) {
+        pthread_mutex_unlock(&g_tourney_mtx);
+        free(t);
+        sendp(c->fd, "ERROR|Too many open tournaments");
+        return;
+    }
+    if (g_tourney_count == g_tourney_cap) {
+        int cap = g_tourney_cap ? g_tourney_cap * 2 : 8;
+        Tournament** grown = realloc(g_tourneys, (size_t)cap * sizeof(*grown));
+        if (!grown) {
+            pthread_mutex_unlock(&g_tourney_mtx);
+            free(t);
+            sendp(c->fd, "ERROR|Cannot create tournament");
+            return;
+        }
+        g_tourneys = grown;
+        g_tourney_cap = cap;
+    }
+    t->id = g_next_tourney_id++;
+    g_tourneys[g_tourney_count++] = t;
+    pthread_mutex_unlock(&g_tourney_mtx);
+
+    sendp(c->fd, "TOURNEY_CREATED|%d|%s|%s", t->id, t->name, fmt == FMT_SWISS ? "SWISS" : "SE");
+    server_log("Tournament %d (%s, %s) created by %s", t->id, t->name,
+               fmt == FMT_SWISS ? "SWISS" : "SE", c->name);
+}
+
+static void cmd_join(struct Client* c, int id) {
+    pthread_mutex_lock(&g_tourney_mtx);
+    Tournament* t = tourney_find(id);
+    if (!t || t->state != T_REGISTERING) {
+        pthread_mutex_unlock(&g_tourney_mtx);
+        sendp(c->fd, "ERROR|Registration closed");
+        return;
+    }
+    if (player_index(t, c->session_id) >= 0) {
+        pthread_mutex_unlock(&g_tourney_mtx);
+        sendp(c->fd, "ERROR|Already registered");
+        return;
+    }
+    if (t->player_count == t->player_cap) {
+        int cap = t->player_cap ? t->player_cap * 2 : 16;
+        TPlayer* grown = realloc(t->players, (size_t)cap * sizeof(TPlayer));
+        if (!grown) {
+            pthread_mutex_unlock(&g_tourney_mtx);
+            sendp(c->fd, "ERROR|Cannot register");
+            return;
+        }
+        t->players = grown;
+        t->player_cap = cap;
+    }
+    TPlayer* p = &t->players[t->player_count++];
+    memset(p, 0, sizeof(*p));
+    snprintf(p->name, sizeof(p->name), "%s", c->name);
+    snprintf(p->session, sizeof(p->session), "%s", c->session_id);
+    client_hold(c);
+    p->conn = c;
+    p->rating = mm_rating(c);
+    int count = t->player_count;
+    pthread_mutex_unlock(&g_tourney_mtx);
+
+    sendp(c->fd, "TOURNEY_JOINED|%d|%d", id, count);
+}
+
+static void cmd_start(struct Client* c, int id) {
+    pthread_mutex_lock(&g_tourney_mtx);
+    Tournament* t = tourney_find(id);
+    const char* err = NULL;
+    if (!t)                                  err = "ERROR|No such tournament";
+    else if (strcmp(t->creator, c->session_id)) err = "ERROR|Only the creator can start";
+    else if (t->state != T_REGISTERING)      err = "ERROR|Already started";
+    else if (t->player_count < 2)            err = "ERROR|Not enough players";
+    pthread_mutex_unlock(&g_tourney_mtx);
+
+    if (err) {
+        sendp(c->fd, "%s", err);
+        return;
+    }
+
+    TEvent* ev = calloc(1, sizeof(TEvent));
+    if (!ev) return;
+    ev->type = EV_START;
+    ev->tourney_id = id;
+    push_event(ev);
+    sendp(c->fd, "INFO|Tournament starting");
+}
+
+static void cmd_list(struct Client* c) {
+    static const char* states[] = { "REGISTERING", "RUNNING", "FINISHED" };
+
+    pthread_mutex_lock(&g_tourney_mtx);
+    char line[256];
+    int off = snprintf(line, sizeof(line), "TOURNEYS|%d", g_tourney_count);
+    for (int i = 0; i < g_tourney_count && off < (int)sizeof(line); i++) {
+        Tournament* t = g_tourneys[i];
+        off += snprintf(line + off, sizeof(line) - off, "|%d|%s|%s|%d|%s",
+                        t->id, t->name, t->format == FMT_SWISS ? "SWISS" : "SE",
+                        t->player_count, states[t->state]);
+    }
+    pthread_mutex_unlock(&g_tourney_mtx);
+    sendp(c->fd, "%s", line);
+}
+
+void tourney_command(struct Client* c, const char* args) {
+    if (c->name[0] == '\0') {
+        sendp(c->fd, "ERROR|Join first");
+        return;
+    }
+
+    char tmp[128];
+    snprintf(tmp, sizeof(tmp), "%s", args);
+    char* save = NULL;
+    char* verb = strtok_r(tmp, "|", &save);
+    char* a1 = strtok_r(NULL, "|", &save);
+    char* a2 = strtok_r(NULL, "|", &save);
+    char* a3 = strtok_r(NULL, "|", &save);
+
+    if (!verb)                               sendp(c->fd, "ERROR|Invalid tournament command");
+    else if (strcasecmp(verb, "CREATE") == 0) cmd_create(c, a1, a2, a3);
+    else if (strcasecmp(verb, "JOIN") == 0 && a1)  cmd_join(c, atoi(a1));
+    else if (strcasecmp(verb, "START") == 0 && a1) cmd_start(c, atoi(a1));
+    else if (strcasecmp(verb, "LIST") == 0)  cmd_list(c);
+    else                                     sendp(c->fd, "ERROR|Invalid tournament command");
+}
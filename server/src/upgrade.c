@@ -0,0 +1,846 @@
+// ============================================================
+//  UPGRADE MODULE IMPLEMENTATION
+//  ------------------------------------------------------------
+//  Wire format on the SOCK_SEQPACKET link (one record per
+//  message, every message starts with its int32 kind):
+//
+//    new -> old   READY
+//    old -> new   HEADER   + listening socket(s)
+//    old -> new   CLIENTS  x ceil(n / UP_BATCH), + their sockets
+//    old -> new   ROOM     x rooms
+//    old -> new   END
+//    new -> old   ACK
+//    old -> new   COMMIT
+//
+//  The successor resumes no client before COMMIT (or the link
+//  closing, if the old process died after the ACK): until then
+//  the old one may still thaw and kill it, and nothing read in
+//  the meantime could be given back.
+//
+//  Records are explicit fixed-width structs, not the in-memory
+//  Client / Room, and the header carries their sizes: a binary
+//  with a different layout refuses the handover instead of
+//  misreading it, and the old process keeps serving.
+// ============================================================
+
+#define _GNU_SOURCE  // close_range, SCM_RIGHTS
+
+#include "upgrade.h"
+#include "client.h"
+#include "room.h"
+#include "game.h"
+#include "bot.h"
+#include "invite.h"
+#include "matchmaking.h"
+#include "presence.h"
+#include "shard.h"
+#include "stats.h"
+#include "utils.h"
+#include "config.h"
+#include "drain.h"
+#include "feed.h"
+#include "fanout.h"
+#include "log.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#define UPGRADE_MAGIC      0x55545454u  // "TTTU"
+#define UPGRADE_VERSION    3
+#define UPGRADE_CHILD_FD   3            // Link to the old process in the new one
+#define UP_BATCH           32           // Client records (and sockets) per message
+#define UP_READY_TIMEOUT_MS 10000       // Successor start-up
+#define UP_PARK_TIMEOUT_MS  2000        // All threads at a line boundary
+#define UP_DRAIN_TIMEOUT_MS 2000        // Fan-out queue delivered
+#define UP_ACK_TIMEOUT_MS   10000       // Successor rebuilt everything
+
+enum { UP_MSG_READY = 1, UP_MSG_HEADER, UP_MSG_CLIENTS, UP_MSG_ROOM, UP_MSG_END, UP_MSG_ACK,
+       UP_MSG_COMMIT };
+
+typedef struct {
+    int32_t  kind;
+    uint32_t magic;
+    uint32_t version;
+    uint32_t client_size;       ///< sizeof(UpClient) of the sender
+    uint32_t room_size;         ///< sizeof(UpRoom) of the sender
+    int32_t  clients;
+    int32_t  rooms;
+    int32_t  next_room_id;
+    int32_t  listeners;         ///< Listening sockets attached (TCP, LISTEN_UNIX)
+    int64_t  freeze_ms;         ///< CLOCK_MONOTONIC when the freeze began
+} UpHeader;
+
+typedef struct {
+    char     name[32];
+    char     session_id[32];
+    int32_t  state;
+    int32_t  rating;
+    int32_t  spectate_room_id;
+    int32_t  invalid_count;
+    int32_t  queued;            ///< Was in the quick-match queue
+    int32_t  feed;              ///< Subscribed to the room feed
+    double   chat_tokens;
+    int64_t  chat_last_ms;
+    uint32_t inlen;
+    char     inbuf[CLIENT_INBUF];
+} UpClient;
+
+typedef struct {
+    int32_t kind;
+    int32_t count;
+    UpClient rec[UP_BATCH];
+} UpClientBatch;
+
+typedef struct {
+    int32_t id;
+    char    name[32];
+    int32_t state;
+
+    char    board[SIZE][SIZE];
+    int32_t game_state;
+    int32_t turn;               ///< 0 = nobody, 1 = p1, 2 = p2
+    int32_t replay[2];
+
+    int32_t player[2];          ///< Index into the client records, -1 = empty
+    int32_t bot_seat;           ///< p2 is a server bot
+    int32_t disconnected[2];
+    int64_t disconnected_at[2];
+    int32_t pending_win[2];
+    int32_t turn_owner_disconnected;
+    char    pname[2][32];
+    char    session[2][32];
+    int32_t starting_player;
+
+    int32_t is_private;
+    int32_t tc;
+    int32_t move_ms;
+    int32_t base_ms;
+    int32_t inc_ms;
+    int32_t series_len;
+    int32_t bot_fill_ms;
+    int32_t tourney_id;
+
+    char    invite_code[8];
+    int64_t invite_ttl_ms;
+
+    int32_t clock_ms[2];
+    int64_t clock_left_ms;      ///< Time left for the player on turn, -1 = stopped
+
+    int32_t series_score[2];
+    int32_t series_over;
+    char    bot_waiter[32];
+
+    ChatLine chat[CHAT_HISTORY_LEN];
+    int32_t chat_head;
+    int32_t chat_count;
+} UpRoom;
+
+typedef struct {
+    int32_t kind;
+    UpRoom  room;
+} UpRoomMsg;
+
+static char** g_argv;
+static char   g_exe[512];           // Binary to exec (resolved at start-up)
+static int    g_link = -1;          // New process: link to the old one
+static int    g_listen_fds[2] = { -1, -1 };    // TCP, LISTEN_UNIX
+static bool   g_started = false;
+static pthread_t g_accept_thread;
+
+static atomic_bool g_pending;
+static pthread_mutex_t g_park_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  g_park_cv = PTHREAD_COND_INITIALIZER;
+static bool g_accept_parked = false;
+
+
+// ============================================================
+//  Link helpers (one record per message, optional SCM_RIGHTS)
+// ============================================================
+static int up_send(int sock, const void* data, size_t len, const int* fds, int nfds) {
+    struct iovec iov = { .iov_base = (void*)data, .iov_len = len };
+    union {
+        char buf[CMSG_SPACE(sizeof(int) * UP_BATCH)];
+        struct cmsghdr align;
+    } ctl;
+    struct msghdr mh;
+    memset(&mh, 0, sizeof(mh));
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+
+    if (nfds > 0) {
+        memset(&ctl, 0, sizeof(ctl));
+        mh.msg_control = ctl.buf;
+        mh.msg_controllen = CMSG_SPACE(sizeof(int) * (size_t)nfds);
+        struct cmsghdr* cm = CMSG_FIRSTHDR(&mh);
+        cm->cmsg_level = SOL_SOCKET;
+        cm->cmsg_type = SCM_RIGHTS;
+        cm->cmsg_len = CMSG_LEN(sizeof(int) * (size_t)nfds);
+        memcpy(CMSG_DATA(cm), fds, sizeof(int) * (size_t)nfds);
+    }
+
+    ssize_t n;
+    do {
+        n = sendmsg(sock, &mh, MSG_NOSIGNAL);
+    } while (n < 0 && errno == EINTR);
+    if (n != (ssize_t)len) {
+        perror("upgrade sendmsg");
+        return 0;
+    }
+    return 1;
+}
+
+// Receives one message of the expected kind; attached sockets land in
+// fds (*nfds of them). Returns the message length, -1 on error.
+static ssize_t up_recv(int sock, int kind, void* data, size_t cap, int* fds, int* nfds) {
+    struct iovec iov = { .iov_base = data, .iov_len = cap };
+    union {
+        char buf[CMSG_SPACE(sizeof(int) * UP_BATCH)];
+        struct cmsghdr align;
+    } ctl;
+    struct msghdr mh;
+    memset(&mh, 0, sizeof(mh));
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = ctl.buf;
+    mh.msg_controllen = sizeof(ctl.buf);
+
+    ssize_t n;
+    do {
+        n = recvmsg(sock, &mh, MSG_CMSG_CLOEXEC);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) mh.msg_controllen = 0;
+
+    int got = 0;
+    for (struct cmsghdr* cm = CMSG_FIRSTHDR(&mh); cm; cm = CMSG_NXTHDR(&mh, cm)) {
+        if (cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_RIGHTS) continue;
+        int k = (int)((cm->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+        for (int i = 0; i < k; i++) {
+            int fd;
+            memcpy(&fd, CMSG_DATA(cm) + (size_t)i * sizeof(int), sizeof(int));
+            if (fds && got < UP_BATCH) fds[got++] = fd;
+            else                       close(fd);
+        }
+    }
+    if (nfds) *nfds = got;
+
+    if (n < (ssize_t)sizeof(int32_t) || (mh.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) ||
+        *(const int32_t*)data != kind) {
+        for (int i = 0; i < got; i++) close(fds[i]);
+        if (nfds) *nfds = 0;
+        return -1;
+    }
+    return n;
+}
+
+// Waits until the link is readable or the timeout passes
+static int up_wait(int sock, int timeout_ms) {
+    struct pollfd p = { .fd = sock, .events = POLLIN };
+    long long deadline = now_ms() + timeout_ms;
+    for (;;) {
+        int left = (int)(deadline - now_ms());
+        if (left < 0) left = 0;
+        int r = poll(&p, 1, left);
+        if (r > 0) return 1;
+        if (r == 0 || errno != EINTR) return 0;
+    }
+}
+
+
+// ============================================================
+//  Start-up and triggers
+// ============================================================
+void upgrade_init(char** argv) {
+    g_argv = argv;
+
+    // The binary on disk may be replaced later; /proc/self/exe then
+    // ends in " (deleted)", so resolve the path now
+    ssize_t n = readlink("/proc/self/exe", g_exe, sizeof(g_exe) - 1);
+    if (n > 0) g_exe[n] = '\0';
+    else       snprintf(g_exe, sizeof(g_exe), "%s", argv[0]);
+
+    const char* link = getenv("UPGRADE_FD");
+    if (link) {
+        g_link = atoi(link);
+        unsetenv("UPGRADE_FD");
+    }
+}
+
+bool upgrade_is_child(void) {
+    return g_link >= 0;
+}
+
+bool upgrade_pending(void) {
+    return atomic_load(&g_pending);
+}
+
+int upgrade_request(void) {
+    if (!g_started || drain_active()) return 0;
+    return kill(getpid(), SIGUSR2) == 0;
+}
+
+static void on_wake(int sig) {
+    (void)sig;      // only there to make recv()/accept() return EINTR
+}
+
+void upgrade_start(int listen_fd, int unix_fd) {
+    if (shard_enabled()) return;
+
+    g_listen_fds[0] = listen_fd;
+    g_listen_fds[1] = unix_fd;
+    g_accept_thread = pthread_self();
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_wake;        // no SA_RESTART
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGUSR1, &sa, NULL);
+    g_started = true;
+}
+
+
+// ============================================================
+//  Freeze / thaw
+//  ------------------------------------------------------------
+//  Threads park themselves at a line boundary once g_pending
+//  is set; SIGUSR1 only gets them out of a blocking call. The
+//  signal is repeated because it can land just before recv().
+// ============================================================
+void upgrade_park(struct Client* c) {
+    pthread_mutex_lock(&g_park_mtx);
+    if (c) c->parked = true;
+    else   g_accept_parked = true;
+    while (atomic_load(&g_pending))
+        pthread_cond_wait(&g_park_cv, &g_park_mtx);
+    if (c) c->parked = false;
+    else   g_accept_parked = false;
+    pthread_mutex_unlock(&g_park_mtx);
+}
+
+static int freeze(long long deadline) {
+    atomic_store(&g_pending, true);
+    for (;;) {
+        int busy = 0;
+        pthread_mutex_lock(&g_clients_mtx);
+        pthread_mutex_lock(&g_park_mtx);
+        if (!g_accept_parked) {
+            pthread_kill(g_accept_thread, SIGUSR1);
+            busy++;
+        }
+        for (int i = 0; i < g_client_cap; i++) {
+            struct Client* c = g_clients[i];
+            if (!c || !c->connected || !c->alive || c->parked) continue;
+            if (c->has_thread) pthread_kill(c->thread, SIGUSR1);
+            busy++;
+        }
+        pthread_mutex_unlock(&g_park_mtx);
+        pthread_mutex_unlock(&g_clients_mtx);
+
+        if (busy == 0) return 1;
+        if (now_ms() >= deadline) return 0;
+        struct timespec ts = { 0, 1000000 };
+        nanosleep(&ts, NULL);
+    }
+}
+
+// Takes the clients and rooms locks once the fan-out queue is empty.
+// Queued events were encoded against the state being sent: delivered
+// here they reach every spectator before the successor takes over,
+// dropped with the process they would leave a stale board behind.
+// Lobby jobs take g_clients_mtx, so the wait itself runs unlocked.
+static int lock_drained(long long deadline) {
+    for (;;) {
+        pthread_mutex_lock(&g_clients_mtx);
+        pthread_mutex_lock(&g_rooms_mtx);
+        if (fanout_pending() == 0) return 1;
+        pthread_mutex_unlock(&g_rooms_mtx);
+        pthread_mutex_unlock(&g_clients_mtx);
+
+        if (now_ms() >= deadline) return 0;
+        struct timespec ts = { 0, 1000000 };
+        nanosleep(&ts, NULL);
+    }
+}
+
+static void thaw(void) {
+    pthread_mutex_lock(&g_park_mtx);
+    atomic_store(&g_pending, false);
+    pthread_cond_broadcast(&g_park_cv);
+    pthread_mutex_unlock(&g_park_mtx);
+}
+
+
+// ============================================================
+//  Old process: serialization (clients + rooms locks held)
+// ============================================================
+static int index_of(struct Client* const* list, int n, const struct Client* c) {
+    for (int i = 0; i < n; i++)
+        if (list[i] == c) return i;
+    return -1;
+}
+
+static void client_pack(const struct Client* c, UpClient* u) {
+    memset(u, 0, sizeof(*u));
+    memcpy(u->name, c->name, sizeof(u->name));
+    memcpy(u->session_id, c->session_id, sizeof(u->session_id));
+    u->state = (int32_t)c->state;
+    u->rating = c->rating;
+    u->spectate_room_id = c->spectate_room_id;
+    u->invalid_count = c->invalid_count;
+    u->queued = (c->queue_entry != NULL);
+    u->feed = feed_is_subscribed(c);
+    u->chat_tokens = c->chat_bucket.tokens;
+    u->chat_last_ms = c->chat_bucket.last_ms;
+    u->inlen = (uint32_t)c->inlen;
+    memcpy(u->inbuf, c->inbuf, c->inlen);
+}
+
+static void room_pack(const Room* r, struct Client* const* list, int n, UpRoom* u) {
+    memset(u, 0, sizeof(*u));
+    u->id = r->id;
+    memcpy(u->name, r->name, sizeof(u->name));
+    u->state = (int32_t)r->state;
+
+    memcpy(u->board, r->game.board, sizeof(u->board));
+    u->game_state = r->game.state;
+    const struct Client* turn = r->game.current_turn;
+    u->turn = (turn && turn == r->p1) ? 1 : (turn && turn == r->p2) ? 2 : 0;
+    u->replay[0] = r->replay_p1;
+    u->replay[1] = r->replay_p2;
+
+    struct Client* seats[2] = { r->p1, r->p2 };
+    bool disc[2] = { r->p1_disconnected, r->p2_disconnected };
+    time_t disc_at[2] = { r->p1_disconnected_at, r->p2_disconnected_at };
+    u->bot_seat = (r->p2 && r->p2->is_bot);
+    for (int s = 0; s < 2; s++) {
+        u->player[s] = -1;
+        if (seats[s] && !seats[s]->is_bot) u->player[s] = index_of(list, n, seats[s]);
+        u->disconnected[s] = disc[s];
+        u->disconnected_at[s] = (int64_t)disc_at[s];
+        if (seats[s] && !seats[s]->is_bot && u->player[s] < 0) {
+            // Seated but no longer connected: let the grace period run
+            u->disconnected[s] = 1;
+            u->disconnected_at[s] = (int64_t)time(NULL);
+        }
+    }
+    u->pending_win[0] = r->p1_pending_win;
+    u->pending_win[1] = r->p2_pending_win;
+    u->turn_owner_disconnected = r->turn_owner_disconnected;
+    memcpy(u->pname[0], r->p1_name, sizeof(u->pname[0]));
+    memcpy(u->pname[1], r->p2_name, sizeof(u->pname[1]));
+    memcpy(u->session[0], r->p1_session, sizeof(u->session[0]));
+    memcpy(u->session[1], r->p2_session, sizeof(u->session[1]));
+    u->starting_player = r->starting_player;
+
+    u->is_private = r->opts.is_private;
+    u->tc = (int32_t)r->opts.tc;
+    u->move_ms = r->opts.move_ms;
+    u->base_ms = r->opts.base_ms;
+    u->inc_ms = r->opts.inc_ms;
+    u->series_len = r->opts.series_len;
+    u->bot_fill_ms = r->opts.bot_fill_ms;
+    u->tourney_id = r->opts.tourney_id;
+
+    memcpy(u->invite_code, r->invite_code, sizeof(u->invite_code));
+    u->invite_ttl_ms = invite_ttl_left(r->invite_code);
+
+    u->clock_ms[0] = r->clock_ms[0];
+    u->clock_ms[1] = r->clock_ms[1];
+    u->clock_left_ms = -1;
+    if (r->clock_timer && turn) {
+        int slot = (turn == r->p1) ? 0 : 1;
+        long left = r->clock_ms[slot] - (long)(now_ms() - r->turn_started_ms);
+        u->clock_left_ms = left > 0 ? left : 0;
+    }
+
+    u->series_score[0] = r->series_score[0];
+    u->series_score[1] = r->series_score[1];
+    u->series_over = r->series_over;
+    memcpy(u->bot_waiter, r->bot_waiter, sizeof(u->bot_waiter));
+
+    memcpy(u->chat, r->chat, sizeof(u->chat));
+    u->chat_head = r->chat_head;
+    u->chat_count = r->chat_count;
+}
+
+static int send_state(int sock, long long freeze_ms, int* n_clients) {
+    struct Client* list[MAX_CLIENTS];
+    int n = 0;
+    for (int i = 0; i < g_client_cap && n < MAX_CLIENTS; i++) {
+        struct Client* c = g_clients[i];
+        if (c && c->connected && c->alive && c->fd >= 0) list[n++] = c;
+    }
+    *n_clients = n;
+
+    UpHeader h;
+    memset(&h, 0, sizeof(h));
+    h.kind = UP_MSG_HEADER;
+    h.magic = UPGRADE_MAGIC;
+    h.version = UPGRADE_VERSION;
+    h.client_size = sizeof(UpClient);
+    h.room_size = sizeof(UpRoom);
+    h.clients = n;
+    h.rooms = g_room_count;
+    h.next_room_id = room_next_id();
+    h.listeners = (g_listen_fds[1] >= 0) ? 2 : 1;
+    h.freeze_ms = freeze_ms;
+    if (!up_send(sock, &h, sizeof(h), g_listen_fds, h.listeners)) return 0;
+
+    UpClientBatch* b = malloc(sizeof(UpClientBatch));
+    if (!b) return 0;
+    for (int i = 0; i < n; i += UP_BATCH) {
+        int k = (n - i < UP_BATCH) ? n - i : UP_BATCH;
+        int fds[UP_BATCH];
+        b->kind = UP_MSG_CLIENTS;
+        b->count = k;
+        for (int j = 0; j < k; j++) {
+            client_pack(list[i + j], &b->rec[j]);
+            fds[j] = list[i + j]->fd;
+        }
+        size_t len = offsetof(UpClientBatch, rec) + (size_t)k * sizeof(UpClient);
+        if (!up_send(sock, b, len, fds, k)) {
+            free(b);
+            return 0;
+        }
+    }
+    free(b);
+
+    UpRoomMsg m;
+    for (int i = 0; i < g_room_count; i++) {
+        m.kind = UP_MSG_ROOM;
+        room_pack(g_rooms[i], list, n, &m.room);
+        if (!up_send(sock, &m, sizeof(m), NULL, 0)) return 0;
+    }
+
+    int32_t end = UP_MSG_END;
+    return up_send(sock, &end, sizeof(end), NULL, 0);
+}
+
+
+// ============================================================
+//  Old process: upgrade_run() on the signal thread
+// ============================================================
+
+// Forks and execs the binary with the link as fd 3. The environment
+// is prepared before fork(): the child only makes async-signal-safe
+// calls.
+static pid_t spawn_successor(int link) {
+    extern char** environ;
+    static char var[32];
+    snprintf(var, sizeof(var), "UPGRADE_FD=%d", UPGRADE_CHILD_FD);
+
+    size_t n = 0;
+    while (environ[n]) n++;
+    char** envp = calloc(n + 2, sizeof(char*));
+    if (!envp) return -1;
+    size_t k = 0;
+    for (size_t i = 0; i < n; i++)
+        if (strncmp(environ[i], "UPGRADE_FD=", 11) != 0) envp[k++] = environ[i];
+    envp[k++] = var;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (link != UPGRADE_CHILD_FD) dup2(link, UPGRADE_CHILD_FD);
+        close_range(UPGRADE_CHILD_FD + 1, ~0U, 0);
+        execve(g_exe, g_argv, envp);
+        _exit(127);
+    }
+    if (pid < 0) perror("fork");
+    free(envp);
+    return pid;
+}
+
+void upgrade_run(void) {
+    if (!g_started) {
+        server_log("Upgrade not available");
+        return;
+    }
+    if (drain_active()) {
+        server_log("Upgrade refused: the server is draining");
+        return;
+    }
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) < 0) {
+        perror("socketpair");
+        return;
+    }
+    server_log("Live upgrade: starting %s", g_exe);
+    pid_t pid = spawn_successor(sv[1]);
+    close(sv[1]);
+    if (pid < 0) {
+        close(sv[0]);
+        return;
+    }
+
+    // Keep serving until the successor has started its threads
+    int32_t msg = 0;
+    int ok = up_wait(sv[0], UP_READY_TIMEOUT_MS) &&
+             up_recv(sv[0], UP_MSG_READY, &msg, sizeof(msg), NULL, NULL) > 0;
+
+    long long t0 = now_ms();
+    int clients = 0;
+    if (ok) ok = freeze(t0 + UP_PARK_TIMEOUT_MS);
+    if (ok && !lock_drained(now_ms() + UP_DRAIN_TIMEOUT_MS)) {
+        server_log("Live upgrade: fan-out queue not drained in time");
+        ok = 0;
+    }
+    if (ok) {
+        ok = send_state(sv[0], t0, &clients);
+        if (ok) {
+            server_log("Live upgrade: %d clients and %d rooms sent in %lld ms, handing over",
+                       clients, g_room_count, now_ms() - t0);
+            ok = up_wait(sv[0], UP_ACK_TIMEOUT_MS) &&
+                 up_recv(sv[0], UP_MSG_ACK, &msg, sizeof(msg), NULL, NULL) > 0;
+        }
+        // Past the ACK there is no way back: the successor resumes its
+        // clients on COMMIT, or on EOF should this send fail. Leave
+        // without cleanup, it owns every socket now.
+        if (ok) {
+            int32_t commit = UP_MSG_COMMIT;
+            up_send(sv[0], &commit, sizeof(commit), NULL, 0);
+            _exit(0);
+        }
+        pthread_mutex_unlock(&g_rooms_mtx);
+        pthread_mutex_unlock(&g_clients_mtx);
+    }
+
+    thaw();
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    close(sv[0]);
+    server_log("Live upgrade failed, continuing with the running process");
+}
+
+
+// ============================================================
+//  New process: upgrade_take_over()
+// ============================================================
+static struct Client* client_unpack(int fd, const UpClient* u) {
+    struct Client* c = client_create(fd);
+    if (!c) {
+        close(fd);
+        return NULL;
+    }
+    client_track_ip(c);
+    client_set_name(c, u->name);
+    snprintf(c->session_id, sizeof(c->session_id), "%.*s", (int)sizeof(u->session_id) - 1, u->session_id);
+    c->state = (ClientState)u->state;
+    c->rating = u->rating;
+    c->invalid_count = u->invalid_count;
+    c->chat_bucket.tokens = u->chat_tokens;
+    c->chat_bucket.last_ms = u->chat_last_ms;
+    c->inlen = (u->inlen < sizeof(c->inbuf)) ? u->inlen : 0;
+    memcpy(c->inbuf, u->inbuf, c->inlen);
+    return c;
+}
+
+// Expects g_rooms_mtx held
+static void room_unpack(const UpRoom* u, struct Client* const* list, int n) {
+    Room* r = (g_room_count < g_room_cap) ? room_alloc() : NULL;
+    if (!r) return;
+    g_rooms[g_room_count++] = r;
+
+    r->id = u->id;
+    snprintf(r->name, sizeof(r->name), "%.*s", (int)sizeof(u->name) - 1, u->name);
+    r->state = (RoomState)u->state;
+    memcpy(r->game.board, u->board, sizeof(r->game.board));
+    r->game.state = u->game_state;
+    r->replay_p1 = u->replay[0];
+    r->replay_p2 = u->replay[1];
+
+    struct Client* seats[2] = { NULL, NULL };
+    bool disc[2];
+    time_t disc_at[2];
+    for (int s = 0; s < 2; s++) {
+        int idx = u->player[s];
+        if (idx >= 0 && idx < n) seats[s] = list[idx];
+        if (s == 1 && u->bot_seat && (seats[1] = bot_create()) != NULL) {
+            snprintf(seats[1]->name, sizeof(seats[1]->name), "%.*s", (int)sizeof(u->pname[1]) - 1, u->pname[1]);
+            seats[1]->state = CLIENT_STATE_PLAYING;
+        }
+        disc[s] = u->disconnected[s];
+        disc_at[s] = (time_t)u->disconnected_at[s];
+        if (!seats[s] && idx >= 0) {     // socket lost on the way
+            disc[s] = true;
+            disc_at[s] = time(NULL);
+        }
+        if (seats[s]) seats[s]->current_room = r;
+    }
+    r->p1 = seats[0];
+    r->p2 = seats[1];
+    r->p1_disconnected = disc[0];
+    r->p2_disconnected = disc[1];
+    r->p1_disconnected_at = disc_at[0];
+    r->p2_disconnected_at = disc_at[1];
+    r->game.current_turn = (u->turn == 1) ? r->p1 : (u->turn == 2) ? r->p2 : NULL;
+    r->p1_pending_win = u->pending_win[0];
+    r->p2_pending_win = u->pending_win[1];
+    r->turn_owner_disconnected = u->turn_owner_disconnected;
+    memcpy(r->p1_name, u->pname[0], sizeof(r->p1_name));
+    memcpy(r->p2_name, u->pname[1], sizeof(r->p2_name));
+    memcpy(r->p1_session, u->session[0], sizeof(r->p1_session));
+    memcpy(r->p2_session, u->session[1], sizeof(r->p2_session));
+    r->p1_name[sizeof(r->p1_name) - 1] = r->p2_name[sizeof(r->p2_name) - 1] = '\0';
+    r->p1_session[sizeof(r->p1_session) - 1] = r->p2_session[sizeof(r->p2_session) - 1] = '\0';
+    r->starting_player = u->starting_player;
+
+    r->opts.is_private = u->is_private;
+    r->opts.tc = (TimeControl)u->tc;
+    r->opts.move_ms = u->move_ms;
+    r->opts.base_ms = u->base_ms;
+    r->opts.inc_ms = u->inc_ms;
+    r->opts.series_len = u->series_len;
+    r->opts.bot_fill_ms = u->bot_fill_ms;
+    r->opts.tourney_id = u->tourney_id;
+
+    memcpy(r->invite_code, u->invite_code, sizeof(r->invite_code));
+    r->invite_code[sizeof(r->invite_code) - 1] = '\0';
+    if (r->invite_code[0]) invite_restore(r->invite_code, r->id, (long)u->invite_ttl_ms);
+
+    r->clock_ms[0] = u->clock_ms[0];
+    r->clock_ms[1] = u->clock_ms[1];
+    r->series_score[0] = u->series_score[0];
+    r->series_score[1] = u->series_score[1];
+    r->series_over = u->series_over;
+    snprintf(r->bot_waiter, sizeof(r->bot_waiter), "%.*s", (int)sizeof(u->bot_waiter) - 1, u->bot_waiter);
+
+    memcpy(r->chat, u->chat, sizeof(r->chat));
+    r->chat_head = u->chat_head;
+    r->chat_count = u->chat_count;
+
+    room_resume(r, (long)u->clock_left_ms);
+}
+
+// Blocks until COMMIT, or EOF: the old process exited after the ACK
+static int wait_commit(int sock) {
+    int32_t msg = 0;
+    ssize_t n;
+    do {
+        n = recv(sock, &msg, sizeof(msg), 0);
+    } while (n < 0 && errno == EINTR);
+    return n == 0 || (n == (ssize_t)sizeof(msg) && msg == UP_MSG_COMMIT);
+}
+
+int upgrade_take_over(int* unix_fd) {
+    int sock = g_link;
+    int32_t ready = UP_MSG_READY;
+    UpHeader h;
+    int fds[UP_BATCH], nfds = 0;
+
+    if (!up_send(sock, &ready, sizeof(ready), NULL, 0) ||
+        up_recv(sock, UP_MSG_HEADER, &h, sizeof(h), fds, &nfds) != (ssize_t)sizeof(h) ||
+        nfds < 1 || nfds > 2) {
+        for (int i = 0; i < nfds; i++) close(fds[i]);
+        server_log("Live upgrade: no state received");
+        return -1;
+    }
+    int lfd = fds[0];
+    int ufd = (nfds == 2) ? fds[1] : -1;
+    if (h.magic != UPGRADE_MAGIC || h.version != UPGRADE_VERSION ||
+        h.client_size != sizeof(UpClient) || h.room_size != sizeof(UpRoom) || h.listeners != nfds ||
+        h.clients < 0 || h.clients > MAX_CLIENTS || h.rooms < 0 || h.rooms > MAX_ROOMS) {
+        server_log("Live upgrade: incompatible state format (version %u)", h.version);
+        close(lfd);
+        if (ufd >= 0) close(ufd);
+        return -1;
+    }
+
+    // Rooms beyond MAX_ROOMS of this config are carried over as well
+    if (h.rooms > config_get()->max_rooms) room_pool_resize(h.rooms);
+
+    // Clients first: rooms refer to them by record index
+    int n = h.clients;
+    struct Client* list[MAX_CLIENTS] = { NULL };
+    int watch[MAX_CLIENTS];
+    bool queued[MAX_CLIENTS];
+    bool feed[MAX_CLIENTS];
+    UpClientBatch* b = malloc(sizeof(UpClientBatch));
+    int got = 0;
+    while (b && got < n) {
+        ssize_t len = up_recv(sock, UP_MSG_CLIENTS, b, sizeof(*b), fds, &nfds);
+        if (len < (ssize_t)offsetof(UpClientBatch, rec) || b->count != nfds || got + nfds > n ||
+            len != (ssize_t)(offsetof(UpClientBatch, rec) + (size_t)nfds * sizeof(UpClient))) {
+            for (int i = 0; i < nfds; i++) close(fds[i]);
+            break;
+        }
+        for (int j = 0; j < nfds; j++, got++) {
+            list[got] = client_unpack(fds[j], &b->rec[j]);
+            watch[got] = b->rec[j].spectate_room_id;
+            queued[got] = b->rec[j].queued;
+            feed[got] = b->rec[j].feed;
+        }
+    }
+    free(b);
+
+    int ok = (got == n);
+    UpRoomMsg* m = malloc(sizeof(UpRoomMsg));
+    pthread_mutex_lock(&g_rooms_mtx);
+    for (int i = 0; ok && i < h.rooms; i++) {
+        ok = m && up_recv(sock, UP_MSG_ROOM, m, sizeof(*m), NULL, NULL) == (ssize_t)sizeof(*m);
+        if (ok) room_unpack(&m->room, list, n);
+    }
+    room_set_next_id(h.next_room_id);
+    for (int i = 0; ok && i < got; i++) {
+        if (!list[i] || watch[i] < 0) continue;
+        Room* r = room_find_by_id(watch[i]);
+        if (r) room_spectator_add(r, list[i]);
+    }
+    pthread_mutex_unlock(&g_rooms_mtx);
+    free(m);
+
+    int32_t end = 0;
+    if (ok) ok = up_recv(sock, UP_MSG_END, &end, sizeof(end), NULL, NULL) > 0;
+    if (!ok) {
+        // The old process thaws and keeps the connections
+        server_log("Live upgrade: state incomplete, giving up");
+        close(lfd);
+        if (ufd >= 0) close(ufd);
+        return -1;
+    }
+
+    // Ack, then wait for the old process to commit to exiting: no
+    // client thread may read a byte before that. If it gives up
+    // instead (late ACK), it kills this process while waiting here.
+    int32_t ack = UP_MSG_ACK;
+    if (!up_send(sock, &ack, sizeof(ack), NULL, 0) || !wait_commit(sock)) {
+        server_log("Live upgrade: no commit from the old process, giving up");
+        close(lfd);
+        if (ufd >= 0) close(ufd);
+        return -1;
+    }
+    close(sock);
+    g_link = -1;
+
+    for (int i = 0; i < got; i++) {
+        struct Client* c = list[i];
+        if (!c) continue;
+        if (c->name[0]) {
+            int rid = c->current_room ? c->current_room->id : -1;
+            PresenceState ps = !c->current_room ? PRES_LOBBY
+                             : (c->state == CLIENT_STATE_PLAYING) ? PRES_PLAYING : PRES_WAITING;
+            presence_set(c, ps, rid);
+        }
+        if (queued[i]) mm_enqueue(c);
+        if (feed[i]) feed_subscribe(c);     // snapshot again, harmless for the router
+        if (!client_resume(c)) client_destroy(c);
+    }
+
+    long pause = (long)(now_ms() - h.freeze_ms);
+
+    stats_observe(HIST_UPGRADE_PAUSE_MS, pause);
+    server_log("Live upgrade done: %d clients, %d rooms, pause %ld ms", got, h.rooms, pause);
+    printf("Live upgrade: took over %d clients and %d rooms (pause %ld ms)\n", got, h.rooms, pause);
+    *unix_fd = ufd;
+    return lfd;
+}
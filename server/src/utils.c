@@ -8,14 +8,18 @@
 //   - sendp:     Send formatted protocol message (prefixed with ##)
 //   - recv_line: Read single line from socket
 //   - trim_newline: Remove trailing newline / carriage return
+//   - msgbuf_*:  Coalesce several messages into one send
 // ============================================================
 
+#define _POSIX_C_SOURCE 200809L  // clock_gettime
+
 #include "utils.h"
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
 #include <stdarg.h>
 #include <sys/socket.h>
+#include <time.h>
 
 // ============================================================
 //  sendp()
@@ -27,6 +31,8 @@
 //  Example: sendp(fd, "HELLO|%s", name)  -->  ##HELLO|John\n
 // ============================================================
 void sendp(int fd, const char* fmt, ...) {
+    if (fd < 0) return;     // bots have no socket
+
     char payload[256];
 
     va_list ap;
@@ -44,6 +50,20 @@ void sendp(int fd, const char* fmt, ...) {
 }
 
 
+// ============================================================
+//  sendraw()
+//  ------------------------------------------------------------
+//  Sends bytes that are already framed (e.g. staged messages).
+// ============================================================
+void sendraw(int fd, const void* data, size_t len) {
+    if (fd < 0 || len == 0) return;
+    ssize_t ret = send(fd, data, len, 0);
+    if (ret < 0) {
+        perror("send");
+    }
+}
+
+
 // ============================================================
 //  recv_line()
 //  ------------------------------------------------------------
@@ -81,3 +101,48 @@ void trim_newline(char* s) {
         s[--n] = '\0';
     }
 }
+
+
+// ============================================================
+//  msgbuf_*()
+//  ------------------------------------------------------------
+//  Builds several protocol lines in a stack buffer so they can
+//  leave in a single send() (one syscall, one TCP segment).
+// ============================================================
+void msgbuf_init(MsgBuf* mb) {
+    mb->len = 0;
+    mb->data[0] = '\0';
+}
+
+void msgbuf_add(MsgBuf* mb, const char* fmt, ...) {
+    char payload[256];
+
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(payload, sizeof(payload), fmt, ap);
+    va_end(ap);
+
+    size_t room = sizeof(mb->data) - mb->len;
+    int n = snprintf(mb->data + mb->len, room, "##%s\n", payload);
+    if (n < 0 || (size_t)n >= room) {
+        mb->data[mb->len] = '\0';  // does not fit - drop it
+        return;
+    }
+    mb->len += (size_t)n;
+}
+
+void msgbuf_send(int fd, const MsgBuf* mb) {
+    sendraw(fd, mb->data, mb->len);
+}
+
+
+// ============================================================
+//  now_ms()
+//  ------------------------------------------------------------
+//  Monotonic milliseconds (immune to wall-clock adjustments).
+// ============================================================
+long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
@@ -0,0 +1,124 @@
+// ============================================================
+//  VALIDATE MODULE IMPLEMENTATION
+//  ------------------------------------------------------------
+//  The opcode is matched by length first, so an unknown one
+//  costs a few comparisons at most.
+// ============================================================
+
+#include "validate.h"
+#include "stats.h"
+#include "utils.h"
+#include "log.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <string.h>
+
+typedef struct {
+    const char* name;           // Opcode without "##" and '|'
+    size_t len;
+    RateClass cls;
+} OpcodeRule;
+
+#define OP(name, cls) { name, sizeof(name) - 1, cls }
+
+static const OpcodeRule g_opcodes[] = {
+    OP("MOVE",      RL_GAME),
+    OP("PONG",      RL_GAME),
+    OP("PING",      RL_GAME),
+    OP("REPLAY",    RL_GAME),
+    OP("EXIT",      RL_GAME),
+    OP("QUIT",      RL_GAME),
+    OP("JOIN",      RL_ROOM),
+    OP("RECONNECT", RL_ROOM),
+    OP("CREATE",    RL_ROOM),
+    OP("JOINROOM",  RL_ROOM),
+    OP("JOINCODE",  RL_ROOM),
+    OP("SPECTATE",  RL_ROOM),
+    OP("QUEUE",     RL_ROOM),
+    OP("UNQUEUE",   RL_ROOM),
+    OP("LIST",      RL_QUERY),
+    OP("STATS",     RL_QUERY),
+    OP("HEALTH",    RL_QUERY),
+    OP("TOURNEY",   RL_QUERY),
+    OP("FRIEND",    RL_QUERY),
+    OP("CHAT",      RL_OTHER),
+    OP("ADMIN",     RL_OTHER),
+};
+
+static atomic_long g_rejects;           // Since the last log line
+static atomic_llong g_last_log_ms;
+
+
+static bool is_opcode_char(unsigned char ch) {
+    return ch >= 'A' && ch <= 'Z';
+}
+
+// Printable ASCII and anything >= 0x80 (UTF-8 chat)
+static bool is_text_char(unsigned char ch) {
+    return ch >= 0x20 && ch != 0x7f;
+}
+
+static const OpcodeRule* opcode_find(const char* op, size_t len) {
+    for (size_t i = 0; i < sizeof(g_opcodes) / sizeof(g_opcodes[0]); i++)
+        if (g_opcodes[i].len == len && memcmp(g_opcodes[i].name, op, len) == 0)
+            return &g_opcodes[i];
+    return NULL;
+}
+
+ValidResult validate_line(char* line, RateClass* cls) {
+    const unsigned char* p = (const unsigned char*)line;
+
+    if (p[0] == '\n' || (p[0] == '\r' && p[1] == '\n')) return VALID_EMPTY;
+    if (p[0] != '#' || p[1] != '#') return VALID_NO_PREFIX;
+
+    // Opcode
+    size_t i = 2;
+    while (is_opcode_char(p[i])) i++;
+    if (i == 2 || p[i] != '|') return VALID_BAD_OPCODE;
+    const OpcodeRule* rule = opcode_find(line + 2, i - 2);
+    if (!rule) return VALID_UNKNOWN;
+
+    // Payload up to the line ending
+    i++;
+    while (is_text_char(p[i])) i++;
+    if (p[i] == '\r' && p[i + 1] == '\n') line[i] = '\0';
+    else if (p[i] == '\n') line[i] = '\0';
+    else if (p[i] == '\0') return VALID_TOO_LONG;
+    else return VALID_BAD_CHAR;
+
+    *cls = rule->cls;
+    return VALID_OK;
+}
+
+void validate_reject(const char* who, ValidResult why, const char* line) {
+    static const char* const reasons[] = {
+        [VALID_NO_PREFIX]  = "no ## prefix",
+        [VALID_BAD_OPCODE] = "bad opcode",
+        [VALID_UNKNOWN]    = "unknown opcode",
+        [VALID_BAD_CHAR]   = "control character",
+        [VALID_TOO_LONG]   = "line too long",
+    };
+    stats_inc(STAT_MALFORMED);
+    long pending = atomic_fetch_add(&g_rejects, 1) + 1;
+
+    long long now = now_ms();
+    long long last = atomic_load(&g_last_log_ms);
+    if (now - last < VALIDATE_LOG_MS ||
+        !atomic_compare_exchange_strong(&g_last_log_ms, &last, now))
+        return;
+    pending = atomic_exchange(&g_rejects, 0);
+
+    // The sample must not inject lines or escapes into the log
+    char sample[VALIDATE_SAMPLE_LEN + 1];
+    size_t n = 0;
+    for (; n < VALIDATE_SAMPLE_LEN && line[n] && line[n] != '\n'; n++) {
+        unsigned char ch = (unsigned char)line[n];
+        sample[n] = (ch >= 0x20 && ch < 0x7f) ? (char)ch : '?';
+    }
+    sample[n] = '\0';
+
+    const char* reason = (why >= VALID_NO_PREFIX && why <= VALID_TOO_LONG) ? reasons[why] : "?";
+    server_log("Rejected %ld malformed line%s; latest from %s: %s \"%s\"",
+               pending, pending == 1 ? "" : "s", who[0] ? who : "(unknown)", reason, sample);
+}